@@ -0,0 +1,35 @@
+/*
+ * Base64.cpp
+ *
+ */
+
+#include "Base64.h"
+
+static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+unsigned Base64::encode(char *out, const void *data, unsigned len)
+{
+  const unsigned char *p = (const unsigned char*)data;
+  char *o = out;
+
+  for (; len >= 3; len -= 3, p += 3, o += 4)
+  {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+
+    o[0] = ALPHABET[v >> 18];
+    o[1] = ALPHABET[(v >> 12) & 0x3F];
+    o[2] = ALPHABET[(v >> 6) & 0x3F];
+    o[3] = ALPHABET[v & 0x3F];
+  }
+  if (len)
+  {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((len > 1) ? (uint32_t)p[1] << 8 : 0);
+
+    *o++ = ALPHABET[v >> 18];
+    *o++ = ALPHABET[(v >> 12) & 0x3F];
+    *o++ = (len > 1) ? ALPHABET[(v >> 6) & 0x3F] : '=';
+    *o++ = '=';
+  }
+
+  return o - out;
+}
@@ -0,0 +1,34 @@
+/*
+ * Base64.h
+ *
+ */
+
+#ifndef BASE64_H_
+#define BASE64_H_
+
+#include <stdint.h>
+
+/***
+ * Kodiert Binärdaten als Base64 (RFC 4648, Alphabet A-Z a-z 0-9 + /, aufgefüllt mit '='), ohne Allokation.
+ *
+ * Je drei Bytes werden mit einer Tabelle von 64 Zeichen in vier Zeichen umgerechnet.
+ */
+class Base64
+{
+public:
+  /***
+   * Liefert die Anzahl der Zeichen für len Bytes.
+   */
+  static unsigned encodedLength(unsigned len)
+  {
+    return (len + 2) / 3 * 4;
+  }
+
+  /***
+   * Schreibt die len Bytes ab data kodiert nach out (encodedLength(len) Zeichen, ohne Terminierung) und
+   * liefert die Anzahl der Zeichen.
+   */
+  static unsigned encode(char *out, const void *data, unsigned len);
+};
+
+#endif /* BASE64_H_ */
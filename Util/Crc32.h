@@ -0,0 +1,35 @@
+/*
+ * Crc32.h
+ *
+ */
+
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include <stdint.h>
+
+/***
+ * CRC-32 wie bei Ethernet, zlib und PNG (Polynom 0x04C11DB7, bitweise gespiegelt, Start- und Endwert
+ * invertiert), mit einer Tabelle von 1 KByte, ein Byte pro Schritt.
+ *
+ * Ein Block kann in Teilen berechnet werden: update() bekommt den Wert der Teile davor, am Anfang 0.
+ * Die CRC von "123456789" ist 0xCBF43926.
+ */
+class Crc32
+{
+public:
+  /***
+   * Liefert die CRC über die Daten davor (crc) und die len Bytes ab data.
+   */
+  static uint32_t update(uint32_t crc, const void *data, unsigned len);
+
+  /***
+   * Liefert die CRC der len Bytes ab data.
+   */
+  static uint32_t compute(const void *data, unsigned len)
+  {
+    return update(0, data, len);
+  }
+};
+
+#endif /* CRC32_H_ */
@@ -0,0 +1,1014 @@
+/*
+ * FloatFormat.cpp
+ *
+ */
+
+#include "FloatFormat.h"
+
+#include <string.h>
+
+/* how far the digits of a value are wanted */
+enum Cut
+{
+  SHORTEST, /* the fewest digits, that read back give the value */
+  SIGNIFICANT, /* n significant digits */
+  FRACTION /* down to the n-th digit after the point */
+};
+
+/* the digits of a positive, finite value, returns their number, exponent is the one of the first digit */
+typedef unsigned (*DigitSource)(double value, Cut cut, int n, char *digits, int& exponent);
+
+static const uint32_t POW10_32[10] =
+{
+  1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u
+};
+static const double POW10_DOUBLE[18] =
+{
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17
+};
+
+static inline uint64_t double_bits(double value)
+{
+  uint64_t bits;
+
+  memcpy(&bits, &value, sizeof(bits));
+
+  return bits;
+}
+
+/* writes the n lowest decimal digits of v in front of end */
+static inline void put_digits(char *end, uint64_t v, unsigned n)
+{
+  while (n--)
+  {
+    *--end = '0' + char(v % 10);
+    v /= 10;
+  }
+}
+
+static inline unsigned decimal_length(uint64_t v)
+{
+  unsigned n = 1;
+
+  for (uint64_t p = 10; (n < 20) && (v >= p); p *= 10)
+    n++;
+
+  return n;
+}
+
+/*
+ * The shortest digits (Ulf Adams, "Ryu: fast float-to-string conversion", PLDI 2018).
+ *
+ * The interval of the values, that round to the double, is scaled by a power of 5 and 2 into 64 bit
+ * integers, of which the digits are removed as long as the interval still contains a value. The powers of 5
+ * are kept to 125 bits, 5^i for i < 326 and the inverse ones 2^(bits(5^i) - 1 + 125) / 5^i + 1 for i < 291.
+ * The tables have every 26th of them, the others are multiplied by 5^(i % 26) and corrected by 0 to 2.
+ */
+static const uint64_t POW5_TABLE[26] =
+{
+  1u, 5u, 25u, 125u,
+  625u, 3125u, 15625u, 78125u,
+  390625u, 1953125u, 9765625u, 48828125u,
+  244140625u, 1220703125u, 6103515625u, 30517578125u,
+  152587890625u, 762939453125u, 3814697265625u, 19073486328125u,
+  95367431640625u, 476837158203125u, 2384185791015625u, 11920928955078125u,
+  59604644775390625u, 298023223876953125u
+};
+static const uint64_t POW5_SPLIT2[13][2] =
+{
+  { 0u, 1152921504606846976u },
+  { 0u, 1490116119384765625u },
+  { 1032610780636961552u, 1925929944387235853u },
+  { 7910200175544436838u, 1244603055572228341u },
+  { 16941905809032713930u, 1608611746708759036u },
+  { 13024893955298202172u, 2079081953128979843u },
+  { 6607496772837067824u, 1343575221513417750u },
+  { 17332926989895652603u, 1736530273035216783u },
+  { 13037379183483547984u, 2244412773384604712u },
+  { 1605989338741628675u, 1450417759929778918u },
+  { 9630225068416591280u, 1874621017369538693u },
+  { 665883850346957067u, 1211445438634777304u },
+  { 14931890668723713708u, 1565756531257009982u }
+};
+static const uint32_t POW5_OFFSETS[21] =
+{
+  0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x40000000, 0x59695995,
+  0x55545555, 0x56555515, 0x41150504, 0x40555410, 0x44555145, 0x44504540,
+  0x45555550, 0x40004000, 0x96440440, 0x55565565, 0x54454045, 0x40154151,
+  0x55559155, 0x51405555, 0x00000105
+};
+static const uint64_t POW5_INV_SPLIT2[13][2] =
+{
+  { 1u, 2305843009213693952u },
+  { 5955668970331000884u, 1784059615882449851u },
+  { 8982663654677661702u, 1380349269358112757u },
+  { 7286864317269821294u, 2135987035920910082u },
+  { 7005857020398200553u, 1652639921975621497u },
+  { 17965325103354776697u, 1278668206209430417u },
+  { 8928596168509315048u, 1978643211784836272u },
+  { 10075671573058298858u, 1530901034580419511u },
+  { 597001226353042382u, 1184477304306571148u },
+  { 1527430471115325346u, 1832889850782397517u },
+  { 12533209867169019542u, 1418129833677084982u },
+  { 5577825024675947042u, 2194449627517475473u },
+  { 11006974540203867551u, 1697873161311732311u }
+};
+static const uint32_t POW5_INV_OFFSETS[19] =
+{
+  0x54544554, 0x04055545, 0x10041000, 0x00400414, 0x40010000, 0x41155555,
+  0x00000454, 0x00010044, 0x40000000, 0x44000041, 0x50454450, 0x55550054,
+  0x51655554, 0x40004000, 0x01000001, 0x00010500, 0x51515411, 0x05555554,
+  0x00000000
+};
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 uint128;
+
+static inline uint64_t umul128(uint64_t a, uint64_t b, uint64_t *high)
+{
+  uint128 p = uint128(a) * b;
+
+  *high = uint64_t(p >> 64);
+  return uint64_t(p);
+}
+#else
+static inline uint64_t umul128(uint64_t a, uint64_t b, uint64_t *high)
+{
+  uint64_t b00 = uint64_t(uint32_t(a)) * uint32_t(b);
+  uint64_t b01 = uint64_t(uint32_t(a)) * uint32_t(b >> 32);
+  uint64_t b10 = uint64_t(uint32_t(a >> 32)) * uint32_t(b);
+  uint64_t b11 = uint64_t(uint32_t(a >> 32)) * uint32_t(b >> 32);
+  uint64_t mid1 = b10 + (b00 >> 32);
+  uint64_t mid2 = b01 + uint32_t(mid1);
+
+  *high = b11 + (mid1 >> 32) + (mid2 >> 32);
+  return (mid2 << 32) | uint32_t(b00);
+}
+#endif
+
+/* bits 0 < dist < 64 of high:low */
+static inline uint64_t shift_right128(uint64_t low, uint64_t high, unsigned dist)
+{
+  return (high << (64 - dist)) | (low >> dist);
+}
+
+/* ceil(log2(5^e)), 1 for e = 0 */
+static inline int pow5_bits(int e)
+{
+  return int((uint32_t(e) * 1217359) >> 19) + 1;
+}
+
+/* floor(log10(2^e)) */
+static inline uint32_t log10_pow2(int e)
+{
+  return (uint32_t(e) * 78913) >> 18;
+}
+
+/* floor(log10(5^e)) */
+static inline uint32_t log10_pow5(int e)
+{
+  return (uint32_t(e) * 732923) >> 20;
+}
+
+/* m * mul >> delta, plus the correction, 128 bits */
+static inline void mul_pow5(uint64_t m, uint64_t mul0, uint64_t mul1, unsigned delta, uint64_t correction,
+                            uint64_t *result)
+{
+  uint64_t high1, high0;
+  uint64_t low1 = umul128(m, mul1, &high1);
+  uint64_t low0 = umul128(m, mul0, &high0);
+  uint64_t sum = high0 + low1;
+
+  if (sum < high0)
+    high1++;
+  result[0] = shift_right128(low0, sum, delta) + correction;
+  result[1] = shift_right128(sum, high1, delta) + (result[0] < correction);
+}
+
+static inline unsigned table_offset(const uint32_t *offsets, unsigned i)
+{
+  return (offsets[i / 16] >> ((i % 16) * 2)) & 3;
+}
+
+static void pow5_split(unsigned i, uint64_t *result)
+{
+  unsigned base = i / 26;
+  unsigned offset = i - base * 26;
+  const uint64_t *mul = POW5_SPLIT2[base];
+
+  if (!offset)
+  {
+    result[0] = mul[0];
+    result[1] = mul[1];
+    return;
+  }
+  mul_pow5(POW5_TABLE[offset], mul[0], mul[1], pow5_bits(i) - pow5_bits(base * 26), table_offset(POW5_OFFSETS, i),
+           result);
+}
+
+static void pow5_inv_split(unsigned i, uint64_t *result)
+{
+  unsigned base = (i + 25) / 26;
+  unsigned offset = base * 26 - i;
+  const uint64_t *mul = POW5_INV_SPLIT2[base];
+
+  if (!offset)
+  {
+    result[0] = mul[0];
+    result[1] = mul[1];
+    return;
+  }
+  mul_pow5(POW5_TABLE[offset], mul[0] - 1, mul[1], pow5_bits(base * 26) - pow5_bits(i),
+           1 + table_offset(POW5_INV_OFFSETS, i), result);
+}
+
+/* (m * mul) >> j, 64 < j < 128 */
+static inline uint64_t mul_shift64(uint64_t m, const uint64_t *mul, int j)
+{
+  uint64_t high1, high0;
+  uint64_t low1 = umul128(m, mul[1], &high1);
+  uint64_t sum;
+
+  umul128(m, mul[0], &high0);
+  sum = high0 + low1;
+  if (sum < high0)
+    high1++;
+
+  return shift_right128(sum, high1, j - 64);
+}
+
+static inline unsigned pow5_factor(uint64_t v)
+{
+  unsigned count = 0;
+
+  while (v % 5 == 0)
+  {
+    v /= 5;
+    count++;
+  }
+
+  return count;
+}
+
+static inline bool multiple_of_pow5(uint64_t v, unsigned p)
+{
+  return pow5_factor(v) >= p;
+}
+
+static inline bool multiple_of_pow2(uint64_t v, unsigned p)
+{
+  return !(v & ((uint64_t(1) << p) - 1));
+}
+
+/* the shortest decimal of mantissa and exponent of the double, as output * 10^e10 */
+static uint64_t shortest_decimal(uint64_t ieeeMantissa, unsigned ieeeExponent, int& e10)
+{
+  int e2;
+  uint64_t m2;
+
+  /* the interval is [mm, mp] * 2^e2 around mv * 2^e2, all scaled by 4 */
+  if (!ieeeExponent)
+  {
+    e2 = 1 - 1023 - 52 - 2;
+    m2 = ieeeMantissa;
+  }
+  else
+  {
+    e2 = int(ieeeExponent) - 1023 - 52 - 2;
+    m2 = (uint64_t(1) << 52) | ieeeMantissa;
+  }
+  const bool acceptBounds = !(m2 & 1); /* the bounds round to even */
+  const uint64_t mv = 4 * m2;
+  const unsigned mmShift = (ieeeMantissa != 0) || (ieeeExponent <= 1); /* else the lower gap is half */
+  uint64_t vr, vp, vm;
+  bool vmIsTrailingZeros = false;
+  bool vrIsTrailingZeros = false;
+  uint64_t pow5[2];
+
+  if (e2 >= 0)
+  {
+    const unsigned q = log10_pow2(e2) - (e2 > 3);
+    const int i = -e2 + int(q) + 125 + pow5_bits(q) - 1;
+
+    e10 = int(q);
+    pow5_inv_split(q, pow5);
+    vr = mul_shift64(mv, pow5, i);
+    vp = mul_shift64(mv + 2, pow5, i);
+    vm = mul_shift64(mv - 1 - mmShift, pow5, i);
+    if (q <= 21)
+    {
+      /* only here one of the values can be a multiple of 5^q, then the removed digits are zeros */
+      if (mv % 5 == 0)
+        vrIsTrailingZeros = multiple_of_pow5(mv, q);
+      else if (acceptBounds)
+        vmIsTrailingZeros = multiple_of_pow5(mv - 1 - mmShift, q);
+      else
+        vp -= multiple_of_pow5(mv + 2, q);
+    }
+  }
+  else
+  {
+    const unsigned q = log10_pow5(-e2) - (-e2 > 1);
+    const int i = -e2 - int(q);
+    const int j = int(q) - (pow5_bits(i) - 125);
+
+    e10 = int(q) + e2;
+    pow5_split(i, pow5);
+    vr = mul_shift64(mv, pow5, j);
+    vp = mul_shift64(mv + 2, pow5, j);
+    vm = mul_shift64(mv - 1 - mmShift, pow5, j);
+    if (q <= 1)
+    {
+      /* mv has at least q trailing zero bits */
+      vrIsTrailingZeros = true;
+      if (acceptBounds)
+        vmIsTrailingZeros = (mmShift == 1);
+      else
+        vp--;
+    }
+    else if (q < 63)
+    {
+      vrIsTrailingZeros = multiple_of_pow2(mv, q);
+    }
+  }
+
+  /* remove digits as long as the interval holds a value, rounding the last removed digit of vr */
+  int removed = 0;
+  unsigned lastRemovedDigit = 0;
+  uint64_t output;
+
+  if (vmIsTrailingZeros || vrIsTrailingZeros)
+  {
+    /* rare: exact values at the bounds or ties */
+    while (vp / 10 > vm / 10)
+    {
+      vmIsTrailingZeros &= (vm % 10 == 0);
+      vrIsTrailingZeros &= (lastRemovedDigit == 0);
+      lastRemovedDigit = unsigned(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+    if (vmIsTrailingZeros)
+    {
+      while (vm % 10 == 0)
+      {
+        vrIsTrailingZeros &= (lastRemovedDigit == 0);
+        lastRemovedDigit = unsigned(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        removed++;
+      }
+    }
+    if (vrIsTrailingZeros && (lastRemovedDigit == 5) && (vr % 2 == 0))
+      lastRemovedDigit = 4; /* exactly half, round to even */
+    output = vr + (((vr == vm) && (!acceptBounds || !vmIsTrailingZeros)) || (lastRemovedDigit >= 5));
+  }
+  else
+  {
+    bool roundUp = false;
+
+    if (vp / 100 > vm / 100)
+    {
+      roundUp = (vr % 100 >= 50);
+      vr /= 100;
+      vp /= 100;
+      vm /= 100;
+      removed += 2;
+    }
+    while (vp / 10 > vm / 10)
+    {
+      roundUp = (vr % 10 >= 5);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+    output = vr + ((vr == vm) || roundUp);
+  }
+  e10 += removed;
+
+  return output;
+}
+
+unsigned FloatFormat::shortest(double value, char *digits, int& exponent)
+{
+  uint64_t bits = double_bits(value);
+  uint64_t ieeeMantissa = bits & ((uint64_t(1) << 52) - 1);
+  unsigned ieeeExponent = unsigned(bits >> 52) & 0x7FF;
+  int e2 = int(ieeeExponent) - 1075;
+  uint64_t m2 = (uint64_t(1) << 52) | ieeeMantissa;
+  uint64_t output;
+  unsigned n;
+  int e10 = 0;
+
+  if (ieeeExponent && (e2 <= 0) && (e2 >= -52) && !(m2 & ((uint64_t(1) << -e2) - 1)))
+  {
+    /* integers up to 2^53 are their digits without the trailing zeros */
+    output = m2 >> -e2;
+    while (output % 10 == 0)
+    {
+      output /= 10;
+      e10++;
+    }
+  }
+  else
+  {
+    output = shortest_decimal(ieeeMantissa, ieeeExponent, e10);
+  }
+  n = decimal_length(output);
+  put_digits(digits + n, output, n);
+  exponent = e10 + int(n) - 1;
+
+  return n;
+}
+
+/*
+ * The exact decimal expansion of a double, digit by digit from the first one. The integer part is kept
+ * in groups of 9 digits, the fraction as binary fraction of up to 1074 bits, of which each digit is the
+ * carry of a multiplication by 10.
+ */
+class ExactDigits
+{
+public:
+  explicit ExactDigits(double value);
+
+  /* the next digit */
+  unsigned next();
+
+  /* whether there is a digit other than 0 after the last one */
+  bool rest() const;
+
+  int position; /* of the next digit */
+
+private:
+  uint32_t groups[36]; /* the lowest first */
+  uint32_t fraction[37]; /* the lowest word first, the point above the highest */
+  unsigned fractionWords;
+};
+
+/* the words of m << shift, shift < 32, m < 2^53 */
+static unsigned put_shifted(uint32_t *words, uint64_t m, unsigned shift)
+{
+  uint32_t low = uint32_t(m);
+  uint32_t high = uint32_t(m >> 32);
+
+  words[0] = low << shift;
+  words[1] = (high << shift) | (shift ? low >> (32 - shift) : 0);
+  words[2] = shift ? high >> (32 - shift) : 0;
+
+  return 3;
+}
+
+ExactDigits::ExactDigits(double value)
+: position(-1), fractionWords(0)
+{
+  uint64_t bits = double_bits(value);
+  uint64_t m = bits & ((uint64_t(1) << 52) - 1);
+  int e = int(bits >> 52) & 0x7FF;
+  unsigned numGroups = 0;
+
+  if (e)
+  {
+    m |= uint64_t(1) << 52;
+    e -= 1075;
+  }
+  else
+  {
+    e = -1074;
+  }
+
+  if (e >= 0)
+  {
+    /* an integer of up to 1024 bits, divided into groups by 10^9 */
+    uint32_t words[36];
+    unsigned numWords = unsigned(e) / 32;
+
+    memset(words, 0, numWords * sizeof(uint32_t));
+    numWords += put_shifted(words + numWords, m, unsigned(e) % 32);
+    while (numWords)
+    {
+      uint64_t r = 0;
+
+      for (unsigned i = numWords; i--; )
+      {
+        uint64_t t = (r << 32) | words[i];
+
+        words[i] = uint32_t(t / 1000000000u);
+        r = t % 1000000000u;
+      }
+      groups[numGroups++] = uint32_t(r);
+      while (numWords && !words[numWords - 1])
+        numWords--;
+    }
+  }
+  else
+  {
+    unsigned bitsAfterPoint = unsigned(-e);
+    uint64_t integer = (bitsAfterPoint < 64) ? m >> bitsAfterPoint : 0;
+
+    if (bitsAfterPoint < 64)
+      m &= (uint64_t(1) << bitsAfterPoint) - 1;
+    for (; integer; integer /= 1000000000u)
+      groups[numGroups++] = uint32_t(integer % 1000000000u);
+    fractionWords = (bitsAfterPoint + 31) / 32;
+    memset(fraction, 0, fractionWords * sizeof(uint32_t));
+    put_shifted(fraction, m, fractionWords * 32 - bitsAfterPoint);
+  }
+
+  if (numGroups)
+  {
+    unsigned top = 1;
+
+    while ((top < 9) && (groups[numGroups - 1] >= POW10_32[top]))
+      top++;
+    position = int(9 * (numGroups - 1) + top) - 1;
+  }
+}
+
+unsigned ExactDigits::next()
+{
+  unsigned digit;
+
+  if (position >= 0)
+  {
+    digit = (groups[position / 9] / POW10_32[position % 9]) % 10;
+  }
+  else
+  {
+    uint32_t carry = 0;
+
+    for (unsigned i = 0; i < fractionWords; i++)
+    {
+      uint64_t t = uint64_t(fraction[i]) * 10 + carry;
+
+      fraction[i] = uint32_t(t);
+      carry = uint32_t(t >> 32);
+    }
+    digit = carry;
+  }
+  position--;
+
+  return digit;
+}
+
+bool ExactDigits::rest() const
+{
+  unsigned i;
+
+  if (position >= 0)
+  {
+    unsigned group = unsigned(position) / 9;
+
+    if (groups[group] % POW10_32[position % 9 + 1])
+      return true;
+    while (group--)
+      if (groups[group])
+        return true;
+  }
+  for (i = 0; i < fractionWords; i++)
+    if (fraction[i])
+      return true;
+
+  return false;
+}
+
+/* rounds up the digits, returns the new number of digits */
+static unsigned round_up(char *digits, unsigned n, Cut cut, int& exponent)
+{
+  unsigned i = n;
+
+  while (i && (digits[i - 1] == '9'))
+    digits[--i] = '0';
+  if (i)
+  {
+    digits[i - 1]++;
+    return n;
+  }
+  /* 99.9 -> 100.0, one digit more after the point, not more significant ones */
+  digits[0] = '1';
+  exponent++;
+  if ((cut == FRACTION) && (n < FloatFormat::MAX_DIGITS))
+    digits[n++] = '0';
+
+  return n;
+}
+
+/* n digits of the exact digits x, rounded half to even */
+template <class Digits>
+static unsigned cut_digits(Digits& x, Cut cut, int n, char *digits, int& exponent)
+{
+  unsigned count = 0;
+  unsigned digit;
+  int pos, last;
+
+  /* the leading zeros of the fraction, in FRACTION up to the digit after the last one */
+  do
+  {
+    pos = x.position;
+    digit = x.next();
+  } while (!digit && ((cut != FRACTION) || (pos >= -n)));
+
+  exponent = pos;
+  last = (cut == SIGNIFICANT) ? pos - n + 1 : -n;
+  if (last < pos - FloatFormat::MAX_DIGITS + 1)
+    last = pos - FloatFormat::MAX_DIGITS + 1;
+  while (pos >= last)
+  {
+    digits[count++] = char('0' + digit);
+    pos = x.position;
+    digit = x.next();
+  }
+
+  if ((digit > 5) || ((digit == 5) && (x.rest() || (count && (digits[count - 1] & 1)))))
+  {
+    if (!count)
+    {
+      digits[count++] = '1';
+      exponent = last;
+    }
+    else
+    {
+      count = round_up(digits, count, cut, exponent);
+    }
+  }
+
+  return count;
+}
+
+/* n digits of the exact value, rounded half to even */
+static unsigned exact_cut(double value, Cut cut, int n, char *digits, int& exponent)
+{
+  ExactDigits x(value);
+
+  return cut_digits(x, cut, n, digits, exponent);
+}
+
+/*
+ * n digits of the value, from its shortest digits where they decide the rounding, else exact. The shortest
+ * digits lie closer to the value than any shorter decimal, so rounding them gives the rounded value but
+ * for ties. Padded with zeros they are the rounded value for up to 15 digits of normal doubles, as
+ * these lie closer to the value than half a unit of the 15th digit.
+ */
+static unsigned exact_digits(double value, Cut cut, int n, char *digits, int& exponent)
+{
+  unsigned length = FloatFormat::shortest(value, digits, exponent);
+  int wanted;
+
+  if (cut == SHORTEST)
+    return length;
+
+  wanted = (cut == SIGNIFICANT) ? n : exponent + 1 + n;
+  if (wanted > FloatFormat::MAX_DIGITS)
+    wanted = FloatFormat::MAX_DIGITS;
+
+  if (wanted < 0)
+    return 0;
+  if (unsigned(wanted) >= length)
+  {
+    if ((wanted <= 15) && (value >= 2.2250738585072014e-308))
+    {
+      memset(digits + length, '0', wanted - length);
+      return unsigned(wanted);
+    }
+  }
+  else if ((digits[wanted] != '5') || (unsigned(wanted) + 1 < length))
+  {
+    bool up = (digits[wanted] >= '5');
+
+    if (!wanted)
+    {
+      if (!up)
+        return 0;
+      digits[0] = '1';
+      exponent++;
+      return 1;
+    }
+    return up ? round_up(digits, unsigned(wanted), cut, exponent) : unsigned(wanted);
+  }
+
+  return exact_cut(value, cut, n, digits, exponent);
+}
+
+/*
+ * The exact digits of a value below 2^64 without bits below 2^-64, as 64.64 bit fixed point number. The
+ * digits of the fraction are the carries of its multiplications by 10, like in ExactDigits.
+ */
+class FixedPointDigits
+{
+public:
+  explicit FixedPointDigits(double value);
+
+  /* whether value is such a value */
+  static bool fits(double value);
+
+  /* the next digit */
+  unsigned next();
+
+  /* whether there is a digit other than 0 after the last one */
+  bool rest() const;
+
+  int position; /* of the next digit */
+
+private:
+  char integer[20]; /* the digits of the integer part */
+  unsigned integerLength;
+  uint64_t fraction; /* the point above the highest bit */
+};
+
+FixedPointDigits::FixedPointDigits(double value)
+{
+  uint64_t i = uint64_t(value);
+
+  integerLength = i ? decimal_length(i) : 0;
+  put_digits(integer + integerLength, i, integerLength);
+  fraction = uint64_t((value - double(i)) * 18446744073709551616.0); /* exact, (value - i) < 1 */
+  position = int(integerLength) - 1;
+}
+
+bool FixedPointDigits::fits(double value)
+{
+  uint64_t bits = double_bits(value);
+  uint64_t m = bits & ((uint64_t(1) << 52) - 1);
+  int e = int(bits >> 52) & 0x7FF;
+
+  if (!e || (value >= 18446744073709551616.0))
+    return false;
+  m |= uint64_t(1) << 52;
+  for (e -= 1075; (e < -64) && !(m & 1); e++)
+    m >>= 1;
+
+  return e >= -64;
+}
+
+unsigned FixedPointDigits::next()
+{
+  unsigned digit;
+
+  if (position >= 0)
+  {
+    digit = unsigned(integer[integerLength - 1 - unsigned(position)] - '0');
+  }
+  else
+  {
+    uint64_t carry;
+
+    fraction = umul128(fraction, 10, &carry);
+    digit = unsigned(carry);
+  }
+  position--;
+
+  return digit;
+}
+
+bool FixedPointDigits::rest() const
+{
+  for (int i = position; i >= 0; i--)
+    if (integer[integerLength - 1 - unsigned(i)] != '0')
+      return true;
+
+  return fraction != 0;
+}
+
+/*
+ * n digits of the value, exact for the values of FixedPointDigits, else scaled by powers of 10 to [1, 10)
+ * and rounded as 64 bit integer, at most 17 significant ones, the scaling can make the last one wrong
+ */
+static unsigned fixed_digits(double value, Cut cut, int n, char *digits, int& exponent)
+{
+  static const double POWERS[9] = { 1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256 };
+  int e2 = int((double_bits(value) >> 52) & 0x7FF) - 1023;
+  int k = (e2 * 78913) >> 18; /* about log10(value), floor also for negative ones */
+  double w = value;
+  unsigned wanted, count, i;
+  uint64_t r;
+
+  if (FixedPointDigits::fits(value))
+  {
+    FixedPointDigits x(value);
+
+    if (cut != SHORTEST)
+      return cut_digits(x, cut, n, digits, exponent);
+    count = cut_digits(x, SIGNIFICANT, 15, digits, exponent);
+    while ((count > 1) && (digits[count - 1] == '0'))
+      count--;
+    return count;
+  }
+
+  if (e2 == -1023)
+    k = -308; /* subnormal */
+  for (i = 0; i < 9; i++)
+  {
+    if ((k < 0) && ((-k >> i) & 1))
+      w *= POWERS[i];
+    else if ((k > 0) && ((k >> i) & 1))
+      w /= POWERS[i];
+  }
+  while (w >= 10)
+  {
+    w /= 10;
+    k++;
+  }
+  while (w < 1)
+  {
+    w *= 10;
+    k--;
+  }
+  exponent = k;
+
+  if (cut == SHORTEST)
+    n = 15;
+  if (cut == FRACTION)
+    n += k + 1;
+  if (n > FloatFormat::MAX_DIGITS)
+    n = FloatFormat::MAX_DIGITS;
+  if (n < 0)
+    return 0;
+  if (!n)
+  {
+    if (w < 5)
+      return 0;
+    digits[0] = '1';
+    exponent++;
+    return 1;
+  }
+
+  /* up to 17 digits as integer, rounded half to even, the rest zeros */
+  wanted = unsigned(n);
+  count = (wanted < 17) ? wanted : 17;
+  w *= POW10_DOUBLE[count - 1];
+  r = uint64_t(w);
+  w -= double(r);
+  if ((w > 0.5) || ((w == 0.5) && (r & 1)))
+    r++;
+  if (r >= uint64_t(POW10_DOUBLE[count]))
+  {
+    /* 9.99 -> 10.0 */
+    exponent++;
+    if ((cut == FRACTION) && (count == wanted) && (count < 17))
+      count++;
+    else
+      r /= 10;
+  }
+  put_digits(digits + count, r, count);
+  if (cut == SHORTEST)
+  {
+    while ((count > 1) && (digits[count - 1] == '0'))
+      count--;
+    return count;
+  }
+  if (cut == FRACTION)
+    wanted = unsigned(exponent + 1 + (n - k - 1)); /* one more after a carry */
+  if (wanted > FloatFormat::MAX_DIGITS)
+    wanted = FloatFormat::MAX_DIGITS;
+  memset(digits + count, '0', wanted - count);
+
+  return wanted;
+}
+
+/* d.ddde+xx */
+static char *put_exponential(char *s, const char *digits, unsigned count, int exponent, unsigned fraction,
+                             bool upper)
+{
+  unsigned i;
+
+  *s++ = digits[0];
+  if (fraction)
+  {
+    *s++ = '.';
+    for (i = 1; i <= fraction; i++)
+      *s++ = (i < count) ? digits[i] : '0';
+  }
+  *s++ = upper ? 'E' : 'e';
+  if (exponent < 0)
+  {
+    *s++ = '-';
+    exponent = -exponent;
+  }
+  else
+  {
+    *s++ = '+';
+  }
+  if (exponent >= 100)
+  {
+    *s++ = char('0' + exponent / 100);
+    exponent %= 100;
+  }
+  *s++ = char('0' + exponent / 10);
+  *s++ = char('0' + exponent % 10);
+
+  return s;
+}
+
+/* ddd.ddd, count digits from 10^exponent on */
+static char *put_fixed(char *s, const char *digits, unsigned count, int exponent, unsigned fraction)
+{
+  int pos;
+  int last = -int(fraction);
+
+  if (exponent < 0)
+    *s++ = '0';
+  for (pos = (exponent < 0) ? -1 : exponent; pos >= last; pos--)
+  {
+    int i = exponent - pos;
+
+    if (pos == -1)
+      *s++ = '.';
+    *s++ = ((i >= 0) && (unsigned(i) < count)) ? digits[i] : '0';
+  }
+
+  return s;
+}
+
+static unsigned format_with(DigitSource source, char *buf, double value, char conversion, int precision, bool plus)
+{
+  char *s = buf;
+  bool upper = (conversion >= 'A') && (conversion <= 'Z');
+  char digits[FloatFormat::MAX_DIGITS];
+  unsigned count;
+  int exponent;
+
+  conversion |= 0x20;
+  if (double_bits(value) >> 63)
+  {
+    *s++ = '-';
+    value = -value;
+  }
+  else if (plus)
+  {
+    *s++ = '+';
+  }
+
+  if (value != value)
+  {
+    memcpy(s, upper ? "NAN" : "nan", 3);
+    return unsigned(s - buf) + 3;
+  }
+  if (value > 1.7976931348623157e308)
+  {
+    memcpy(s, upper ? "INF" : "inf", 3);
+    return unsigned(s - buf) + 3;
+  }
+  if (precision > FloatFormat::MAX_DIGITS)
+    precision = FloatFormat::MAX_DIGITS;
+
+  if ((conversion == 'f') && (value < 1e40))
+  {
+    unsigned fraction;
+
+    if (value == 0)
+      count = 0, exponent = 0;
+    else
+      count = source(value, (precision < 0) ? SHORTEST : FRACTION, precision, digits, exponent);
+    if (precision < 0)
+      fraction = (int(count) - exponent - 1 > 0) ? unsigned(int(count) - exponent - 1) : 0;
+    else if (count && (exponent - int(count) + 1 > -precision))
+      fraction = (exponent - int(count) + 1 < 0) ? unsigned(int(count) - exponent - 1) : 0; /* cut */
+    else
+      fraction = unsigned(precision);
+    if (fraction <= FloatFormat::MAX_DIGITS)
+      return unsigned(put_fixed(s, digits, count, count ? exponent : 0, fraction) - buf);
+    /* else the shortest digits of a small value as %e */
+  }
+
+  if (conversion == 'g')
+  {
+    int significant = (precision < 0) ? 16 : precision ? precision : 1; /* the limit of the exponent */
+
+    if (value == 0)
+      count = 1, digits[0] = '0', exponent = 0;
+    else
+      count = source(value, (precision < 0) ? SHORTEST : SIGNIFICANT, significant, digits, exponent);
+    while ((count > 1) && (digits[count - 1] == '0'))
+      count--;
+    if ((exponent >= -4) && (exponent < significant))
+      s = put_fixed(s, digits, count, exponent, (int(count) - exponent - 1 > 0) ? unsigned(int(count) - exponent - 1) : 0);
+    else
+      s = put_exponential(s, digits, count, exponent, count - 1, upper);
+
+    return unsigned(s - buf);
+  }
+
+  /* e and the large or small f */
+  if (precision >= FloatFormat::MAX_DIGITS)
+    precision = FloatFormat::MAX_DIGITS - 1;
+  if (value == 0)
+    count = 1, digits[0] = '0', exponent = 0;
+  else
+    count = source(value, (precision < 0) ? SHORTEST : SIGNIFICANT, precision + 1, digits, exponent);
+  s = put_exponential(s, digits, count, exponent, (precision < 0) ? count - 1 : unsigned(precision), upper);
+
+  return unsigned(s - buf);
+}
+
+unsigned FloatFormat::format(char *buf, double value, char conversion, int precision, bool plus)
+{
+  return format_with(&exact_digits, buf, value, conversion, precision, plus);
+}
+
+unsigned FloatFormat::formatFixed(char *buf, double value, char conversion, int precision, bool plus)
+{
+  return format_with(&fixed_digits, buf, value, conversion, precision, plus);
+}
@@ -0,0 +1,59 @@
+/*
+ * FloatFormat.h
+ *
+ */
+
+#ifndef FLOATFORMAT_H_
+#define FLOATFORMAT_H_
+
+#include <stdint.h>
+
+/***
+ * Formatiert double-Werte für %f, %e und %g in einen Puffer, ohne Allokation.
+ *
+ * Ohne Genauigkeit (precision < 0) wird die kürzeste Darstellung ausgegeben, die eingelesen wieder genau
+ * den Wert ergibt, z.B. 0.1 statt 0.100000 (abweichend von printf, das dann 6 Stellen ausgibt). Mit
+ * Genauigkeit wird wie bei printf gerundet, exakt halbe Werte auf die gerade Ziffer.
+ *
+ * Es gibt zwei Varianten:
+ * - format() ist exakt: die kürzeste Darstellung nach Ryu mit etwa 800 Bytes Tabellen, die gerundete
+ *   daraus oder, wenn sie dafür nicht reicht, aus der exakten Dezimalentwicklung des Werts.
+ * - formatFixed() ist klein für kleine Ziele, ohne Tabellen: Werte unter 2^64 ohne Bits unter 2^-64 (ab
+ *   etwa 5e-4) werden als 64.64-Bit-Festkommazahl exakt wie von format() gerundet. Die anderen werden mit
+ *   Zehnerpotenzen skaliert und als 64-Bit-Zahl gerundet. Das ergibt höchstens 17 gültige Stellen, ab der
+ *   12. ist die letzte durch die Skalierung zunehmend oft falsch gerundet (bei 15 Stellen in etwa 5 % der
+ *   Werte, bei 17 meist). Ohne Genauigkeit werden 15 Stellen ausgegeben.
+ *
+ * Beide geben höchstens MAX_DIGITS gültige Stellen aus, eine größere Genauigkeit wird gekürzt. %f von
+ * Werten ab 1e40 (und kürzeste %f mit mehr als MAX_DIGITS Nachkommastellen) werden wie %e ausgegeben.
+ */
+class FloatFormat
+{
+public:
+  enum
+  {
+    MAX_DIGITS = 40, /* gültige Stellen */
+    BUFFER_SIZE = 48 /* reicht für jedes Ergebnis */
+  };
+
+  /***
+   * Schreibt value nach buf (mindestens BUFFER_SIZE Bytes, ohne Terminierung) und liefert die Länge.
+   *
+   * conversion ist 'f', 'e' oder 'g', groß geschrieben auch 'E' und "INF"/"NAN" groß, plus gibt das
+   * Vorzeichen auch bei positiven Werten aus.
+   */
+  static unsigned format(char *buf, double value, char conversion, int precision, bool plus = false);
+
+  /***
+   * Wie format(), aber mit der kleinen Festkomma-Variante.
+   */
+  static unsigned formatFixed(char *buf, double value, char conversion, int precision, bool plus = false);
+
+  /***
+   * Schreibt die Ziffern der kürzesten Darstellung von |value| nach digits (mindestens 17 Bytes) und liefert
+   * deren Anzahl, exponent ist der Zehnerexponent der ersten Ziffer. value muss endlich und ungleich 0 sein.
+   */
+  static unsigned shortest(double value, char *digits, int& exponent);
+};
+
+#endif /* FLOATFORMAT_H_ */
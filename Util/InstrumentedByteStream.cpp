@@ -0,0 +1,102 @@
+/*
+ * InstrumentedByteStream.cpp
+ *
+ */
+
+#include "InstrumentedByteStream.h"
+
+InstrumentedByteStream* InstrumentedByteStream::streams = 0;
+
+InstrumentedByteStream::InstrumentedByteStream(ByteStream& lower, const char* name, TickFunction_t tickFunction)
+: ByteStreamDecorator(lower), streamName(name), tick(tickFunction), nextStream(streams)
+{
+  reset();
+  streams = this;
+}
+
+InstrumentedByteStream::~InstrumentedByteStream()
+{
+  InstrumentedByteStream** s = &streams;
+
+  while (*s && (*s != this))
+    s = &(*s)->nextStream;
+  if (*s)
+    *s = nextStream;
+}
+
+void InstrumentedByteStream::reset()
+{
+  unsigned i;
+
+  out.singleCalls = out.singleBytes = out.blockCalls = out.blockBytes = out.ticks = 0;
+  in.singleCalls = in.singleBytes = in.blockCalls = in.blockBytes = in.ticks = 0;
+  for (i = 0; i < BUCKETS; i++)
+  {
+    out.blockSizes[i] = 0;
+    in.blockSizes[i] = 0;
+  }
+}
+
+unsigned InstrumentedByteStream::bucket(unsigned numBytes)
+{
+  unsigned b = 0;
+
+  while ((numBytes >>= 1) && (b < BUCKETS - 1))
+    b++;
+
+  return b;
+}
+
+void InstrumentedByteStream::account(Counters& c, unsigned numBytes, unsigned requested, bool isBlock, uint32_t startTicks)
+{
+  if (isBlock)
+  {
+    c.blockCalls++;
+    c.blockBytes += numBytes;
+    c.blockSizes[bucket(requested)]++;
+  }
+  else
+  {
+    c.singleCalls++;
+    c.singleBytes += numBytes;
+  }
+
+  if (tick)
+    c.ticks += tick() - startTicks;
+}
+
+unsigned InstrumentedByteStream::write(unsigned char b)
+{
+  uint32_t t = tick ? tick() : 0;
+  unsigned n = backendIo.write(b);
+
+  account(out, n, 1, false, t);
+  return n;
+}
+
+unsigned InstrumentedByteStream::writeBlock(const unsigned char *b, unsigned numBytes)
+{
+  uint32_t t = tick ? tick() : 0;
+  unsigned n = backendIo.writeBlock(b, numBytes);
+
+  account(out, n, numBytes, true, t);
+  return n;
+}
+
+unsigned InstrumentedByteStream::read(unsigned char &b)
+{
+  uint32_t t = tick ? tick() : 0;
+  unsigned n = backendIo.read(b);
+
+  account(in, n, 1, false, t);
+  return n;
+}
+
+unsigned InstrumentedByteStream::readBlock(unsigned char *b, unsigned numBytes)
+{
+  uint32_t t = tick ? tick() : 0;
+  unsigned n = backendIo.readBlock(b, numBytes);
+
+  account(in, n, numBytes, true, t);
+  return n;
+}
@@ -0,0 +1,109 @@
+/*
+ * InstrumentedByteStream.h
+ *
+ */
+
+#ifndef INSTRUMENTEDBYTESTREAM_H_
+#define INSTRUMENTEDBYTESTREAM_H_
+
+#include "ByteStreamDecorator.h"
+#include <stdint.h>
+
+#ifndef IOSTAT_BUCKETS
+#define IOSTAT_BUCKETS 16
+#endif
+
+/***
+ * Dieser Decorator zählt die Bytes und Aufrufe, die durch ihn hindurch gehen, getrennt nach
+ * Richtung und nach Einzelbyte- (write()/read()) und Block-Zugriffen (writeBlock()/readBlock()).
+ * Für die Block-Zugriffe wird zusätzlich die Verteilung der angeforderten Blockgrößen in
+ * logarithmischen Stufen erfasst (Stufe i: 2^i ... 2^(i+1)-1 Bytes, die letzte Stufe nimmt alle
+ * größeren auf).
+ *
+ * Ist eine Zeitbasis angegeben, wird die Zeit im darunter liegenden Stream aufsummiert.
+ *
+ * Alle Instanzen tragen sich in eine Liste ein, über die sie z.B. vom Shell-Kommando "iostat"
+ * gefunden werden.
+ */
+class InstrumentedByteStream: public ByteStreamDecorator
+{
+public:
+  typedef uint32_t (*TickFunction_t)(void);
+
+  static const unsigned BUCKETS = IOSTAT_BUCKETS;
+
+  struct Counters
+  {
+    uint32_t singleCalls;
+    uint32_t singleBytes;
+    uint32_t blockCalls;
+    uint32_t blockBytes;
+    uint32_t ticks;
+    uint32_t blockSizes[BUCKETS];
+  };
+
+  InstrumentedByteStream(ByteStream& lowerStream, const char* name = "", TickFunction_t tickFunction = 0);
+  virtual ~InstrumentedByteStream();
+
+  virtual unsigned write(unsigned char b);
+  virtual unsigned writeBlock(const unsigned char *b, unsigned int numBytes);
+  virtual unsigned read(unsigned char &b);
+  virtual unsigned readBlock(unsigned char *b, unsigned int numBytes);
+
+  /* setzt alle Zähler zurück */
+  void reset();
+
+  const char* name() const;
+  const Counters& outCounters() const;
+  const Counters& inCounters() const;
+
+  /* Stufe des Histogramms für einen Block der Größe numBytes */
+  static unsigned bucket(unsigned numBytes);
+
+  /* Anfang der Liste aller Instanzen */
+  static InstrumentedByteStream* first();
+  InstrumentedByteStream* next() const;
+
+protected:
+  void account(Counters& c, unsigned numBytes, unsigned requested, bool isBlock, uint32_t startTicks);
+
+  const char* streamName;
+  TickFunction_t tick;
+  Counters out;
+  Counters in;
+
+  InstrumentedByteStream* nextStream;
+  static InstrumentedByteStream* streams;
+};
+
+inline
+const char* InstrumentedByteStream::name() const
+{
+  return streamName;
+}
+
+inline
+const InstrumentedByteStream::Counters& InstrumentedByteStream::outCounters() const
+{
+  return out;
+}
+
+inline
+const InstrumentedByteStream::Counters& InstrumentedByteStream::inCounters() const
+{
+  return in;
+}
+
+inline
+InstrumentedByteStream* InstrumentedByteStream::first()
+{
+  return streams;
+}
+
+inline
+InstrumentedByteStream* InstrumentedByteStream::next() const
+{
+  return nextStream;
+}
+
+#endif /* INSTRUMENTEDBYTESTREAM_H_ */
@@ -0,0 +1,293 @@
+/*
+ * NumberParser.cpp
+ *
+ */
+
+#include "NumberParser.h"
+
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define NUMBERPARSER_SWAR 1
+#else
+#define NUMBERPARSER_SWAR 0
+#endif
+
+#if defined(__GNUC__)
+#define NUMBERPARSER_NOINLINE __attribute__((noinline)) /* the general path keeps its registers to itself */
+#else
+#define NUMBERPARSER_NOINLINE
+#endif
+
+static const uint64_t MAX_VALUE = ~uint64_t(0);
+static const uint64_t DECIMAL_LIMIT = MAX_VALUE / 10; /* the largest value, that can take one more digit */
+
+/* the value of a digit up to base 36, 255 for other characters */
+static inline unsigned digit_value(char c)
+{
+  unsigned d = (unsigned char)c - '0';
+
+  if (d < 10)
+    return d;
+  d = ((unsigned char)c | 0x20) - 'a';
+
+  return (d < 26) ? d + 10 : 255;
+}
+
+#if NUMBERPARSER_SWAR
+/* eight decimal digits, the first one in the lowest byte */
+static inline uint32_t decimal8(const char *p)
+{
+  uint64_t x;
+
+  memcpy(&x, p, 8);
+  x -= 0x3030303030303030ULL;
+  x = (x * 10) + (x >> 8); /* pairs */
+  x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+       + (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+  return uint32_t(x);
+}
+
+/* eight hex digits of either case, the first one in the lowest byte */
+static inline uint32_t hex8(const char *p)
+{
+  uint64_t x;
+
+  memcpy(&x, p, 8);
+  x = (x & 0x0F0F0F0F0F0F0F0FULL) + ((x >> 6) & 0x0101010101010101ULL) * 9; /* nibbles, letters have bit 6 */
+  x = ((x & 0x000F000F000F000FULL) << 4) | ((x >> 8) & 0x000F000F000F000FULL); /* pairs */
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+  x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL; /* the first pair in the lowest byte */
+
+  return __builtin_bswap32(uint32_t(x));
+}
+#endif
+
+/* the general syntax, with sign, every prefix, separators, suffixes, overflow and errors */
+static NUMBERPARSER_NOINLINE NumberParser::Status parse_general(const char *s, uint64_t& value, bool hex)
+{
+  unsigned base = hex ? 16 : 10;
+  bool negative = false;
+  bool overflow = false;
+  const char *d, *limit;
+  unsigned c, shift, unchecked;
+  uint64_t v = 0;
+
+  value = 0;
+  if (!*s)
+    return NumberParser::EMPTY;
+
+  if ((*s == '-') || (*s == '+'))
+    negative = (*s++ == '-');
+  if (s[0] == '0')
+  {
+    char p = s[1] | 0x20;
+
+    if (p == 'x')
+    {
+      base = 16;
+      s += 2;
+    }
+    else if (((p == 'b') || (p == 'o')) && !hex)
+    {
+      base = (p == 'b') ? 2 : 8;
+      s += 2;
+    }
+  }
+  shift = (base == 16) ? 4 : (base == 8) ? 3 : 1; /* bits per digit, but decimal */
+  unchecked = (base == 16) ? 16 : (base == 8) ? 21 : (base == 2) ? 64 : 19; /* digits, that fit into 64 bits */
+
+  /*
+   * the digits are checked and converted in one pass, the first ones up to 64 bits cannot overflow and are
+   * taken unchecked, a separator is allowed between two digits
+   */
+  d = s;
+  if (base == 10)
+  {
+    for (limit = s + unchecked; (d < limit) && ((c = (unsigned char)(*d - '0')) < 10); d++)
+      v = v * 10 + c;
+    for (;;)
+    {
+      while ((c = (unsigned char)(*d - '0')) < 10)
+      {
+        overflow |= (v > DECIMAL_LIMIT) | ((v == DECIMAL_LIMIT) & (c > MAX_VALUE % 10));
+        v = v * 10 + c;
+        d++;
+      }
+      if ((*d != '_') || (d == s) || ((unsigned char)(d[1] - '0') >= 10))
+        break;
+      d++;
+    }
+  }
+  else
+  {
+    for (limit = s + unchecked; (d < limit) && ((c = digit_value(*d)) < base); d++)
+      v = (v << shift) | c;
+    for (;;)
+    {
+      while ((c = digit_value(*d)) < base)
+      {
+        overflow |= (v >> (64 - shift)) != 0;
+        v = (v << shift) | c;
+        d++;
+      }
+      if ((*d != '_') || (d == s) || (digit_value(d[1]) >= base))
+        break;
+      d++;
+    }
+  }
+  if (d == s)
+    return NumberParser::INVALID;
+  s = d;
+
+  if ((*s == 'k') || (*s == 'K') || (*s == 'M'))
+  {
+    unsigned shift = (*s++ == 'M') ? 20 : 10;
+
+    overflow = overflow || (v > (MAX_VALUE >> shift));
+    v <<= shift;
+  }
+
+  if (overflow)
+  {
+    value = MAX_VALUE;
+    return NumberParser::OUT_OF_RANGE;
+  }
+  value = negative ? 0 - v : v;
+
+  return *s ? NumberParser::INVALID : NumberParser::VALID;
+}
+
+/* the decimal digits from p on, d follows the first eight, found to their end and converted in words of eight */
+static bool long_decimal(const char *p, const char *d, uint64_t& value)
+{
+  const char *r = p;
+  uint64_t v = 0;
+  unsigned n, c;
+
+  for (; (unsigned char)(*d - '0') < 10; d++)
+    ;
+  n = unsigned(d - p);
+  if (*d || (n > 20))
+    return false;
+  c = (n == 20) ? (unsigned char)(d[-1] - '0') : 10; /* the 20th digit can overflow */
+  n -= (n == 20);
+#if NUMBERPARSER_SWAR
+  for (; n >= 8; n -= 8, r += 8)
+    v = v * 100000000 + decimal8(r);
+#endif
+  for (; n; n--)
+    v = v * 10 + (unsigned char)(*r++ - '0');
+  if (c < 10)
+  {
+    if ((v > DECIMAL_LIMIT) || ((v == DECIMAL_LIMIT) && (c > MAX_VALUE % 10)))
+      return false;
+    v = v * 10 + c;
+  }
+  value = v;
+
+  return true;
+}
+
+/* the hex digits from r on, that follow the eight of v, found to their end and converted */
+static bool long_hex(uint64_t v, const char *r, uint64_t& value)
+{
+  const char *d;
+  unsigned n;
+
+  for (d = r; digit_value(*d) < 16; d++)
+    ;
+  n = unsigned(d - r);
+  if (*d || (n > 8))
+    return false;
+#if NUMBERPARSER_SWAR
+  if (n == 8)
+    v = (v << 32) | hex8(r);
+  else
+#endif
+    for (; n; n--)
+      v = (v << 4) | digit_value(*r++);
+  value = v;
+
+  return true;
+}
+
+/*
+ * plain decimal digits up to 64 bits, false for everything else: up to eight are checked and converted in one
+ * pass, a longer number is found to its end first and then converted anew in words of eight
+ */
+static inline bool plain_decimal(const char *p, uint64_t& value)
+{
+  const char *d;
+  uint64_t v = 0;
+  unsigned c;
+
+  for (d = p; (c = (unsigned char)(*d - '0')) < 10; d++)
+  {
+    if (d == p + 8)
+      return long_decimal(p, d, value);
+    v = v * 10 + c;
+  }
+  if (*d || (d == p))
+    return false;
+  value = v;
+
+  return true;
+}
+
+/* plain hex digits up to 64 bits, false for everything else, like plain_decimal() */
+static inline bool plain_hex(const char *p, uint64_t& value)
+{
+  const char *d;
+  uint64_t v = 0;
+  unsigned c;
+
+  for (d = p; (c = digit_value(*d)) < 16; d++)
+  {
+    if (d == p + 8)
+      return long_hex(v, d, value);
+    v = (v << 4) | c;
+  }
+  if (*d || (d == p))
+    return false;
+  value = v;
+
+  return true;
+}
+
+NumberParser::Status NumberParser::parse(const char *s, uint64_t& value, bool hex)
+{
+  const char *p = s;
+  bool h = hex;
+
+  /* the usual numbers take the short way */
+  if ((p[0] == '0') && ((p[1] | 0x20) == 'x'))
+  {
+    p += 2;
+    h = true;
+  }
+  if (h ? plain_hex(p, value) : plain_decimal(p, value))
+    return VALID;
+
+  return parse_general(s, value, hex);
+}
+
+NumberParser::Status NumberParser::parse(const char *s, int64_t& value, bool hex)
+{
+  uint64_t magnitude;
+  Status status = parse(s, magnitude, hex);
+  bool negative = (*s == '-');
+  uint64_t limit = negative ? (uint64_t(1) << 63) : (uint64_t(1) << 63) - 1;
+
+  if (negative && (status != OUT_OF_RANGE))
+    magnitude = 0 - magnitude;
+  if (magnitude > limit)
+  {
+    magnitude = limit;
+    status = OUT_OF_RANGE;
+  }
+  value = negative ? int64_t(0 - magnitude) : int64_t(magnitude);
+
+  return status;
+}
@@ -0,0 +1,46 @@
+/*
+ * NumberParser.h
+ *
+ */
+
+#ifndef NUMBERPARSER_H_
+#define NUMBERPARSER_H_
+
+#include <stdint.h>
+
+/***
+ * Wandelt Zahlen aus Kommandozeilen in 64-Bit-Werte, mit Prüfung von Syntax und Wertebereich.
+ *
+ * Die Syntax ist [+|-][0x|0X|0b|0B|0o|0O]<Ziffern>[k|K|M]:
+ * - ohne Präfix dezimal (hexadezimal, wenn hex gesetzt ist, dann gelten 0b und 0o nicht)
+ * - '_' trennt Ziffern zur besseren Lesbarkeit, z.B. 0x1234_5678 oder 1_000_000
+ * - k oder K multipliziert mit 1024, M mit 1024 * 1024
+ *
+ * Einfache Dezimal- und Hexzahlen (ohne Vorzeichen, Trenner und Suffix) nehmen einen kurzen Weg: bis zu acht
+ * Ziffern werden in einem Durchgang geprüft und umgerechnet, längere Zahlen auf Little-Endian-Zielen mit
+ * 64-Bit-Arithmetik zu je acht auf einmal (SWAR). Die übrige Syntax wird Ziffer für Ziffer umgerechnet.
+ */
+class NumberParser
+{
+public:
+  enum Status
+  {
+    VALID, /* der ganze Text ist eine Zahl */
+    EMPTY, /* leerer Text, der Wert ist 0 */
+    INVALID, /* keine Ziffern oder Zeichen dahinter, der Wert ist der der Ziffern bis dahin */
+    OUT_OF_RANGE /* der Wert ist der größte (bzw. kleinste) darstellbare */
+  };
+
+  /***
+   * Wandelt s in einen vorzeichenlosen Wert, negative Zahlen werden wie bei strtoull() im
+   * Zweierkomplement geliefert.
+   */
+  static Status parse(const char *s, uint64_t& value, bool hex = false);
+
+  /***
+   * Wandelt s in einen vorzeichenbehafteten Wert.
+   */
+  static Status parse(const char *s, int64_t& value, bool hex = false);
+};
+
+#endif /* NUMBERPARSER_H_ */
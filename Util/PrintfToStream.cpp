@@ -21,8 +21,18 @@
 //lint -esym(766, stdio.h)
 
 #include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "PrintfToStream.h"
+#include "FloatFormat.h"
+
+/* the exact float formatting or with PRINTF_FLOAT_FIXED the small one */
+#ifdef PRINTF_FLOAT_FIXED
+#define PRINTF_FORMAT_FLOAT FloatFormat::formatFixed
+#else
+#define PRINTF_FORMAT_FLOAT FloatFormat::format
+#endif
 
 PrintfToStream::PrintfToStream(ByteStream& stream)
 : ByteStreamDecorator(stream)
@@ -55,34 +65,30 @@ PrintfToStream::PrintfToStream(ByteStream& stream)
 #define PAD_16BIT   16
 #define PAD_32BIT   32
 #define PAD_64BIT   64
-#define PAD_LONG    128
+#define PAD_PREFIX  128
 
 int PrintfToStream::prints(const char *string, unsigned width, unsigned pad)
 {
-  register int pc = 0, padchar = ' ';
+  return printn(string, strlen(string), width, pad);
+}
 
-  if (width > 0)
-  {
-    register unsigned len = 0;
-    register const char *ptr;
-    for (ptr = string; *ptr; ++ptr)
-    {
-      ++len;
-    }
+/* the text in one block, only the padding character by character */
+int PrintfToStream::printn(const char *string, unsigned len, unsigned width, unsigned pad)
+{
+  register int pc = len, padchar = ' ';
 
-    if (len >= width)
-    {
-      width = 0;
-    }
-    else
-    {
-      width -= len;
-    }
+  if (len >= width)
+  {
+    width = 0;
+  }
+  else
+  {
+    width -= len;
+  }
 
-    if (pad & PAD_ZERO)
-    {
-      padchar = '0';
-    }
+  if (pad & PAD_ZERO)
+  {
+    padchar = '0';
   }
   if (!(pad & PAD_RIGHT))
   {
@@ -92,11 +98,7 @@ int PrintfToStream::prints(const char *string, unsigned width, unsigned pad)
       ++pc;
     }
   }
-  for (; *string; ++string)
-  {
-    put_char(*string);
-    ++pc;
-  }
+  ByteStream::writeBlock(string, len);
   for (; width > 0; --width)
   {
     put_char(padchar);
@@ -107,59 +109,150 @@ int PrintfToStream::prints(const char *string, unsigned width, unsigned pad)
 }
 
 //****************************************************************************
-/* the following should be enough for int on 64 and 32 bit arch */
-#define PRINT_BUF_LEN (sizeof(intptr_t) == 8 ? 22 : 12)
+/* 20 decimal digits of a 64 bit value, the sign or "0x" and the termination */
+#define PRINT_BUF_LEN 24
+
+static const char DIGIT_PAIRS[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+static const char HEX_DIGITS[2][17] = { "0123456789abcdef", "0123456789ABCDEF" };
+
+/* the decimal digits of u in front of s, two per step, the divisions by the constant 100 are multiplications */
+static char *utoa10(char *s, uint32_t u)
+{
+  while (u >= 100)
+  {
+    uint32_t q = u / 100;
+
+    s -= 2;
+    memcpy(s, DIGIT_PAIRS + 2 * (u - q * 100), 2);
+    u = q;
+  }
+  if (u >= 10)
+  {
+    s -= 2;
+    memcpy(s, DIGIT_PAIRS + 2 * u, 2);
+  }
+  else
+  {
+    *--s = '0' + u;
+  }
+
+  return s;
+}
+
+/* exactly 8 decimal digits of u < 10^8 in front of s */
+static char *utoa10_8(char *s, uint32_t u)
+{
+  for (int i = 0; i < 4; i++)
+  {
+    uint32_t q = u / 100;
+
+    s -= 2;
+    memcpy(s, DIGIT_PAIRS + 2 * (u - q * 100), 2);
+    u = q;
+  }
+
+  return s;
+}
+
+/* 64 bit values are split into parts of 8 digits, at most two 64 bit divisions */
+static char *utoa10(char *s, uint64_t u)
+{
+  while (u >> 32)
+  {
+    uint64_t q = u / 100000000u;
+
+    s = utoa10_8(s, uint32_t(u - q * 100000000u));
+    u = q;
+  }
+
+  return utoa10(s, uint32_t(u));
+}
+
+/* the hex digits of u in front of s, one nibble per step, the high word only if needed */
+static char *utoa16(char *s, uint64_t u, const char *digits)
+{
+  uint32_t w = uint32_t(u);
+
+  if (u >> 32)
+  {
+    for (int i = 0; i < 8; i++, w >>= 4)
+      *--s = digits[w & 15];
+    w = uint32_t(u >> 32);
+  }
+  do
+  {
+    *--s = digits[w & 15];
+    w >>= 4;
+  } while (w);
+
+  return s;
+}
 
 /***
  * print an integer
- * @param i integer to print
- * @param base base to use for print
+ * @param u integer to print, two's complement if signed
+ * @param base base to use for print, 10 and 16 without division, others from 8 up with one per digit
  * @param sign integer is signed
  * @param width minimum print width
  * @param pad pad flags
- * @param letbase
+ * @param letterBase 'a' or 'A' for the hex digits
  * @return
  */
-int PrintfToStream::printi(intptr_t i, int base, int sign, int width, int pad, int letterBase)
+int PrintfToStream::printi(uint64_t u, int base, int sign, int width, int pad, int letterBase)
 {
   char print_buf[PRINT_BUF_LEN];
   register char *s;
-  register int t, neg = 0, pc = 0;
-  register uintptr_t u = i;
-
-  if (i == 0)
-  {
-    print_buf[0] = '0';
-    print_buf[1] = '\0';
-    return prints(print_buf, width, pad);
-  }
+  register int pc = 0, neg = 0;
 
-  if (0 == (pad & PAD_LONG))
-  {
-    i = (int)i;
-    u = (unsigned int)u;
-  }
-
-  if (sign && base == 10 && i < 0)
+  if (sign && (int64_t)u < 0)
   {
     neg = 1;
-    u = (uintptr_t) -i;
+    u = 0 - u;
   }
 
   //  make sure print_buf is NULL-term
   s = print_buf + PRINT_BUF_LEN - 1;
   *s = '\0';
 
-  while (u)
+  if (base == 10)
+  {
+    s = utoa10(s, u);
+  }
+  else if (base == 16)
   {
-    t = u % base; //lint !e573  Warning 573: Signed-unsigned mix with divide
-    if (t >= 10)
-      t += letterBase - '0' - 10;
-    *--s = t + '0';
-    u /= base; //lint !e573  Warning 573: Signed-unsigned mix with divide
+    s = utoa16(s, u, HEX_DIGITS[letterBase == 'A']);
+  }
+  else
+  {
+    do
+    {
+      int t = u % base;
+      if (t >= 10)
+        t += letterBase - '0' - 10;
+      *--s = t + '0';
+      u /= base;
+    } while (u);
   }
 
-  if (neg)
+  if (pad & PAD_PREFIX)
+  {
+    if (width && (pad & PAD_ZERO))
+    {
+      put_char('0');
+      put_char(letterBase + 'x' - 'a');
+      pc += 2;
+      width = (width > 2) ? width - 2 : 0;
+    }
+    else
+    {
+      *--s = letterBase + 'x' - 'a';
+      *--s = '0';
+    }
+  }
+  else if (neg)
   {
     if (width && (pad & PAD_ZERO))
     {
@@ -172,97 +265,44 @@ int PrintfToStream::printi(intptr_t i, int base, int sign, int width, int pad, i
       *--s = '-';
     }
   }
-  else
+  else if (sign && (pad & PAD_PLUS))
   {
-    if (pad & PAD_PLUS)
-    {
-      *--s = '+';
-    }
+    *--s = '+';
   }
 
-  return pc + prints(s, width, pad);
+  return pc + printn(s, print_buf + PRINT_BUF_LEN - 1 - s, width, pad);
 }
 
 //****************************************************************************
-//  This version returns the length of the output string.
-//  It is more useful when implementing a walking-string function.
-//****************************************************************************
-unsigned PrintfToStream::dbl2stri(double dbl, unsigned width, unsigned dec_digits, int pad)
+/***
+ * print a double
+ * @param value double to print
+ * @param conversion 'f', 'e' or 'g', upper case for 'E' and "INF"
+ * @param precision digits after the point (significant ones for 'g'), the shortest exact ones if negative
+ * @param width minimum print width
+ * @param pad pad flags
+ * @return
+ */
+int PrintfToStream::printd(double value, char conversion, int precision, int width, int pad)
 {
+  char print_buf[FloatFormat::BUFFER_SIZE];
+  const char *s = print_buf;
   int pc = 0;
-  int sign = 1;
+  unsigned len = PRINTF_FORMAT_FLOAT(print_buf, value, conversion, precision, (pad & PAD_PLUS) != 0);
 
-  //*******************************************
-  //  extract negative info
-  //*******************************************
-  if (dbl < 0.0)
+  if (!(value - value == 0))
   {
-    dbl *= -1.0;
-    sign = -1;
+    pad &= ~PAD_ZERO; /* inf and nan */
   }
-
-  //**************************************************************************
-  //  construct fractional multiplier for specified number of digits.
-  //**************************************************************************
-  uint mult = 1;
-  uint idx;
-  for (idx = 0; idx < dec_digits; idx++)
+  if (width && (pad & PAD_ZERO) && ((*s == '-') || (*s == '+')))
   {
-    mult *= 10;
-  }
-
-  uint wholeNum = (uint) dbl;
-  uint decimalNum = (uint) (((dbl - wholeNum) * mult) + 0.5); // handle rounding by adding 0.5 LSB
-
-  if (decimalNum >= mult)
-  {
-    decimalNum -= mult;
-    wholeNum++;
-  }
-
-  //*******************************************
-  //  convert integer portion
-  //*******************************************
-  int intWidth;
-  intWidth = width - dec_digits;
-  if (dec_digits > 0)
-  {
-    if (pad & PAD_RIGHT)
-    {
-      intWidth = 0;
-    }
-    else
-    {
-      intWidth -= 1;
-      if (intWidth < 0)
-      {
-        intWidth = 0;
-      }
-    }
-  }
-  pc = printi(wholeNum * sign, 10, 1, intWidth, pad, 'a');
-  if (dec_digits > 0)
-  {
-    put_char('.');
-    pc++;
-
-    if (pad & PAD_RIGHT)
-    {
-      dec_digits = width - pc;
-      pad = PAD_RIGHT;
-    }
-    else
-    {
-      pad = PAD_ZERO;
-    }
-
-    //*******************************************
-    //  convert fractional portion
-    //*******************************************
-    pc += printi(decimalNum, 10, 0, dec_digits, pad, 'a');
+    put_char(*s++);
+    ++pc;
+    --len;
+    --width;
   }
 
-  return pc;
+  return pc + printn(s, len, width, pad);
 }
 
 //****************************************************************************
@@ -272,13 +312,16 @@ int PrintfToStream::vprintf(const char *format, va_list args)
   register int pc = 0;
   char scr[2];
   unsigned dec_width = 0;
-  int post_decimal, isLong;
+  int post_decimal;
+  enum { LENGTH_INT, LENGTH_LONG, LENGTH_LLONG, LENGTH_SIZE, LENGTH_PTRDIFF, LENGTH_MAX } length;
+  uint64_t value;
   for (; *format != 0; ++format)
   {
     if (*format == '%')
     {
       ++format;
-      width = pad = isLong = 0;
+      width = pad = 0;
+      length = LENGTH_INT;
       if (*format == '\0')
         break;
       if (*format == '%')
@@ -303,7 +346,7 @@ int PrintfToStream::vprintf(const char *format, va_list args)
         pad |= PAD_ZERO;
       }
       post_decimal = 0;
-      if (*format == '.' || (*format >= '0' && *format <= '9'))
+      if (*format == '.' || *format == '*' || (*format >= '0' && *format <= '9'))
       {
         while (1)
         {
@@ -327,18 +370,64 @@ int PrintfToStream::vprintf(const char *format, va_list args)
             }
             format++;
           }
+          else if (*format == '*')
+          {
+            /* width or precision from the arguments */
+            int v = va_arg(args, int);
+
+            if (post_decimal)
+            {
+              post_decimal = (v >= 0); /* a negative precision is none */
+              dec_width = (v >= 0) ? v : 0;
+            }
+            else
+            {
+              if (v < 0)
+              {
+                pad |= PAD_RIGHT;
+                v = -v;
+              }
+              width = v;
+            }
+            format++;
+          }
           else
           {
             break;
           }
         }
       }
-      if ((*format == 't') || (*format == 'l'))
+      switch (*format)
       {
+      case 'l':
+        if (*++format == 'l')
+        {
+          ++format;
+          length = LENGTH_LLONG;
+        }
+#ifndef PRINTF_NO_LONG
+        else
+          length = LENGTH_LONG;
+#endif
+        break;
+      case 't':
         ++format;
 #ifndef PRINTF_NO_LONG
-        isLong = 1;
+        length = LENGTH_PTRDIFF;
 #endif
+        break;
+      case 'z':
+        ++format;
+        length = LENGTH_SIZE;
+        break;
+      case 'j':
+        ++format;
+        length = LENGTH_MAX;
+        break;
+      case 'h': /* short and char are converted to int then pushed on the stack */
+        if (*++format == 'h')
+          ++format;
+        break;
       }
       switch (*format)
       {
@@ -346,32 +435,49 @@ int PrintfToStream::vprintf(const char *format, va_list args)
         {
           // char *s = *((char **) varg++);   //lint !e740
           /*register*/ char *s = va_arg(args, char*); //lint !e740 !e826  convert to double pointer
-          pc += prints(s ? s : "(null)", width, pad);
+          unsigned len;
+
+          if (!s)
+            s = (char*)"(null)";
+          /* a precision limits the characters of the string */
+          for (len = 0; s[len] && (!post_decimal || (len < dec_width)); len++)
+            ;
+          pc += printn(s, len, width, pad);
         }
         break;
       case 'd':
-        if (!isLong)
-          pc += printi(va_arg(args, int), 10, 1, width, pad, 'a');
-        else
-          pc += printi(va_arg(args, long), 10, 1, width, pad | PAD_LONG, 'a');
+      case 'i':
+        switch (length)
+        {
+        case LENGTH_INT: value = va_arg(args, int); break;
+        case LENGTH_LONG: value = va_arg(args, long); break;
+        case LENGTH_LLONG: value = va_arg(args, long long); break;
+        case LENGTH_SIZE: /* the signed type of size_t */
+        case LENGTH_PTRDIFF: value = va_arg(args, ptrdiff_t); break;
+        case LENGTH_MAX: value = va_arg(args, intmax_t); break;
+        }
+        pc += printi(value, 10, 1, width, pad, 'a');
         break;
+      case 'u':
       case 'x':
-        if (!isLong)
-          pc += printi(va_arg(args, int), 16, 0, width, pad, 'a');
-        else
-          pc += printi(va_arg(args, long), 16, 0, width, pad | PAD_LONG, 'a');
-        break;
       case 'X':
-        if (!isLong)
-          pc += printi(va_arg(args, int), 16, 0, width, pad, 'A');
+        switch (length)
+        {
+        case LENGTH_INT: value = va_arg(args, unsigned int); break;
+        case LENGTH_LONG: value = va_arg(args, unsigned long); break;
+        case LENGTH_LLONG: value = va_arg(args, unsigned long long); break;
+        case LENGTH_SIZE: value = va_arg(args, size_t); break;
+        case LENGTH_PTRDIFF: value = size_t(va_arg(args, ptrdiff_t)); break;
+        case LENGTH_MAX: value = va_arg(args, uintmax_t); break;
+        }
+        if (*format == 'u')
+          pc += printi(value, 10, 0, width, pad, 'a');
         else
-          pc += printi(va_arg(args, long), 16, 0, width, pad | PAD_LONG, 'A');
+          pc += printi(value, 16, 0, width, pad, (*format == 'x') ? 'a' : 'A');
         break;
-      case 'u':
-        if (!isLong)
-          pc += printi(va_arg(args, unsigned int), 10, 0, width, pad, 'a');
-        else
-          pc += printi(va_arg(args, unsigned long), 10, 0, width, pad | PAD_LONG, 'a');
+      case 'p':
+        value = (uintptr_t)va_arg(args, void*);
+        pc += printi(value, 16, 0, width, pad | PAD_PREFIX, 'a');
         break;
       case 'c':
         /* char are converted to int then pushed on the stack */
@@ -381,10 +487,12 @@ int PrintfToStream::vprintf(const char *format, va_list args)
         break;
 
       case 'f':
-        {
-          double dbl = va_arg(args, double); //lint !e740 !e826  convert to double pointer
-          pc += dbl2stri(dbl, width, dec_width, pad);
-        }
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+        pc += printd(va_arg(args, double), *format, post_decimal ? int(dec_width) : -1, width, pad);
         break;
 
       default:
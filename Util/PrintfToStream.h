@@ -17,7 +17,18 @@
  * hinzufügt.
  *
  * Die Klasse unterstützt folgende Formate:
- * %s, %d, %x, %X, %u, %c, %f
+ * %s, %d, %i, %x, %X, %u, %c, %f, %F, %e, %E, %g, %G, %p
+ *
+ * Eine Genauigkeit bei %s (z.B. "%.32s") begrenzt die Anzahl der ausgegebenen Zeichen. Breite und
+ * Genauigkeit können mit '*' aus den Argumenten kommen.
+ *
+ * Ganzzahlen werden bis 64 Bit mit den Längenangaben l, ll, z, j und t ausgegeben (h und hh werden
+ * überlesen). Dezimalzahlen werden zweistellig über eine Tabelle umgewandelt, Hexzahlen über eine Tabelle
+ * der Nibbles, ohne Division je Stelle.
+ *
+ * Gleitkommazahlen werden mit FloatFormat formatiert, mit Genauigkeit korrekt gerundet, ohne Genauigkeit
+ * in der kürzesten Darstellung, die wieder genau den Wert ergibt (z.B. "%f" von 0.1 ist 0.1). Mit
+ * PRINTF_FLOAT_FIXED wird die kleinere Festkomma-Variante verwendet.
  */
 
 class PrintfToStream: public ByteStreamDecorator
@@ -44,8 +55,9 @@ protected:
   typedef unsigned int uint;
 
   int prints(const char *string, unsigned width, unsigned pad);
-  int printi(intptr_t i, int base, int sign, int width, int pad, int letterBase);
-  unsigned dbl2stri(double dbl, unsigned width, unsigned dec_digits, int pad);
+  int printn(const char *string, unsigned len, unsigned width, unsigned pad);
+  int printi(uint64_t u, int base, int sign, int width, int pad, int letterBase);
+  int printd(double value, char conversion, int precision, int width, int pad);
 
 };
 
@@ -0,0 +1,102 @@
+/*
+ * RecordingByteStream.cpp
+ *
+ */
+
+#include "RecordingByteStream.h"
+
+RecordingByteStream::RecordingByteStream(ByteStream& lower, ByteStream& recording, TickFunction_t tickFunction, uint32_t ticksPerSecond)
+: ByteStreamDecorator(lower), rec(recording), tick(tickFunction), lastTicks(0), chunkTicks(0), chunkType(0), chunkLen(0)
+{
+  unsigned char header[8] = { 'T', 'S', 'R', '1',
+      (unsigned char)ticksPerSecond, (unsigned char)(ticksPerSecond >> 8), (unsigned char)(ticksPerSecond >> 16), (unsigned char)(ticksPerSecond >> 24) };
+
+  rec.writeBlock(header, sizeof(header));
+  lastTicks = tick ? tick() : 0;
+}
+
+RecordingByteStream::~RecordingByteStream()
+{
+  flush();
+}
+
+void RecordingByteStream::putVarint(uint32_t v)
+{
+  unsigned char buf[5];
+  unsigned n = 0;
+
+  while (v >= 0x80)
+  {
+    buf[n++] = (unsigned char)(v | 0x80);
+    v >>= 7;
+  }
+  buf[n++] = (unsigned char)v;
+
+  rec.writeBlock(buf, n);
+}
+
+void RecordingByteStream::flush()
+{
+  if (chunkLen)
+  {
+    rec.write(chunkType);
+    putVarint(chunkTicks - lastTicks);
+    putVarint(chunkLen);
+    rec.writeBlock(chunk, chunkLen);
+    lastTicks = chunkTicks;
+    chunkLen = 0;
+  }
+}
+
+void RecordingByteStream::record(unsigned char type, const unsigned char *b, unsigned numBytes)
+{
+  while (numBytes)
+  {
+    if ((chunkLen == sizeof(chunk)) || (chunkLen && (type != chunkType)))
+      flush();
+
+    if (!chunkLen)
+    {
+      chunkType = type;
+      chunkTicks = tick ? tick() : 0;
+    }
+
+    while (numBytes && (chunkLen < sizeof(chunk)))
+    {
+      chunk[chunkLen++] = *b++;
+      numBytes--;
+    }
+  }
+}
+
+unsigned RecordingByteStream::write(unsigned char b)
+{
+  unsigned n = backendIo.write(b);
+
+  record(OUTPUT, &b, n);
+  return n;
+}
+
+unsigned RecordingByteStream::writeBlock(const unsigned char *b, unsigned numBytes)
+{
+  unsigned n = backendIo.writeBlock(b, numBytes);
+
+  record(OUTPUT, b, n);
+  return n;
+}
+
+unsigned RecordingByteStream::read(unsigned char &b)
+{
+  unsigned n = backendIo.read(b);
+
+  record(INPUT, &b, n);
+  return n;
+}
+
+unsigned RecordingByteStream::readBlock(unsigned char *b, unsigned numBytes)
+{
+  unsigned n = backendIo.readBlock(b, numBytes);
+
+  record(INPUT, b, n);
+  return n;
+}
@@ -0,0 +1,64 @@
+/*
+ * RecordingByteStream.h
+ *
+ */
+
+#ifndef RECORDINGBYTESTREAM_H_
+#define RECORDINGBYTESTREAM_H_
+
+#include "ByteStreamDecorator.h"
+#include <stdint.h>
+
+#ifndef RECORDING_CHUNK_SIZE
+#define RECORDING_CHUNK_SIZE 32
+#endif
+
+/***
+ * Dieser Decorator zeichnet die Eingabe- und Ausgabe-Bytes einer Sitzung mit Zeitstempeln in einen
+ * zweiten ByteStream (die Aufzeichnung) auf, z.B. eine Datei oder einen RAM-Puffer. Aus der
+ * Aufzeichnung kann die Sitzung später wiedergegeben werden (bench/replay.cpp).
+ *
+ * Format der Aufzeichnung:
+ * - Kopf: "TSR1", dann ticksPerSecond als uint32 little endian
+ * - danach Records: Typ ('<' Eingabe, '>' Ausgabe), Ticks seit dem vorigen Record als varint,
+ *   Anzahl Bytes als varint, die Bytes
+ *
+ * Aufeinander folgende Bytes einer Richtung werden bis zu RECORDING_CHUNK_SIZE Bytes in einem Record
+ * zusammengefasst, der Zeitstempel gilt für das erste Byte. Aufgezeichnet wird nur, was der
+ * darunter liegende Stream tatsächlich angenommen bzw. geliefert hat.
+ *
+ * @note die Aufzeichnung soll nicht blockieren; was sie nicht annimmt, geht verloren.
+ */
+class RecordingByteStream: public ByteStreamDecorator
+{
+public:
+  typedef uint32_t (*TickFunction_t)(void);
+
+  static const unsigned char INPUT = '<';
+  static const unsigned char OUTPUT = '>';
+
+  RecordingByteStream(ByteStream& lowerStream, ByteStream& recording, TickFunction_t tickFunction, uint32_t ticksPerSecond);
+  virtual ~RecordingByteStream();
+
+  virtual unsigned write(unsigned char b);
+  virtual unsigned writeBlock(const unsigned char *b, unsigned int numBytes);
+  virtual unsigned read(unsigned char &b);
+  virtual unsigned readBlock(unsigned char *b, unsigned int numBytes);
+
+  /* schreibt den angefangenen Record in die Aufzeichnung */
+  void flush();
+
+protected:
+  void record(unsigned char type, const unsigned char *b, unsigned numBytes);
+  void putVarint(uint32_t v);
+
+  ByteStream& rec;
+  TickFunction_t tick;
+  uint32_t lastTicks;
+  uint32_t chunkTicks;
+  unsigned char chunkType;
+  unsigned chunkLen;
+  unsigned char chunk[RECORDING_CHUNK_SIZE];
+};
+
+#endif /* RECORDINGBYTESTREAM_H_ */
@@ -0,0 +1,70 @@
+/*
+ * LoopbackByteStream.h
+ *
+ */
+
+#ifndef LOOPBACKBYTESTREAM_H_
+#define LOOPBACKBYTESTREAM_H_
+
+#include "ByteStream.h"
+
+#include <string>
+
+/**
+ * In-memory ByteStream for the benchmarks: read() delivers the queued input,
+ * the output is counted and optionally kept.
+ */
+class LoopbackByteStream: public ByteStream
+{
+public:
+  LoopbackByteStream()
+  : inPos(0), written(0), keep(false)
+  {}
+
+  virtual unsigned write(unsigned char b)
+  {
+    written++;
+    if (keep)
+      output += (char)b;
+    return 1;
+  }
+
+  virtual unsigned writeBlock(const unsigned char *b, unsigned numBytes)
+  {
+    written += numBytes;
+    if (keep)
+      output.append((const char*)b, numBytes);
+    return numBytes;
+  }
+
+  virtual unsigned read(unsigned char &b)
+  {
+    if (inPos < input.size())
+    {
+      b = input[inPos++];
+      return 1;
+    }
+    input.clear();
+    inPos = 0;
+    return 0;
+  }
+
+  /* queue input for the shell */
+  void push(const std::string& s)
+  {
+    input += s;
+  }
+
+  bool inputPending() const
+  {
+    return inPos < input.size();
+  }
+
+  std::string input;
+  std::string::size_type inPos;
+  unsigned long long written;
+  bool keep;
+  std::string output;
+};
+
+#endif /* LOOPBACKBYTESTREAM_H_ */
@@ -0,0 +1,167 @@
+/*
+ * SessionReplay.cpp
+ *
+ */
+
+#include "SessionReplay.h"
+#include "LoopbackByteStream.h"
+
+#include "Util/RecordingByteStream.h"
+
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+
+SessionReplay::SessionReplay()
+: ticksPerSecond(0)
+{}
+
+bool SessionReplay::load(const char *fileName, std::string& error)
+{
+  FILE *f = fopen(fileName, "rb");
+  std::string data;
+  char buf[4096];
+  size_t n;
+
+  if (!f)
+  {
+    error = std::string("cannot open ") + fileName;
+    return false;
+  }
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.append(buf, n);
+  fclose(f);
+
+  return parse(data, error);
+}
+
+static bool getVarint(const std::string& data, size_t& pos, uint32_t& v)
+{
+  unsigned shift = 0;
+
+  v = 0;
+  while ((pos < data.size()) && (shift < 35))
+  {
+    unsigned char b = data[pos++];
+    v |= (uint32_t)(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return true;
+    shift += 7;
+  }
+
+  return false;
+}
+
+bool SessionReplay::parse(const std::string& data, std::string& error)
+{
+  size_t pos = 8;
+  uint64_t now = 0;
+
+  records.clear();
+  expectedOutput.clear();
+
+  if ((data.size() < 8) || (data.compare(0, 4, "TSR1") != 0))
+  {
+    error = "not a session recording";
+    return false;
+  }
+  ticksPerSecond = (unsigned char)data[4] | ((unsigned char)data[5] << 8) | ((unsigned char)data[6] << 16) | ((uint32_t)(unsigned char)data[7] << 24);
+
+  while (pos < data.size())
+  {
+    Record r;
+    uint32_t delta, len;
+
+    r.type = data[pos++];
+    if (((r.type != RecordingByteStream::INPUT) && (r.type != RecordingByteStream::OUTPUT))
+        || !getVarint(data, pos, delta) || !getVarint(data, pos, len) || (data.size() - pos < len))
+    {
+      error = "recording is corrupt or truncated";
+      return false;
+    }
+    now += delta;
+    r.ticks = now;
+    r.bytes.assign(data, pos, len);
+    pos += len;
+
+    if (r.type == RecordingByteStream::OUTPUT)
+      expectedOutput += r.bytes;
+    records.push_back(r);
+  }
+
+  return true;
+}
+
+SessionReplay::Result SessionReplay::run(Shell::TinyShBase& shell, bool paced, bool prompt) const
+{
+  typedef std::chrono::steady_clock Clock;
+
+  LoopbackByteStream io;
+  Result result;
+  LineTime current;
+  Clock::time_point start = Clock::now();
+  size_t i, k;
+
+  io.keep = true;
+  shell.setIo(io);
+  result.totalSeconds = 0;
+  current.seconds = 0;
+
+  if (prompt)
+    shell.triggerPrompt();
+
+  for (i = 0; i < records.size(); i++)
+  {
+    const Record& r = records[i];
+
+    if (r.type != RecordingByteStream::INPUT)
+      continue;
+
+    if (paced && ticksPerSecond)
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(double(r.ticks) / ticksPerSecond)));
+
+    for (k = 0; k < r.bytes.size(); k++)
+    {
+      char c = r.bytes[k];
+      Clock::time_point t = Clock::now();
+
+      io.push(std::string(1, c));
+      while (io.inputPending() || shell.isBusy())
+        shell.checkInput();
+
+      double s = std::chrono::duration<double>(Clock::now() - t).count();
+      result.totalSeconds += s;
+      current.seconds += s;
+      if ((c == '\r') || (c == '\n'))
+      {
+        result.lines.push_back(current);
+        current.line.clear();
+        current.seconds = 0;
+      }
+      else if (((unsigned char)c >= ' ') && ((unsigned char)c < 127))
+      {
+        current.line += c;
+      }
+      else
+      {
+        char esc[8];
+        snprintf(esc, sizeof(esc), "^%c", (c == 127) ? '?' : c + '@');
+        current.line += esc;
+      }
+    }
+  }
+  if (!current.line.empty())
+    result.lines.push_back(current);
+
+  result.output = io.output;
+  result.mismatchAt = -1;
+  for (k = 0; (k < result.output.size()) && (k < expectedOutput.size()); k++)
+  {
+    if (result.output[k] != expectedOutput[k])
+      break;
+  }
+  if ((k < result.output.size()) || (k < expectedOutput.size()))
+    result.mismatchAt = (long)k;
+
+  return result;
+}
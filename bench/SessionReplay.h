@@ -0,0 +1,61 @@
+/*
+ * SessionReplay.h
+ *
+ */
+
+#ifndef SESSIONREPLAY_H_
+#define SESSIONREPLAY_H_
+
+#include "TinySh.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Replay of a session recorded with RecordingByteStream into a fresh TinySh.
+ *
+ * The input is fed at full speed or at the original pace, the output of the
+ * shell is compared byte for byte with the recorded output, and the
+ * processing time of every input line is measured. The shell must have the
+ * same command tree as the recorded one.
+ */
+class SessionReplay
+{
+public:
+  struct Record
+  {
+    unsigned char type; /* RecordingByteStream::INPUT or OUTPUT */
+    uint64_t ticks;     /* since the start of the recording */
+    std::string bytes;
+  };
+
+  struct LineTime
+  {
+    std::string line;
+    double seconds;
+  };
+
+  struct Result
+  {
+    double totalSeconds;
+    std::vector<LineTime> lines;
+    std::string output;
+    long mismatchAt; /* offset of the first differing output byte, -1 if equal */
+  };
+
+  SessionReplay();
+
+  /* read a recording, return false and set error, if it is not valid */
+  bool load(const char *fileName, std::string& error);
+  bool parse(const std::string& data, std::string& error);
+
+  /* feed the recorded input to the shell, paced: with the recorded timing, prompt: trigger the prompt first */
+  Result run(Shell::TinyShBase& shell, bool paced, bool prompt = false) const;
+
+  uint32_t ticksPerSecond;
+  std::vector<Record> records;
+  std::string expectedOutput;
+};
+
+#endif /* SESSIONREPLAY_H_ */
@@ -0,0 +1,1165 @@
+/*
+ * bench.cpp
+ *
+ * Benchmarks of the shell core, the printf formatter with its integer and float conversions, the number
+ * parser, the symbol table, the mem commands with the image loader and watch, running against an in-memory
+ * loopback stream.
+ *
+ * Every result is printed as one line "<name> <value> <unit>", in a fixed
+ * order, so the output of two releases can be compared with diff.
+ *
+ * usage: tinysh_bench [name filter]
+ */
+
+#include "LoopbackByteStream.h"
+
+#include "TinySh.h"
+#include "MemCommands.h"
+#include "SymbolCommands.h"
+#include "WatchCommand.h"
+#include "ShellClock.h"
+#include "Util/PrintfToStream.h"
+#include "Util/NumberParser.h"
+#include "Util/FloatFormat.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace Shell
+{
+  extern unsigned char *memCmdsBasePtr;
+}
+
+using namespace Shell;
+
+static const char *filter = 0;
+
+/* minimum run time of a measurement */
+static const double MIN_SECONDS = 0.2;
+
+static bool selected(const std::string& name)
+{
+  return !filter || (name.find(filter) != std::string::npos);
+}
+
+static void report(const std::string& name, double value, const char *unit)
+{
+  printf("%-40s %14.2f %s\n", name.c_str(), value, unit);
+  fflush(stdout);
+}
+
+/*
+ * run batch(n) with growing n, until it takes long enough,
+ * return the seconds per unit of work, batch returns the units done
+ */
+template<typename Batch>
+static double measure(Batch batch)
+{
+  unsigned long n = 1;
+
+  for (;;)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double units = batch(n);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (seconds >= MIN_SECONDS)
+      return seconds / units;
+
+    n *= (seconds < MIN_SECONDS / 16) ? 8 : 2;
+  }
+}
+
+/* process all queued input and run the jobs to their end */
+static void pump(TinyShBase& shell, LoopbackByteStream& io)
+{
+  while (io.inputPending() || shell.isBusy())
+    shell.checkInput();
+}
+
+static void cmd_nop(TinyShBase&, int, const char **)
+{
+}
+
+static const CommandDescription nopCmd = { "nop", "do nothing", "[args]", &cmd_nop, 0, 0, 0 };
+
+/*
+ * a level of count siblings c00000 ... plus a last one "zlast", kept as array
+ */
+class SiblingLevel
+{
+public:
+  explicit SiblingLevel(unsigned count)
+  : names(count), cmds(count + 1)
+  {
+    unsigned i;
+    char name[16];
+
+    for (i = 0; i <= count; i++)
+    {
+      if (i < count)
+      {
+        snprintf(name, sizeof(name), "c%05u", i);
+        names[i] = name;
+      }
+      CommandDescription& c = cmds[i];
+      c.name = (i < count) ? names[i].c_str() : "zlast";
+      c.help = "sibling";
+      c.usage = 0;
+      c.function = &cmd_nop;
+      c.arg = 0;
+      c.nextPtr = (i < count) ? (const CommandDescription*)~0 : 0;
+      c.child = 0;
+    }
+  }
+
+  CommandDescription* first()
+  {
+    return &cmds[0];
+  }
+
+private:
+  std::vector<std::string> names;
+  std::vector<CommandDescription> cmds;
+};
+
+/*
+ * the same level as packed tree, to be mounted below a group
+ */
+class PackedSiblingLevel
+{
+public:
+  explicit PackedSiblingLevel(unsigned count)
+  : nodes(count + 1)
+  {
+    unsigned i;
+    char name[16];
+    uint16_t help;
+
+    functions[0] = &cmd_nop;
+    args[0] = 0;
+    for (i = 0; i <= count; i++)
+    {
+      if (i < count)
+        snprintf(name, sizeof(name), "c%05u", i);
+      else
+        snprintf(name, sizeof(name), "zlast");
+      nodes[i].name = strings.size();
+      strings += name;
+      strings += '\0';
+    }
+    help = strings.size();
+    strings += "sibling";
+    for (i = 0; i <= count; i++)
+    {
+      nodes[i].help = help;
+      nodes[i].usage = PACKED_NONE;
+      nodes[i].next = (i < count) ? i + 1 : PACKED_NONE;
+      nodes[i].child = PACKED_NONE;
+      nodes[i].function = 0;
+      nodes[i].arg = PACKED_NO_INDEX;
+    }
+    tree.nodes = &nodes[0];
+    tree.strings = strings.c_str();
+    tree.functions = functions;
+    tree.args = args;
+  }
+
+  const PackedTree& packed() const
+  {
+    return tree;
+  }
+
+private:
+  std::vector<PackedNode> nodes;
+  std::string strings;
+  CommandFunction_t functions[1];
+  void *args[1];
+  PackedTree tree;
+};
+
+static void benchCharIn()
+{
+  const std::string line = "nop 12 34 56 78 abcdef\r";
+
+  if (selected("char_in/typed"))
+  {
+    LoopbackByteStream io;
+    TinySh shell;
+    shell.setIo(io);
+    shell.add_command(&nopCmd);
+
+    /* one character per poll, with an idle poll in between */
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+      {
+        for (char c : line)
+        {
+          io.push(std::string(1, c));
+          shell.checkInput();
+          shell.checkInput();
+        }
+      }
+      return double(n * line.size());
+    });
+    report("char_in/typed", s * 1e9, "ns/char");
+  }
+
+  if (selected("char_in/pasted"))
+  {
+    LoopbackByteStream io;
+    TinySh shell;
+    shell.setIo(io);
+    shell.add_command(&nopCmd);
+
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+        io.push(line);
+      pump(shell, io);
+      return double(n * line.size());
+    });
+    report("char_in/pasted", s * 1e9, "ns/char");
+  }
+
+  if (selected("char_in/feed"))
+  {
+    LoopbackByteStream io;
+    TinySh shell;
+    shell.setIo(io);
+    shell.add_command(&nopCmd);
+
+    std::string script;
+    unsigned i;
+    for (i = 0; i < 100; i++)
+      script += line;
+
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+        shell.feed(script.c_str());
+      return double(n * script.size());
+    });
+    report("char_in/feed", s * 1e9, "ns/char");
+  }
+}
+
+/* without history there is no memo of the resolved commands, every line is looked up */
+struct LookupPolicy: TinyShPolicy
+{
+  static const bool HISTORY = false;
+};
+
+static void benchLevels()
+{
+  static const unsigned counts[] = { 10, 100, 1000, 10000 };
+  unsigned k;
+
+  for (k = 0; k < sizeof(counts) / sizeof(counts[0]); k++)
+  {
+    char name[64];
+
+    snprintf(name, sizeof(name), "parse_command/siblings=%u", counts[k]);
+    if (selected(name))
+    {
+      SiblingLevel level(counts[k]);
+      LoopbackByteStream io;
+      BasicTinySh<LookupPolicy> shell;
+      shell.setIo(io);
+      shell.add_command(level.first());
+
+      /* the last sibling, the whole level is searched */
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        for (i = 0; i < n; i++)
+          io.push("zlast 1 2\r");
+        pump(shell, io);
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/line");
+    }
+
+    snprintf(name, sizeof(name), "parse_command/memo/siblings=%u", counts[k]);
+    if (selected(name))
+    {
+      SiblingLevel level(counts[k]);
+      LoopbackByteStream io;
+      TinySh shell;
+      shell.setIo(io);
+      shell.add_command(level.first());
+
+      /* the same command with other arguments, resolved by the memo of the previous line */
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        for (i = 0; i < n; i++)
+          io.push((i & 1) ? "zlast 1 2\r" : "zlast 3 4\r");
+        pump(shell, io);
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/line");
+    }
+
+    snprintf(name, sizeof(name), "complete_command_line/siblings=%u", counts[k]);
+    if (selected(name))
+    {
+      SiblingLevel level(counts[k]);
+      LoopbackByteStream io;
+      TinySh shell;
+      shell.setIo(io);
+      shell.add_command(level.first());
+
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        for (i = 0; i < n; i++)
+          io.push("zl\t\r");
+        pump(shell, io);
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/line");
+    }
+
+    snprintf(name, sizeof(name), "parse_command/packed/siblings=%u", counts[k]);
+    if (selected(name))
+    {
+      PackedSiblingLevel level(counts[k]);
+      CommandDescription group = { "p", "packed level", 0, 0, 0, 0, 0 };
+      LoopbackByteStream io;
+      BasicTinySh<LookupPolicy> shell;
+      shell.setIo(io);
+      shell.add_command(&group);
+      shell.add_command(level.packed(), &group);
+
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        for (i = 0; i < n; i++)
+          io.push("p zlast 1 2\r");
+        pump(shell, io);
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/line");
+    }
+  }
+
+  if (selected("footprint"))
+  {
+    report("footprint/CommandDescription", sizeof(CommandDescription), "bytes/node");
+    report("footprint/PackedNode", sizeof(PackedNode), "bytes/node");
+  }
+}
+
+/* resident memory of the process in bytes, 0 if unknown */
+static unsigned long residentBytes()
+{
+  unsigned long size = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+
+  if (f)
+  {
+    if (2 != fscanf(f, "%lu %lu", &size, &resident))
+      resident = 0;
+    fclose(f);
+  }
+
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+/* a gateway with many connections, only few of them have input at a time */
+struct GatewayPolicy: TinyShPolicy
+{
+  static const unsigned SESSION_POOL = 64;
+};
+
+/* the resident memory of many idle sessions, each one has seen its prompt */
+template<class Policy>
+static void benchIdleSessions(const char *name)
+{
+  static const unsigned COUNT = 10000;
+
+  if (!selected(name))
+    return;
+
+  LoopbackByteStream io;
+  unsigned long before = residentBytes();
+  BasicTinySh<Policy> *shells = new BasicTinySh<Policy>[COUNT];
+  unsigned i;
+
+  for (i = 0; i < COUNT; i++)
+  {
+    shells[i].setIo(io);
+    shells[i].add_command(&nopCmd);
+    shells[i].triggerPrompt();
+  }
+  report(name, double(residentBytes() - before) / COUNT, "bytes/session");
+
+  delete[] shells;
+}
+
+static void benchSessions()
+{
+  benchIdleSessions<TinyShPolicy>("sessions/idle/default");
+  benchIdleSessions<GatewayPolicy>("sessions/idle/pooled");
+
+  if (selected("sessions/active/pooled"))
+  {
+    /* a line typed and executed in each of a rotating set of sessions */
+    static const unsigned COUNT = 1000;
+    LoopbackByteStream io;
+    BasicTinySh<GatewayPolicy> *shells = new BasicTinySh<GatewayPolicy>[COUNT];
+    unsigned i;
+
+    for (i = 0; i < COUNT; i++)
+    {
+      shells[i].setIo(io);
+      shells[i].add_command(&nopCmd);
+    }
+
+    double s = measure([&](unsigned long n) {
+      unsigned long k;
+      for (k = 0; k < n; k++)
+      {
+        BasicTinySh<GatewayPolicy>& shell = shells[k % COUNT];
+        io.push("nop 1 2\r");
+        pump(shell, io);
+        shell.release();
+      }
+      return double(n);
+    });
+    report("sessions/active/pooled", s * 1e9, "ns/line");
+
+    delete[] shells;
+  }
+
+  if (selected("footprint"))
+  {
+    report("footprint/BasicTinySh<default>", sizeof(BasicTinySh<>), "bytes/session");
+    report("footprint/BasicTinySh<pooled>", sizeof(BasicTinySh<GatewayPolicy>), "bytes/session");
+    report("footprint/pooled_block", ShellBlockSize<GatewayPolicy>::VALUE, "bytes/active");
+  }
+}
+
+static void benchPrintf()
+{
+  LoopbackByteStream io;
+  PrintfToStream fio(io);
+
+#define BENCH_PRINTF(label, ...) \
+  if (selected("printf/" label)) \
+  { \
+    double s = measure([&](unsigned long n) { \
+      unsigned long i; \
+      for (i = 0; i < n; i++) \
+        fio.printf(__VA_ARGS__); \
+      return double(n); \
+    }); \
+    report("printf/" label, s * 1e9, "ns/call"); \
+  }
+
+  BENCH_PRINTF("%d", "%d", -123456)
+  BENCH_PRINTF("%u", "%u", 4000000000u)
+  BENCH_PRINTF("%x", "%x", 0xdeadbeefu)
+  BENCH_PRINTF("%08lx", "%08lx", 0x2000a3c0ul)
+  BENCH_PRINTF("%02x", "%02x", 0xa5)
+  BENCH_PRINTF("%s", "%s", "hello world")
+  BENCH_PRINTF("%-10s", "%-10s", "pad")
+  BENCH_PRINTF("%c", "%c", 'x')
+  BENCH_PRINTF("%.3f", "%.3f", 3.14159)
+  BENCH_PRINTF("%.6e", "%.6e", 6.02214076e23)
+  BENCH_PRINTF("%g", "%g", 23.456)
+  BENCH_PRINTF("%llu", "%llu", 18446744073709551615ull)
+  BENCH_PRINTF("%016llx", "%016llx", 0x0123456789abcdefull)
+  BENCH_PRINTF("%zu", "%zu", sizeof(PrintfToStream))
+  BENCH_PRINTF("%p", "%p", (void*)&fio)
+  BENCH_PRINTF("mixed", "0x%08lx: 0x%02x %s\n", 0x2000a3c0ul, 0x5a, "text")
+
+#undef BENCH_PRINTF
+}
+
+/* PrintfToStream with its integer conversion public and the one before the digit tables as reference,
+ * which wrote character by character */
+class IntegerPrintf: public PrintfToStream
+{
+public:
+  explicit IntegerPrintf(ByteStream& stream)
+  : PrintfToStream(stream)
+  {}
+
+  using PrintfToStream::printi;
+
+  /* one % and one / per digit with the base at run time, 64 bit only with PAD_LONG (128), without width */
+  int legacy_printi(intptr_t i, int base, int sign, int pad, int letterBase)
+  {
+    char print_buf[22];
+    char *s;
+    int t, neg = 0, pc = 0;
+    uintptr_t u = i;
+
+    if (i == 0)
+    {
+      put_char('0');
+      return 1;
+    }
+    if (0 == (pad & 128))
+    {
+      i = (int)i;
+      u = (unsigned int)u;
+    }
+    if (sign && base == 10 && i < 0)
+    {
+      neg = 1;
+      u = (uintptr_t) -i;
+    }
+    s = print_buf + sizeof(print_buf) - 1;
+    *s = '\0';
+    while (u)
+    {
+      t = u % base;
+      if (t >= 10)
+        t += letterBase - '0' - 10;
+      *--s = t + '0';
+      u /= base;
+    }
+    if (neg)
+      *--s = '-';
+    for (; *s; ++s)
+    {
+      put_char(*s);
+      ++pc;
+    }
+
+    return pc;
+  }
+};
+
+static void benchIntegers()
+{
+  static const struct
+  {
+    const char *label;
+    uint64_t value;
+    int base;
+    int sign;
+    const char *format; /* for snprintf */
+  } cases[] =
+  {
+    { "7", 7, 10, 1, "%lld" },
+    { "-123456", uint64_t(-123456), 10, 1, "%lld" },
+    { "4000000000", 4000000000u, 10, 0, "%llu" },
+    { "18446744073709551615", ~uint64_t(0), 10, 0, "%llu" },
+    { "0xff", 0xff, 16, 0, "%llx" },
+    { "0xdeadbeef", 0xdeadbeef, 16, 0, "%llx" },
+    { "0x0123456789abcdef", 0x0123456789abcdefull, 16, 0, "%llx" },
+  };
+  LoopbackByteStream io;
+  IntegerPrintf fio(io);
+  unsigned k;
+
+  for (k = 0; k < sizeof(cases) / sizeof(cases[0]); k++)
+  {
+    volatile uint64_t value = cases[k].value; /* read in every call */
+    std::string name;
+
+    name = std::string("integers/printi_legacy/") + cases[k].label;
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        for (i = 0; i < n; i++)
+          fio.legacy_printi(intptr_t(value), cases[k].base, cases[k].sign, 128, 'a');
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+
+    name = std::string("integers/printi/") + cases[k].label;
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        for (i = 0; i < n; i++)
+          fio.printi(value, cases[k].base, cases[k].sign, 0, 0, 'a');
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+
+    /* the library, into a buffer and as block to the same stream */
+    name = std::string("integers/libc/") + cases[k].label;
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        char buf[24];
+        for (i = 0; i < n; i++)
+          io.writeBlock((const unsigned char*)buf, snprintf(buf, sizeof(buf), cases[k].format, (unsigned long long)value));
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+  }
+}
+
+static void benchFloats()
+{
+  static const struct
+  {
+    const char *label;
+    double value;
+    char conversion;
+    int precision; /* -1 for the shortest */
+    const char *format; /* for snprintf */
+  } cases[] =
+  {
+    { "%.3f/23.456", 23.456, 'f', 3, "%.3f" },
+    { "%.6f/-1234567.891", -1234567.891, 'f', 6, "%.6f" },
+    { "%.2f/1e-5", 1e-5, 'f', 2, "%.2f" },
+    { "%.6e/6.02214076e23", 6.02214076e23, 'e', 6, "%.6e" },
+    { "%.10g/0.1", 0.1, 'g', 10, "%.10g" },
+    { "%g/23.456", 23.456, 'g', -1, "%.17g" },
+    { "%g/1.0/3", 1.0 / 3, 'g', -1, "%.17g" },
+    { "%e/1e-300", 1e-300, 'e', -1, "%.16e" },
+  };
+  LoopbackByteStream io;
+  unsigned k;
+
+  for (k = 0; k < sizeof(cases) / sizeof(cases[0]); k++)
+  {
+    volatile double value = cases[k].value; /* read in every call */
+    std::string name;
+
+    name = std::string("floats/exact/") + cases[k].label;
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        char buf[FloatFormat::BUFFER_SIZE];
+        for (i = 0; i < n; i++)
+          io.writeBlock((const unsigned char*)buf, FloatFormat::format(buf, value, cases[k].conversion, cases[k].precision));
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+
+    name = std::string("floats/fixed/") + cases[k].label;
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        char buf[FloatFormat::BUFFER_SIZE];
+        for (i = 0; i < n; i++)
+          io.writeBlock((const unsigned char*)buf, FloatFormat::formatFixed(buf, value, cases[k].conversion, cases[k].precision));
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+
+    /* the library, with 17 digits for the shortest */
+    name = std::string("floats/libc/") + cases[k].label;
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        char buf[64];
+        for (i = 0; i < n; i++)
+          io.writeBlock((const unsigned char*)buf, snprintf(buf, sizeof(buf), cases[k].format, double(value)));
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+  }
+}
+
+/* TinySh::atoxi before NumberParser, as reference, out of line like the library function */
+__attribute__((noinline))
+static unsigned long legacy_atoxi(const char *s, bool isHex = false)
+{
+  int ishex = int(isHex);
+  unsigned long res = 0;
+
+  if (*s == 0)
+    return 0;
+
+  if (*s == '0' && *(s + 1) == 'x')
+  {
+    ishex = 1;
+    s += 2;
+  }
+
+  while (*s)
+  {
+    if (ishex)
+      res *= 16;
+    else
+      res *= 10;
+
+    if (*s >= '0' && *s <= '9')
+      res += *s - '0';
+    else if (ishex && *s >= 'a' && *s <= 'f')
+      res += *s + 10 - 'a';
+    else if (ishex && *s >= 'A' && *s <= 'F')
+      res += *s + 10 - 'A';
+    else
+      break;
+
+    s++;
+  }
+
+  return res;
+}
+
+static void benchNumbers()
+{
+  static const char *const numbers[] = { "7", "255", "12345678", "4000000000", "18446744073709551615", "0xff",
+                                         "0xdeadbeef", "0x0123456789abcdef" };
+  volatile uint64_t sink = 0;
+  unsigned k;
+
+  for (k = 0; k < sizeof(numbers) / sizeof(numbers[0]); k++)
+  {
+    const char *volatile number = numbers[k]; /* read in every call, the calls are not hoisted */
+    std::string name;
+
+    name = std::string("numbers/atoxi_legacy/") + numbers[k];
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        for (i = 0; i < n; i++)
+          sink = sink + legacy_atoxi(number);
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+
+    name = std::string("numbers/parse/") + numbers[k];
+    if (selected(name))
+    {
+      double s = measure([&](unsigned long n) {
+        unsigned long i;
+        uint64_t value;
+        for (i = 0; i < n; i++)
+        {
+          NumberParser::parse(number, value);
+          sink = sink + value;
+        }
+        return double(n);
+      });
+      report(name, s * 1e9, "ns/number");
+    }
+  }
+}
+
+static void benchSymbols()
+{
+  static const unsigned COUNT = 100000;
+  std::vector<std::string> names(COUNT);
+  volatile uint64_t sink = 0;
+  SymbolTable table;
+  unsigned i;
+
+  for (i = 0; i < COUNT; i++)
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "_ZN%uModule%uE%ufunction_%u", i % 97, i % 1000, i % 13, i);
+    names[i] = name;
+  }
+
+  if (selected("symbols/build_100k"))
+  {
+    double s = measure([&](unsigned long n) {
+      unsigned long k;
+      for (k = 0; k < n; k++)
+      {
+        table.clear();
+        for (i = 0; i < COUNT; i++)
+          table.add(names[i].data(), names[i].size(), 0x08000000 + 16 * ((i * 7919) % COUNT), 16);
+        table.build();
+      }
+      return double(n) * COUNT;
+    });
+    report("symbols/build_100k", s * 1e9, "ns/symbol");
+  }
+
+  table.clear();
+  for (i = 0; i < COUNT; i++)
+    table.add(names[i].data(), names[i].size(), 0x08000000 + 16 * ((i * 7919) % COUNT), 16);
+  table.build();
+
+  if (selected("symbols/find_100k"))
+  {
+    double s = measure([&](unsigned long n) {
+      unsigned long k;
+      for (k = 0; k < n; k++)
+      {
+        const std::string& name = names[(k * 7919) % COUNT];
+        sink = sink + table.find(name.data(), name.size())->addr;
+      }
+      return double(n);
+    });
+    report("symbols/find_100k", s * 1e9, "ns/lookup");
+  }
+
+  if (selected("symbols/atoxi_100k"))
+  {
+    std::vector<std::string> args(COUNT);
+
+    for (i = 0; i < COUNT; i++)
+      args[i] = names[i] + "+0x10";
+    setSymbolTable(&table);
+    double s = measure([&](unsigned long n) {
+      unsigned long k;
+      for (k = 0; k < n; k++)
+        sink = sink + TinyShBase::atoxi(args[(k * 7919) % COUNT].c_str());
+      return double(n);
+    });
+    setSymbolTable(0);
+    report("symbols/atoxi_100k", s * 1e9, "ns/argument");
+  }
+
+  if (selected("symbols/lookup_100k"))
+  {
+    double s = measure([&](unsigned long n) {
+      unsigned long k;
+      for (k = 0; k < n; k++)
+        sink = sink + table.lookup(0x08000000 + ((k * 7919) % (16 * COUNT)))->size;
+      return double(n);
+    });
+    report("symbols/lookup_100k", s * 1e9, "ns/lookup");
+  }
+
+  if (selected("symbols/lookup_sequential"))
+  {
+    double s = measure([&](unsigned long n) {
+      unsigned long k;
+      for (k = 0; k < n; k++)
+        sink = sink + table.lookup(0x08000000 + (k % (16 * COUNT)))->size;
+      return double(n);
+    });
+    report("symbols/lookup_sequential", s * 1e9, "ns/lookup");
+  }
+
+  /* a dump with a new symbol in every line */
+  if (selected("mem/hexdump_sym"))
+  {
+    static const unsigned SIZE = 65536;
+    static std::vector<unsigned char> mem(SIZE);
+    LoopbackByteStream io;
+    TinySh shell;
+
+    table.clear();
+    for (i = 0; i < COUNT; i++)
+      table.add(names[i].data(), names[i].size(), (uintptr_t)&mem[0] + 16 * i, 16);
+    table.build();
+    memCmdsBasePtr = &mem[0];
+    setSymbolTable(&table);
+    shell.setIo(io);
+    shell.add_command(&memCmdGroup);
+
+    double s = measure([&](unsigned long n) {
+      unsigned long k;
+      for (k = 0; k < n; k++)
+      {
+        io.push("mem hexdump 0 65536\r");
+        pump(shell, io);
+      }
+      return double(n) * SIZE;
+    });
+    setSymbolTable(0);
+    report("mem/hexdump_sym", 1.0 / s / 1e6, "MB/s");
+  }
+}
+
+static void benchMem()
+{
+  static const unsigned SIZE = 65536;
+  static std::vector<unsigned char> mem(4 * SIZE);
+  unsigned i;
+
+  for (i = 0; i < mem.size(); i++)
+    mem[i] = (unsigned char)(i * 7);
+  memCmdsBasePtr = &mem[0];
+
+  struct
+  {
+    const char *name;
+    const char *line;
+  } const cases[] =
+  {
+    { "mem/hexdump", "mem hexdump 0 65536\r" },
+    { "mem/get_base64", "mem get 0 65536\r" },
+    { "mem/get_raw", "mem get 0 65536 raw\r" },
+    { "mem/cmp", "mem cmp 0 131072 65536\r" },
+    { "mem/diff", "mem diff 0 1 65536\r" },
+    { "mem/byte_fill", "mem byte fill 0 0x55 65536\r" },
+    { "mem/long_fill", "mem long fill 131072 0x55aa 16384\r" },
+  };
+  unsigned k;
+
+  for (k = 0; k < sizeof(cases) / sizeof(cases[0]); k++)
+  {
+    if (!selected(cases[k].name))
+      continue;
+
+    LoopbackByteStream io;
+    TinySh shell;
+    shell.setIo(io);
+    shell.add_command(&memCmdGroup);
+
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+      {
+        io.push(cases[k].line);
+        pump(shell, io);
+      }
+      return double(n) * SIZE;
+    });
+    report(cases[k].name, 1.0 / s / 1e6, "MB/s");
+  }
+}
+
+/* an image of data in Intel HEX (32 bytes per record), S-record (S3) or raw format */
+static std::string loadImage(const char *format, const unsigned char *data, unsigned len)
+{
+  std::string image;
+  char line[128];
+  unsigned i, j, n;
+
+  if (!strcmp(format, "raw"))
+  {
+    for (i = 0; i < 4; i++)
+      image += (char)(len >> (8 * i));
+    image.append((const char*)data, len);
+    return image;
+  }
+
+  for (i = 0; i < len; i += n)
+  {
+    unsigned sum;
+    int k;
+
+    n = (len - i < 32) ? len - i : 32;
+    if (!strcmp(format, "ihex"))
+    {
+      if (!(i & 0xFFFF))
+      {
+        sum = 2 + 4 + (i >> 24) + ((i >> 16) & 0xFF);
+        snprintf(line, sizeof(line), ":02000004%04X%02X\r\n", i >> 16, -sum & 0xFF);
+        image += line;
+      }
+      sum = n + ((i >> 8) & 0xFF) + (i & 0xFF);
+      k = snprintf(line, sizeof(line), ":%02X%04X00", n, i & 0xFFFF);
+    }
+    else
+    {
+      sum = (n + 5) + (i >> 24) + ((i >> 16) & 0xFF) + ((i >> 8) & 0xFF) + (i & 0xFF);
+      k = snprintf(line, sizeof(line), "S3%02X%08X", n + 5, i);
+    }
+    for (j = 0; j < n; j++)
+    {
+      sum += data[i + j];
+      k += snprintf(line + k, sizeof(line) - k, "%02X", data[i + j]);
+    }
+    snprintf(line + k, sizeof(line) - k, "%02X\r\n", (strcmp(format, "ihex") ? ~sum : -sum) & 0xFF);
+    image += line;
+  }
+  image += strcmp(format, "ihex") ? "S70500000000FA\r\n" : ":00000001FF\r\n";
+
+  return image;
+}
+
+/* microseconds for the tick source, a raw load needs one */
+static uint32_t benchTicks()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void benchLoad()
+{
+  static const unsigned SIZE = 65536;
+  static std::vector<unsigned char> mem(2 * SIZE);
+  const char *formats[] = { "ihex", "srec", "raw" };
+  unsigned i, k;
+
+  for (i = 0; i < SIZE; i++)
+    mem[i] = (unsigned char)(i * 7);
+  memCmdsBasePtr = &mem[0];
+
+  for (k = 0; k < sizeof(formats) / sizeof(formats[0]); k++)
+  {
+    std::string name = std::string("mem/load_") + formats[k];
+
+    if (!selected(name))
+      continue;
+
+    std::string input = std::string("mem load ") + formats[k] + " 65536\r" + loadImage(formats[k], &mem[0], SIZE);
+    LoopbackByteStream io;
+    TinySh shell;
+    shell.setIo(io);
+    shell.add_command(&memCmdGroup);
+    setTickSource(&benchTicks, 1000000);
+
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+      {
+        io.push(input);
+        pump(shell, io);
+      }
+      return double(n) * SIZE;
+    });
+    setTickSource(0, 0);
+    if (memcmp(&mem[0], &mem[SIZE], SIZE))
+      name += "_FAILED";
+    report(name, 1.0 / s / 1e6, "MB/s");
+  }
+}
+
+/* mem delta of a 64k snapshot, unchanged and with one changed byte per 1k */
+static void benchDelta()
+{
+  static const unsigned SIZE = 65536;
+  static std::vector<unsigned char> mem(SIZE);
+  static std::vector<uint32_t> arena(SIZE / 4 + SIZE / 64 + 16);
+  const char *names[] = { "mem/delta", "mem/delta_sparse" };
+  unsigned i, k;
+
+  for (i = 0; i < SIZE; i++)
+    mem[i] = (unsigned char)(i * 7);
+  memCmdsBasePtr = &mem[0];
+  memSnapArena(&arena[0], arena.size() * sizeof(arena[0]));
+
+  for (k = 0; k < sizeof(names) / sizeof(names[0]); k++)
+  {
+    if (!selected(names[k]))
+      continue;
+
+    LoopbackByteStream io;
+    TinySh shell;
+    shell.setIo(io);
+    shell.add_command(&memCmdGroup);
+
+    io.push("mem snap bench 0 65536\r");
+    pump(shell, io);
+    if (k)
+      for (i = 0; i < SIZE; i += 1024)
+        mem[i + 100]++;
+
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+      {
+        io.push("mem delta bench\r");
+        pump(shell, io);
+      }
+      return double(n) * SIZE;
+    });
+    report(names[k], 1.0 / s / 1e6, "MB/s");
+  }
+}
+
+/* a pass of watch with the command resolved once, against the same command line typed again */
+static void benchWatch()
+{
+  static unsigned char mem[64];
+  const char *names[] = { "watch/line", "watch/pass", "watch/pass_changes" };
+  const char *lines[] = { "mem byte read 0 4\r", "watch -n 0 -c 1000 mem byte read 0 4\r",
+      "watch -n 0 -c 1000 -d mem byte read 0 4\r" };
+  LoopbackByteStream io;
+  TinySh shell;
+  unsigned k;
+
+  /* one shell, the commands are linked once */
+  memCmdsBasePtr = mem;
+  shell.setIo(io);
+  shell.add_command(&memCmdGroup);
+  shell.add_command(&watchCommand);
+
+  for (k = 0; k < sizeof(names) / sizeof(names[0]); k++)
+  {
+    if (!selected(names[k]))
+      continue;
+
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+      {
+        io.push(lines[k]);
+        pump(shell, io);
+      }
+      return double(n) * (k ? 1000 : 1);
+    });
+    report(names[k], s * 1e9, "ns/pass");
+  }
+}
+
+/* mem poll of a value, that is there already, and the spinning of the first step on one, that never comes */
+static void benchPoll()
+{
+  static uint32_t mem[4] = { 5 };
+  LoopbackByteStream io;
+  TinySh shell;
+
+  memCmdsBasePtr = (unsigned char*)mem;
+  shell.setIo(io);
+  shell.add_command(&memCmdGroup);
+
+  if (selected("mem/poll_hit"))
+  {
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+      {
+        io.push("mem long poll 0 0xff 5\r");
+        pump(shell, io);
+      }
+      return double(n);
+    });
+    report("mem/poll_hit", s * 1e9, "ns/poll");
+  }
+
+  if (selected("mem/poll_spin"))
+  {
+    double s = measure([&](unsigned long n) {
+      unsigned long i;
+      for (i = 0; i < n; i++)
+      {
+        io.push("mem long poll 0 0xff 7\r");
+        while (io.inputPending())
+          shell.checkInput();
+        shell.checkInput(); /* the spinning step */
+        io.push("\x03");
+        shell.checkInput();
+      }
+      return double(n) * 1000;
+    });
+    report("mem/poll_spin", s * 1e9, "ns/read");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+    filter = argv[1];
+
+  benchCharIn();
+  benchLevels();
+  benchSessions();
+  benchPrintf();
+  benchIntegers();
+  benchFloats();
+  benchNumbers();
+  benchSymbols();
+  benchMem();
+  benchLoad();
+  benchDelta();
+  benchWatch();
+  benchPoll();
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * replay.cpp
+ *
+ * Replays a session recorded with RecordingByteStream into a fresh TinySh
+ * with the mem commands and verifies its output. Applications with their own
+ * command tree build the same driver around SessionReplay with their tree.
+ *
+ * usage: tinysh_replay [-p] [-t] <recording>
+ *   -p  feed the input with the recorded pacing instead of full speed
+ *   -t  trigger the prompt before the replay, like a new connection does
+ *
+ * exit code 0, if the output is identical to the recording
+ */
+
+#include "SessionReplay.h"
+
+#include "MemCommands.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace Shell
+{
+  extern unsigned char *memCmdsBasePtr;
+}
+
+using namespace Shell;
+
+static unsigned char arena[65536];
+
+int main(int argc, char **argv)
+{
+  bool paced = false, prompt = false;
+  const char *fileName = 0;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-p"))
+      paced = true;
+    else if (!strcmp(argv[i], "-t"))
+      prompt = true;
+    else
+      fileName = argv[i];
+  }
+  if (!fileName)
+  {
+    fprintf(stderr, "usage: %s [-p] [-t] <recording>\n", argv[0]);
+    return 2;
+  }
+
+  SessionReplay replay;
+  std::string error;
+  if (!replay.load(fileName, error))
+  {
+    fprintf(stderr, "%s: %s\n", fileName, error.c_str());
+    return 2;
+  }
+
+  memCmdsBasePtr = arena;
+
+  TinySh shell;
+  ByteStream null;
+  shell.setIo(null);
+  shell.add_command(&memCmdGroup);
+
+  SessionReplay::Result result = replay.run(shell, paced, prompt);
+
+  for (i = 0; i < (int)result.lines.size(); i++)
+    printf("%12.0f ns  %s\n", result.lines[i].seconds * 1e9, result.lines[i].line.c_str());
+  printf("total %.0f ns for %u lines, %u output bytes\n", result.totalSeconds * 1e9, (unsigned)result.lines.size(), (unsigned)result.output.size());
+
+  if (result.mismatchAt >= 0)
+  {
+    printf("output differs at offset %ld (%u bytes expected, %u produced)\n", result.mismatchAt,
+        (unsigned)replay.expectedOutput.size(), (unsigned)result.output.size());
+    return 1;
+  }
+
+  printf("output identical\n");
+  return 0;
+}
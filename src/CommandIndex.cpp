@@ -0,0 +1,188 @@
+/*
+ * CommandIndex.cpp
+ *
+ */
+
+#include "CommandIndex.h"
+
+namespace Shell
+{
+
+CommandIndex::Entry CommandIndex::entries[TINYSH_INDEX_ENTRIES ? TINYSH_INDEX_ENTRIES : 1];
+CommandIndex::Level CommandIndex::levels[TINYSH_INDEX_LEVELS];
+unsigned CommandIndex::usedEntries = 0;
+unsigned CommandIndex::usedLevels = 0;
+
+void CommandIndex::invalidate()
+{
+  usedEntries = 0;
+  usedLevels = 0;
+}
+
+const CommandIndex::Level* CommandIndex::level(CommandNode first)
+{
+  unsigned i;
+
+  if (!TINYSH_INDEX_ENTRIES || first.isNull())
+    return 0;
+
+  for (i = 0; i < usedLevels; i++)
+    if (levels[i].first == first)
+      return &levels[i];
+
+  return build(first);
+}
+
+static int name_cmp(const char *s1, const char *s2)
+{
+  while (*s1 && *s1 == *s2)
+  {
+    s1++;
+    s2++;
+  }
+  return (unsigned char)*s1 - (unsigned char)*s2;
+}
+
+/* compare name with the token of length len: 0, if name starts with the token */
+static int prefix_cmp(const char *name, const char *token, unsigned len)
+{
+  unsigned i;
+
+  for (i = 0; i < len; i++)
+  {
+    if (name[i] != token[i])
+      return (unsigned char)name[i] - (unsigned char)token[i];
+  }
+  return 0;
+}
+
+/* heap sort by name, no recursion and no extra memory */
+static void sift_down(CommandIndex::Entry *e, unsigned root, unsigned n)
+{
+  for (;;)
+  {
+    unsigned child = 2 * root + 1;
+
+    if (child >= n)
+      break;
+    if ((child + 1 < n) && (name_cmp(e[child].cmd.name(), e[child + 1].cmd.name()) < 0))
+      child++;
+    if (name_cmp(e[root].cmd.name(), e[child].cmd.name()) >= 0)
+      break;
+
+    CommandIndex::Entry t = e[root];
+    e[root] = e[child];
+    e[child] = t;
+    root = child;
+  }
+}
+
+const CommandIndex::Level* CommandIndex::build(CommandNode first)
+{
+  CommandNode cm;
+  unsigned count = 0, i;
+  unsigned maxLen = 0;
+
+  for (cm = first; !cm.isNull(); cm = cm.next())
+  {
+    unsigned len = 0;
+
+    while (cm.name()[len] && len < 256)
+      len++;
+    if ((len > 255) || (count >= TINYSH_INDEX_ENTRIES))
+      return 0; /* not indexable */
+    count++;
+  }
+
+  if ((usedEntries + count > TINYSH_INDEX_ENTRIES) || (usedLevels >= TINYSH_INDEX_LEVELS))
+    invalidate(); /* start over with an empty pool */
+
+  Level& lvl = levels[usedLevels++];
+  Entry *e = &entries[usedEntries];
+
+  lvl.first = first;
+  lvl.start = usedEntries;
+  lvl.count = count;
+  usedEntries += count;
+
+  for (cm = first, i = 0; !cm.isNull(); cm = cm.next(), i++)
+  {
+    unsigned len = 0;
+
+    while (cm.name()[len])
+      len++;
+    e[i].cmd = cm;
+    e[i].len = len;
+    if (len > maxLen)
+      maxLen = len;
+  }
+  lvl.maxLen = maxLen;
+
+  for (i = count / 2; i > 0; i--)
+    sift_down(e, i - 1, count);
+  for (i = count; i > 1; i--)
+  {
+    Entry t = e[0];
+    e[0] = e[i - 1];
+    e[i - 1] = t;
+    sift_down(e, 0, i - 1);
+  }
+
+  e[0].lcp = 0;
+  for (i = 1; i < count; i++)
+  {
+    const char *a = e[i - 1].cmd.name();
+    const char *b = e[i].cmd.name();
+    unsigned n = 0;
+
+    while (a[n] && a[n] == b[n])
+      n++;
+    e[i].lcp = n;
+  }
+
+  return &lvl;
+}
+
+void CommandIndex::range(const Level *lvl, const char *token, unsigned len, unsigned& lo, unsigned& hi)
+{
+  const Entry *e = &entries[lvl->start];
+  unsigned l = 0, h = lvl->count;
+
+  /* first entry not less than the token */
+  while (l < h)
+  {
+    unsigned m = (l + h) / 2;
+    if (prefix_cmp(e[m].cmd.name(), token, len) < 0)
+      l = m + 1;
+    else
+      h = m;
+  }
+  lo = l;
+
+  /* first entry greater than all names starting with the token */
+  h = lvl->count;
+  while (l < h)
+  {
+    unsigned m = (l + h) / 2;
+    if (prefix_cmp(e[m].cmd.name(), token, len) <= 0)
+      l = m + 1;
+    else
+      h = m;
+  }
+  hi = l;
+}
+
+unsigned CommandIndex::commonPrefix(const Level *lvl, unsigned lo, unsigned hi)
+{
+  const Entry *e = &entries[lvl->start];
+  unsigned common = e[lo].len;
+  unsigned i;
+
+  for (i = lo + 1; i < hi; i++)
+    if (e[i].lcp < common)
+      common = e[i].lcp;
+
+  return common;
+}
+
+} // namespace Shell
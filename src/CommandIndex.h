@@ -0,0 +1,85 @@
+/*
+ * CommandIndex.h
+ *
+ */
+
+#ifndef COMMANDINDEX_H_
+#define COMMANDINDEX_H_
+
+#include "TinySh.h"
+
+#include <stdint.h>
+
+#ifndef TINYSH_INDEX_ENTRIES
+#define TINYSH_INDEX_ENTRIES 256 /* 0 disables the index */
+#endif
+
+#ifndef TINYSH_INDEX_LEVELS
+#define TINYSH_INDEX_LEVELS 16
+#endif
+
+namespace Shell
+{
+  /**
+   * Precomputed lookup data per command level: the names of the level sorted,
+   * their lengths and the length of the common prefix with the sorted
+   * predecessor. All names starting with a given token are a contiguous range
+   * of the sorted entries, found by binary search, and the common prefix of
+   * such a range is the minimum of the neighbour prefixes inside it.
+   *
+   * The index of a level is built on its first use into a fixed pool, shared
+   * by all shells. If the pool is full, it is cleared and filled anew. Levels
+   * with more than TINYSH_INDEX_ENTRIES commands or names longer than 255
+   * characters are not indexed, the caller falls back to the linear search
+   * then. Every change of a command tree must call invalidate().
+   */
+  class CommandIndex
+  {
+  public:
+    struct Entry
+    {
+      CommandNode cmd;
+      uint8_t len; /* length of the name */
+      uint8_t lcp; /* common prefix length with the previous entry, 0 for the first */
+    };
+
+    struct Level
+    {
+      CommandNode first; /* first command of the level, identifies it */
+      uint16_t start; /* first entry in the pool */
+      uint16_t count;
+      uint8_t maxLen; /* longest name of the level */
+    };
+
+    /* get the index of the level starting with first, 0 if not available */
+    static const Level* level(CommandNode first);
+
+    /* find the entries [lo, hi) of lvl starting with the first len characters of token */
+    static void range(const Level *lvl, const char *token, unsigned len, unsigned& lo, unsigned& hi);
+
+    /* common prefix length of the entries [lo, hi), hi > lo */
+    static unsigned commonPrefix(const Level *lvl, unsigned lo, unsigned hi);
+
+    static const Entry& entry(const Level *lvl, unsigned i);
+
+    /* forget all indexes, e.g. because a command tree has changed */
+    static void invalidate();
+
+  private:
+    static const Level* build(CommandNode first);
+
+    static Entry entries[TINYSH_INDEX_ENTRIES ? TINYSH_INDEX_ENTRIES : 1];
+    static Level levels[TINYSH_INDEX_LEVELS];
+    static unsigned usedEntries;
+    static unsigned usedLevels;
+  };
+
+  inline
+  const CommandIndex::Entry& CommandIndex::entry(const Level *lvl, unsigned i)
+  {
+    return entries[lvl->start + i];
+  }
+
+} // namespace Shell
+
+#endif /* COMMANDINDEX_H_ */
@@ -0,0 +1,80 @@
+/*
+ * CommandNode.cpp
+ *
+ */
+
+#include "CommandNode.h"
+#include "TinySh.h"
+
+namespace Shell
+{
+
+CommandNode::Mount CommandNode::mounts[TINYSH_PACKED_MOUNTS];
+
+const CommandDescription* CommandDescription::next() const
+{
+  if ((const CommandDescription*)~0 == nextPtr)
+    return this + 1;
+  else
+    return nextPtr;
+}
+
+CommandFunction_t CommandNode::function() const
+{
+  if (index >= BUILTIN_FIRST)
+    return description()->function;
+  if (PACKED_NO_INDEX == node().function)
+    return 0;
+  return tree()->functions[node().function];
+}
+
+void* CommandNode::arg() const
+{
+  if (index >= BUILTIN_FIRST)
+    return description()->arg;
+  if (PACKED_NO_INDEX == node().arg)
+    return 0;
+  return tree()->args[node().arg];
+}
+
+const CommandDescription* CommandNode::builtin() const
+{
+  return &TinyShBase::builtins[index - BUILTIN_FIRST];
+}
+
+CommandNode CommandNode::nextBuiltin() const
+{
+  if (index + 1u < BUILTIN_FIRST + TinyShBase::BUILTIN_COUNT)
+    return CommandNode(ptr, index + 1);
+  return CommandNode(*(const CommandDescription * const *)ptr);
+}
+
+CommandNode CommandNode::mounted() const
+{
+  unsigned i;
+
+  for (i = 0; (i < TINYSH_PACKED_MOUNTS) && mounts[i].parent; i++)
+    if (mounts[i].parent == ptr)
+      return CommandNode(mounts[i].tree, 0);
+
+  return CommandNode();
+}
+
+bool CommandNode::mount(const CommandDescription *parent, const PackedTree *tree)
+{
+  unsigned i;
+
+  for (i = 0; i < TINYSH_PACKED_MOUNTS; i++)
+  {
+    if (!mounts[i].parent || (mounts[i].parent == parent))
+    {
+      mounts[i].parent = parent;
+      mounts[i].tree = tree;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace Shell
@@ -0,0 +1,255 @@
+/*
+ * CommandNode.h
+ *
+ */
+
+#ifndef COMMANDNODE_H_
+#define COMMANDNODE_H_
+
+#include <stdint.h>
+
+#ifndef TINYSH_COMMANDCHAIN_MUTABLE
+#define TINYSH_COMMANDCHAIN_MUTABLE
+#endif
+
+#ifndef TINYSH_PACKED_MOUNTS
+#define TINYSH_PACKED_MOUNTS 4
+#endif
+
+namespace Shell
+{
+  class TinyShBase;
+
+  typedef void (*CommandFunction_t)(TinyShBase& shell, int argc, const char **argv);
+
+  struct CommandDescription
+  {
+    const char *name; /* command input name, not 0 */
+    const char *help; /* help string, can be 0 */
+    const char *usage; /* usage string, can be 0 */
+    CommandFunction_t function; /* function to launch on cmd, can be 0 */
+    void *arg; /* current argument when function called */
+    const CommandDescription TINYSH_COMMANDCHAIN_MUTABLE *nextPtr; /* must be set to 0 at init, must be ~0 on array members, last array member must be 0 on init */
+    const CommandDescription TINYSH_COMMANDCHAIN_MUTABLE *child; /* must be set to 0 at init */
+
+    const CommandDescription* next() const;
+  };
+
+  /**
+   * The packed node format for large command trees: 12 bytes per node instead
+   * of seven pointers. All nodes of a tree are stored in one array in depth
+   * first order, siblings and children are 16 bit indices into it, the texts
+   * are offsets into a shared string pool, function and argument are indices
+   * into tables. Such a tree is generated by tools/packcommands and mounted
+   * below a CommandDescription with TinyShBase::add_command().
+   */
+  static const uint16_t PACKED_NONE = 0xFFFF;
+  static const uint8_t PACKED_NO_INDEX = 0xFF;
+  static const uint16_t PACKED_MAX_NODES = 0xFFF0; /* the indices above are used by CommandNode */
+
+  struct PackedNode
+  {
+    uint16_t name; /* offset in the string pool */
+    uint16_t help; /* offset in the string pool, PACKED_NONE if there is none */
+    uint16_t usage; /* offset in the string pool, PACKED_NONE if there is none */
+    uint16_t next; /* index of the next sibling, PACKED_NONE for the last one */
+    uint16_t child; /* index of the first child, PACKED_NONE if there is none */
+    uint8_t function; /* index in the function table, PACKED_NO_INDEX if there is none */
+    uint8_t arg; /* index in the argument table, PACKED_NO_INDEX for 0 */
+  };
+
+  struct PackedTree
+  {
+    const PackedNode *nodes; /* the top level starts with node 0 */
+    const char *strings;
+    const CommandFunction_t *functions;
+    void * const *args;
+  };
+
+  /**
+   * A handle of a command in either format, a CommandDescription or a node of
+   * a PackedTree, for the traversal of the command tree. The null handle marks
+   * the end of a level.
+   *
+   * The builtin commands of TinyShBase are one static table for all shells, they
+   * start the top level of each shell, the handle of a builtin refers to the
+   * top level list of its shell, which follows the last builtin.
+   */
+  class CommandNode
+  {
+  public:
+    CommandNode();
+    CommandNode(const CommandDescription *desc);
+    CommandNode(const PackedTree *tree, uint16_t index);
+
+    bool isNull() const;
+
+    const char* name() const;
+    const char* help() const;
+    const char* usage() const;
+    CommandFunction_t function() const;
+    void* arg() const;
+
+    /* the next sibling, null at the end of the level */
+    CommandNode next() const;
+
+    /* the first sub-command, null if there is none */
+    CommandNode child() const;
+
+    /* a stable identity, the CommandDescription or the PackedNode */
+    const void* key() const;
+
+    /* the CommandDescription, 0 for a packed node */
+    const CommandDescription* description() const;
+
+    bool operator==(const CommandNode& other) const;
+    bool operator!=(const CommandNode& other) const;
+
+    /* let the top level of tree be the sub-commands of parent, parent must not have a child */
+    static bool mount(const CommandDescription *parent, const PackedTree *tree);
+
+    /* the top level of a shell, the builtin commands followed by the list at *rest */
+    static CommandNode topLevel(const CommandDescription * const *rest);
+
+  private:
+    CommandNode(const void *ptr, uint16_t index);
+
+    static const uint16_t BUILTIN_FIRST = PACKED_MAX_NODES; /* index of the first builtin, up to PACKED_NONE - 1 */
+
+    const CommandDescription* builtin() const;
+    CommandNode nextBuiltin() const;
+
+    const PackedNode& node() const;
+    const PackedTree* tree() const;
+    const char* text(uint16_t offset) const;
+    CommandNode mounted() const;
+
+    const void *ptr; /* the CommandDescription, the PackedTree or the top level list of the builtin's shell */
+    uint16_t index; /* PACKED_NONE, if ptr is a CommandDescription, BUILTIN_FIRST + n for builtin n */
+
+    struct Mount
+    {
+      const CommandDescription *parent;
+      const PackedTree *tree;
+    };
+
+    static Mount mounts[TINYSH_PACKED_MOUNTS];
+  };
+
+  inline
+  CommandNode::CommandNode()
+  : ptr(0), index(PACKED_NONE)
+  {}
+
+  inline
+  CommandNode::CommandNode(const CommandDescription *desc)
+  : ptr(desc), index(PACKED_NONE)
+  {}
+
+  inline
+  CommandNode::CommandNode(const PackedTree *tree_, uint16_t index_)
+  : ptr((PACKED_NONE == index_) ? 0 : tree_), index(index_)
+  {}
+
+  inline
+  CommandNode::CommandNode(const void *ptr_, uint16_t index_)
+  : ptr(ptr_), index(index_)
+  {}
+
+  inline
+  CommandNode CommandNode::topLevel(const CommandDescription * const *rest)
+  {
+    return CommandNode(rest, BUILTIN_FIRST);
+  }
+
+  inline
+  bool CommandNode::isNull() const
+  {
+    return 0 == ptr;
+  }
+
+  inline
+  const PackedTree* CommandNode::tree() const
+  {
+    return (const PackedTree*)ptr;
+  }
+
+  inline
+  const PackedNode& CommandNode::node() const
+  {
+    return tree()->nodes[index];
+  }
+
+  inline
+  const char* CommandNode::text(uint16_t offset) const
+  {
+    return (PACKED_NONE == offset) ? 0 : &tree()->strings[offset];
+  }
+
+  inline
+  const CommandDescription* CommandNode::description() const
+  {
+    if (PACKED_NONE == index)
+      return (const CommandDescription*)ptr;
+    return (index >= BUILTIN_FIRST) ? builtin() : 0;
+  }
+
+  inline
+  const char* CommandNode::name() const
+  {
+    return (index >= BUILTIN_FIRST) ? description()->name : text(node().name);
+  }
+
+  inline
+  const char* CommandNode::help() const
+  {
+    return (index >= BUILTIN_FIRST) ? description()->help : text(node().help);
+  }
+
+  inline
+  const char* CommandNode::usage() const
+  {
+    return (index >= BUILTIN_FIRST) ? description()->usage : text(node().usage);
+  }
+
+  inline
+  CommandNode CommandNode::next() const
+  {
+    if (PACKED_NONE == index)
+      return CommandNode(description()->next());
+    if (index >= BUILTIN_FIRST)
+      return nextBuiltin();
+    return CommandNode(tree(), node().next);
+  }
+
+  inline
+  CommandNode CommandNode::child() const
+  {
+    if (PACKED_NONE == index)
+      return description()->child ? CommandNode(description()->child) : mounted();
+    if (index >= BUILTIN_FIRST)
+      return CommandNode(); /* the builtins have no sub-commands */
+    return CommandNode(tree(), node().child);
+  }
+
+  inline
+  const void* CommandNode::key() const
+  {
+    return (index >= BUILTIN_FIRST) ? (const void*)description() : (const void*)&node();
+  }
+
+  inline
+  bool CommandNode::operator==(const CommandNode& other) const
+  {
+    return (ptr == other.ptr) && (index == other.index);
+  }
+
+  inline
+  bool CommandNode::operator!=(const CommandNode& other) const
+  {
+    return !(*this == other);
+  }
+
+} // namespace Shell
+
+#endif /* COMMANDNODE_H_ */
@@ -0,0 +1,182 @@
+/*
+ * CommandStats.cpp
+ *
+ */
+
+#include "CommandStats.h"
+#include "ShellJob.h"
+#include "PrintfToStream.h"
+#include "ShellClock.h"
+
+#if TINYSH_STATS
+
+namespace Shell
+{
+
+CommandStats commandStats;
+
+CommandStats::CommandStats()
+{
+  reset();
+}
+
+void CommandStats::reset()
+{
+  unsigned i, j;
+
+  for (i = 0; i < SLOTS; i++)
+  {
+    entries[i].cmd = CommandNode();
+    entries[i].count = 0;
+    entries[i].totalTicks = 0;
+    entries[i].maxTicks = 0;
+    for (j = 0; j < BUCKETS; j++)
+      entries[i].histogram[j] = 0;
+  }
+  droppedCount = 0;
+}
+
+unsigned CommandStats::bucket(uint32_t t)
+{
+  unsigned b = 0;
+
+  while ((t >>= 1) && (b < BUCKETS - 1))
+    b++;
+
+  return b;
+}
+
+void CommandStats::record(CommandNode cmd, uint32_t t)
+{
+  /*
+   * open addressing with linear probing, the command descriptions and nodes are at least 2 byte aligned;
+   * compared by key, the nodes of the builtins differ per shell
+   */
+  const void *key = cmd.key();
+  unsigned i = (unsigned)(((uintptr_t)key >> 1) % SLOTS);
+  unsigned n;
+
+  for (n = 0; n < SLOTS; n++)
+  {
+    Entry& e = entries[i];
+
+    if (e.cmd.isNull() || (e.cmd.key() == key))
+    {
+      e.cmd = cmd;
+      e.count++;
+      e.totalTicks += t;
+      if (t > e.maxTicks)
+        e.maxTicks = t;
+      e.histogram[bucket(t)]++;
+      return;
+    }
+
+    i = (i + 1) % SLOTS;
+  }
+
+  droppedCount++;
+}
+
+/*
+ * display of the statistics, one chunk per line or half histogram
+ */
+class StatsJob: public OutputJob
+{
+public:
+  StatsJob();
+
+  const CommandStats* stats;
+  unsigned slot;
+  unsigned part;
+
+protected:
+  virtual bool generate(TinyShBase& shell, ByteStream& out);
+};
+
+static StatsJob statsJob;
+
+StatsJob::StatsJob()
+: stats(0), slot(0), part(0)
+{}
+
+bool StatsJob::generate(TinyShBase& shell, ByteStream& out)
+{
+  PrintfToStream fio(out);
+  static const unsigned HALF = (CommandStats::BUCKETS + 1) / 2;
+  unsigned i;
+
+  if (!part && !slot)
+  {
+    fio.printf("%-24s %8s %10s %10s  (ticks, %lu per second)\n", "command", "count", "total", "max", (unsigned long)ticksPerSecond());
+    part = 1;
+    return true;
+  }
+
+  /* skip the unused slots */
+  while ((slot < CommandStats::SLOTS) && stats->entry(slot).cmd.isNull())
+    slot++;
+
+  if (slot >= CommandStats::SLOTS)
+  {
+    if (stats->dropped())
+      fio.printf("%lu executions not accounted\n", (unsigned long)stats->dropped());
+    slot = 0;
+    part = 0;
+    return false;
+  }
+
+  const CommandStats::Entry& e = stats->entry(slot);
+
+  if (1 == part)
+  {
+    char path[25];
+
+    if (!shell.commandPath(e.cmd, path, sizeof(path)))
+      fio.printf("%-24s", e.cmd.name());
+    else
+      fio.printf("%-24s", path);
+    fio.printf(" %8lu %10llu %10lu\n  log2 histogram:", (unsigned long)e.count, (unsigned long long)e.totalTicks, (unsigned long)e.maxTicks);
+    part = 2;
+  }
+  else
+  {
+    /* first or second half of the histogram, the second one completes the line */
+    unsigned from = (2 == part) ? 0 : HALF;
+    unsigned to = (2 == part) ? HALF : CommandStats::BUCKETS;
+
+    for (i = from; i < to; i++)
+      if (e.histogram[i])
+        fio.printf(" %u:%lu", i, (unsigned long)e.histogram[i]);
+
+    if (2 == part)
+    {
+      part = 3;
+    }
+    else
+    {
+      fio.printf("\n");
+      part = 1;
+      slot++;
+    }
+  }
+
+  return true;
+}
+
+void CommandStats::print(TinyShBase& shell)
+{
+  if (statsJob.isRunning())
+  {
+    shell.io().writeBlock("stats: busy\n");
+    return;
+  }
+
+  statsJob.stats = this;
+  statsJob.slot = 0;
+  statsJob.part = 0;
+  shell.startJob(statsJob);
+}
+
+} // namespace Shell
+
+#endif // TINYSH_STATS
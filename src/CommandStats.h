@@ -0,0 +1,89 @@
+/*
+ * CommandStats.h
+ *
+ */
+
+#ifndef COMMANDSTATS_H_
+#define COMMANDSTATS_H_
+
+#include "TinySh.h"
+
+#include <stdint.h>
+
+#ifndef TINYSH_STATS_SLOTS
+#define TINYSH_STATS_SLOTS 32
+#endif
+
+#ifndef TINYSH_STATS_BUCKETS
+#define TINYSH_STATS_BUCKETS 16
+#endif
+
+namespace Shell
+{
+  /**
+   * Per command execution statistics: invocation count, total and maximum
+   * time and a histogram of the latencies with logarithmic buckets.
+   *
+   * Bucket 0 counts latencies of 0 or 1 tick, bucket i counts latencies of
+   * 2^i ... 2^(i+1)-1 ticks, the last bucket also counts all longer ones.
+   *
+   * The entries are kept in a fixed size hash table, keyed by the command. When the table is full, the executions of further commands
+   * are only counted as dropped.
+   */
+  class CommandStats
+  {
+  public:
+    static const unsigned SLOTS = TINYSH_STATS_SLOTS;
+    static const unsigned BUCKETS = TINYSH_STATS_BUCKETS;
+
+    struct Entry
+    {
+      CommandNode cmd; /* null for an unused slot */
+      uint32_t count;
+      uint64_t totalTicks;
+      uint32_t maxTicks;
+      uint32_t histogram[BUCKETS];
+    };
+
+    CommandStats();
+
+    /* account one execution of cmd, that took the given number of ticks */
+    void record(CommandNode cmd, uint32_t ticks);
+
+    /* clear all statistics */
+    void reset();
+
+    /* display the statistics on the shell, runs as a job */
+    void print(TinyShBase& shell);
+
+    /* get slot i, 0 <= i < SLOTS, check cmd for usage */
+    const Entry& entry(unsigned i) const;
+
+    /* number of executions not accounted due to a full table */
+    uint32_t dropped() const;
+
+    static unsigned bucket(uint32_t ticks);
+
+  private:
+    Entry entries[SLOTS];
+    uint32_t droppedCount;
+  };
+
+  /* the statistics of all shell instances */
+  extern CommandStats commandStats;
+
+  inline
+  const CommandStats::Entry& CommandStats::entry(unsigned i) const
+  {
+    return entries[i];
+  }
+
+  inline
+  uint32_t CommandStats::dropped() const
+  {
+    return droppedCount;
+  }
+
+} // namespace Shell
+
+#endif /* COMMANDSTATS_H_ */
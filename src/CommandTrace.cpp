@@ -0,0 +1,163 @@
+/*
+ * CommandTrace.cpp
+ *
+ */
+
+#include "CommandTrace.h"
+
+#if TINYSH_EXEC_HOOKS
+
+#include "ShellClock.h"
+#include "ShellJob.h"
+#include "Util/PrintfToStream.h"
+
+namespace Shell
+{
+
+TraceRing CommandTrace::ring;
+PostExecHook_t CommandTrace::chainedPost = 0;
+
+void CommandTrace::clear()
+{
+  ring.magic = TraceRing::MAGIC;
+  ring.version = TraceRing::VERSION;
+  ring.recordSize = sizeof(TraceRecord);
+  ring.pointerSize = sizeof(uintptr_t);
+  ring.depth = TraceRing::DEPTH;
+  ring.written = 0;
+  ring.ticksPerSecond = ticksPerSecond();
+  ring.reserved = 0;
+}
+
+void CommandTrace::enable()
+{
+  PreExecHook_t pre;
+  PostExecHook_t post;
+
+  if (TraceRing::MAGIC != ring.magic)
+    clear();
+  TinyShBase::getExecHooks(pre, post);
+  if (post == &postExec)
+    return; /* on already */
+  chainedPost = post;
+  TinyShBase::setExecHooks(pre, &postExec);
+}
+
+void CommandTrace::disable()
+{
+  PreExecHook_t pre;
+  PostExecHook_t post;
+
+  TinyShBase::getExecHooks(pre, post);
+  if (post == &postExec)
+    TinyShBase::setExecHooks(pre, chainedPost);
+  chainedPost = 0;
+}
+
+void CommandTrace::postExec(TinyShBase& shell, CommandNode cmd, int argc, uint32_t startTicks)
+{
+  uint32_t now = ticks();
+  TraceRecord& r = ring.records[ring.written % TraceRing::DEPTH];
+
+  r.timestamp = startTicks;
+  r.duration = now - startTicks;
+  r.session = shell.sessionId();
+  r.argc = argc;
+  r.flags = 0;
+  r.cmd = (uintptr_t)cmd.key();
+  ring.written++;
+
+  if (chainedPost)
+    chainedPost(shell, cmd, argc, startTicks);
+}
+
+/*
+ * decoded display of the ring, one record per chunk, oldest first
+ */
+class TraceDumpJob: public OutputJob
+{
+public:
+  uint32_t seq;
+  uint32_t end;
+
+protected:
+  virtual bool generate(TinyShBase& shell, ByteStream& out);
+};
+
+static TraceDumpJob traceDumpJob;
+
+bool TraceDumpJob::generate(TinyShBase& shell, ByteStream& out)
+{
+  PrintfToStream fio(out);
+
+  if (seq >= end)
+  {
+    fio.printf("no records\n");
+    return false;
+  }
+
+  const TraceRecord& r = CommandTrace::ring.records[seq % TraceRing::DEPTH];
+  char path[33];
+
+  if (!shell.commandPath((const void*)r.cmd, path, sizeof(path)))
+    fio.printf("%6lu %10lu %5u 0x%08lx%-22s %3u %10lu\n", (unsigned long)seq, (unsigned long)r.timestamp, r.session, (unsigned long)r.cmd, "", r.argc, (unsigned long)r.duration);
+  else
+    fio.printf("%6lu %10lu %5u %-32s %3u %10lu\n", (unsigned long)seq, (unsigned long)r.timestamp, r.session, path, r.argc, (unsigned long)r.duration);
+
+  return ++seq < end;
+}
+
+static
+void cmd_traceDump(TinyShBase& shell, int, const char **)
+{
+  PrintfToStream fio(shell.io());
+
+  if (traceDumpJob.isRunning())
+  {
+    shell.io().writeBlock("trace: busy\n");
+    return;
+  }
+
+  traceDumpJob.end = CommandTrace::ring.written;
+  traceDumpJob.seq = (traceDumpJob.end > TraceRing::DEPTH) ? traceDumpJob.end - TraceRing::DEPTH : 0;
+  fio.printf("%6s %10s %5s %-32s %3s %10s\n", "seq", "start", "sess", "command", "arg", "ticks");
+  shell.startJob(traceDumpJob);
+}
+
+static
+void cmd_traceClear(TinyShBase&, int, const char **)
+{
+  CommandTrace::clear();
+}
+
+static
+void cmd_traceInfo(TinyShBase& shell, int, const char **)
+{
+  PrintfToStream fio(shell.io());
+
+  fio.printf("ring 0x%08lx size %u, %u records of %u bytes, %lu written\n", (intptr_t)&CommandTrace::ring, (unsigned)sizeof(TraceRing),
+      TraceRing::DEPTH, (unsigned)sizeof(TraceRecord), (unsigned long)CommandTrace::ring.written);
+}
+
+static
+void cmd_traceOn(TinyShBase&, int, const char **)
+{
+  CommandTrace::enable();
+}
+
+static
+void cmd_traceOff(TinyShBase&, int, const char **)
+{
+  CommandTrace::disable();
+}
+
+static const CommandDescription traceOffCmd = { "off", "stop recording", 0, &cmd_traceOff, 0, 0, 0 };
+static const CommandDescription traceOnCmd = { "on", "start recording", 0, &cmd_traceOn, 0, (CommandDescription*)&traceOffCmd, 0 };
+static const CommandDescription traceInfoCmd = { "info", "display address and size of the trace ring", 0, &cmd_traceInfo, 0, (CommandDescription*)&traceOnCmd, 0 };
+static const CommandDescription traceClearCmd = { "clear", "clear the trace ring", 0, &cmd_traceClear, 0, (CommandDescription*)&traceInfoCmd, 0 };
+static const CommandDescription traceDumpCmd = { "dump", "display the recorded command executions", 0, &cmd_traceDump, 0, (CommandDescription*)&traceClearCmd, 0 };
+CommandDescription traceCmdGroup = { "trace", "command execution trace", "sub_cmd", 0, 0, 0, (CommandDescription*)&traceDumpCmd };
+
+} // namespace Shell
+
+#endif // TINYSH_EXEC_HOOKS
@@ -0,0 +1,82 @@
+/*
+ * CommandTrace.h
+ *
+ */
+
+#ifndef COMMANDTRACE_H_
+#define COMMANDTRACE_H_
+
+#include "TinySh.h"
+
+#include <stdint.h>
+
+#ifndef TINYSH_TRACE_DEPTH
+#define TINYSH_TRACE_DEPTH 64
+#endif
+
+namespace Shell
+{
+  /**
+   * Binary ring of the last TINYSH_TRACE_DEPTH command executions for post
+   * mortem analysis. A record is written by the post execution hook of TinyShBase
+   * (needs TINYSH_EXEC_HOOKS), it holds only numbers and the pointer to the
+   * command description, nothing is copied from the command line.
+   *
+   * The memory layout is fixed, so an image of the ring pulled from the target
+   * (e.g. with "mem hexdump" on the address shown by "trace info") can be
+   * decoded on the host with tools/tracedecode.cpp. All fields are in target
+   * byte order, the magic number tells the byte order.
+   */
+  struct TraceRecord
+  {
+    uint32_t timestamp; /* ticks at the start of the command */
+    uint32_t duration;  /* ticks until the command was done */
+    uint16_t session;   /* TinyShBase::sessionId() */
+    uint8_t argc;
+    uint8_t flags;      /* reserved, 0 */
+    uintptr_t cmd;      /* the CommandNode::key(), the CommandDescription or PackedNode */
+  };
+
+  struct TraceRing
+  {
+    static const uint32_t MAGIC = 0x54725368; /* "TrSh" */
+    static const uint16_t VERSION = 1;
+    static const unsigned DEPTH = TINYSH_TRACE_DEPTH;
+
+    uint32_t magic;
+    uint16_t version;
+    uint8_t recordSize;
+    uint8_t pointerSize;
+    uint32_t depth;
+    uint32_t written; /* total number of records written, next one goes to written % depth */
+    uint32_t ticksPerSecond;
+    uint32_t reserved;
+    TraceRecord records[DEPTH];
+  };
+
+  class CommandTrace
+  {
+  public:
+    /* install the trace as execution hook of the shells and start recording, the hooks installed before
+     * stay in place, the trace calls the post execution hook after its record */
+    static void enable();
+
+    /* stop recording, the hooks installed before are restored, unless others have been installed since */
+    static void disable();
+
+    static void clear();
+
+    static TraceRing ring;
+
+  private:
+    static void postExec(TinyShBase& shell, CommandNode cmd, int argc, uint32_t startTicks);
+
+    static PostExecHook_t chainedPost; /* installed before enable() */
+  };
+
+  /* "trace": dump, clear, info, on, off */
+  extern CommandDescription traceCmdGroup;
+
+} // namespace Shell
+
+#endif /* COMMANDTRACE_H_ */
@@ -0,0 +1,59 @@
+/*
+ * HelpText.cpp
+ *
+ */
+
+#include "HelpText.h"
+
+namespace Shell
+{
+
+#if TINYSH_COMPRESSED_HELP
+
+void HelpText::assign(const char *s)
+{
+  const unsigned char *p = (const unsigned char*)s;
+
+  len = 0;
+  text = 0;
+  if (!s)
+    return;
+
+  while (*p && (len < sizeof(buf) - 1))
+  {
+    unsigned char c = *p++;
+
+    if ((c == 0x80) && *p)
+    {
+      buf[len++] = *p++; /* escaped */
+    }
+    else if ((c > 0x80) && (unsigned(c - 0x81) < helpDictionaryCount))
+    {
+      const char *w = &helpDictionary[helpDictionaryIndex[c - 0x81]];
+
+      while (*w && (len < sizeof(buf) - 1))
+        buf[len++] = *w++;
+    }
+    else
+    {
+      buf[len++] = c;
+    }
+  }
+  buf[len] = 0;
+  text = buf;
+}
+
+#else
+
+void HelpText::assign(const char *s)
+{
+  text = s;
+  len = 0;
+  if (s)
+    while (s[len])
+      len++;
+}
+
+#endif
+
+} // namespace Shell
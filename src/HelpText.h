@@ -0,0 +1,80 @@
+/*
+ * HelpText.h
+ *
+ */
+
+#ifndef HELPTEXT_H_
+#define HELPTEXT_H_
+
+#include "TinySh.h"
+
+#ifndef TINYSH_HELP_EXPAND_SIZE
+#define TINYSH_HELP_EXPAND_SIZE 128
+#endif
+
+namespace Shell
+{
+#if TINYSH_COMPRESSED_HELP
+  /*
+   * The dictionary of the compressed help and usage texts, generated by
+   * tools/helpcompress: the NUL terminated words, and their offsets in the
+   * order of the codes 0x81, 0x82, ...
+   */
+  extern const char helpDictionary[];
+  extern const uint16_t helpDictionaryIndex[];
+  extern const unsigned helpDictionaryCount;
+#endif
+
+  /**
+   * The help or usage text of a CommandDescription ready for output.
+   *
+   * With TINYSH_COMPRESSED_HELP the texts are stored compressed: a byte
+   * 0x81 ... 0xFF stands for a word of the dictionary, the byte 0x80 escapes
+   * the following byte, any other byte is itself. The text is expanded into
+   * the buffer of this object, truncated to TINYSH_HELP_EXPAND_SIZE - 1
+   * characters. Plain texts without bytes above 0x7F are valid compressed
+   * texts, so commands added without the tool work as well.
+   *
+   * Without compression, this is just the pointer to the text.
+   */
+  class HelpText
+  {
+  public:
+    explicit HelpText(const char *s = 0);
+
+    void assign(const char *s);
+
+    /* the text, 0 if there is none */
+    const char* str() const;
+
+    unsigned length() const;
+
+  private:
+#if TINYSH_COMPRESSED_HELP
+    char buf[TINYSH_HELP_EXPAND_SIZE];
+#endif
+    const char *text;
+    unsigned len;
+  };
+
+  inline
+  HelpText::HelpText(const char *s)
+  {
+    assign(s);
+  }
+
+  inline
+  const char* HelpText::str() const
+  {
+    return text;
+  }
+
+  inline
+  unsigned HelpText::length() const
+  {
+    return len;
+  }
+
+} // namespace Shell
+
+#endif /* HELPTEXT_H_ */
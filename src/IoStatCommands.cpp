@@ -0,0 +1,107 @@
+/*
+ * IoStatCommands.cpp
+ *
+ */
+
+#include "IoStatCommands.h"
+#include "ShellJob.h"
+
+#include "Util/InstrumentedByteStream.h"
+#include "Util/PrintfToStream.h"
+
+namespace Shell
+{
+
+/*
+ * display of the counters, per stream and direction one line for the
+ * counters and two chunks for the halves of the block size histogram
+ */
+class IoStatJob: public OutputJob
+{
+public:
+  InstrumentedByteStream* stream;
+  unsigned part;
+
+protected:
+  virtual bool generate(TinyShBase& shell, ByteStream& out);
+};
+
+static IoStatJob ioStatJob;
+
+bool IoStatJob::generate(TinyShBase&, ByteStream& out)
+{
+  PrintfToStream fio(out);
+  static const unsigned HALF = (InstrumentedByteStream::BUCKETS + 1) / 2;
+  bool isIn = (part >= 3);
+  unsigned i, from, to;
+
+  if (!stream)
+    return false;
+
+  const InstrumentedByteStream::Counters& c = isIn ? stream->inCounters() : stream->outCounters();
+
+  switch (part % 3)
+  {
+  case 0:
+    fio.printf("%-10s %s: single %lu calls %lu bytes, block %lu calls %lu bytes, %lu ticks\n", stream->name(), isIn ? "in " : "out",
+        (unsigned long)c.singleCalls, (unsigned long)c.singleBytes, (unsigned long)c.blockCalls, (unsigned long)c.blockBytes, (unsigned long)c.ticks);
+    break;
+
+  default:
+    if (1 == part % 3)
+    {
+      fio.printf("%-10s %s: log2 block sizes:", "", isIn ? "in " : "out");
+      from = 0;
+      to = HALF;
+    }
+    else
+    {
+      from = HALF;
+      to = InstrumentedByteStream::BUCKETS;
+    }
+    for (i = from; i < to; i++)
+      if (c.blockSizes[i])
+        fio.printf(" %u:%lu", i, (unsigned long)c.blockSizes[i]);
+    if (2 == part % 3)
+      fio.printf("\n");
+    break;
+  }
+
+  if (++part >= 6)
+  {
+    part = 0;
+    stream = stream->next();
+  }
+
+  return 0 != stream;
+}
+
+static
+void cmd_ioStat(TinyShBase& shell, int argc, const char **argv)
+{
+  if ((2 == argc) && (argv[1][0] == 'r'))
+  {
+    InstrumentedByteStream* s;
+
+    for (s = InstrumentedByteStream::first(); s; s = s->next())
+      s->reset();
+  }
+  else if (ioStatJob.isRunning())
+  {
+    shell.io().writeBlock("iostat: busy\n");
+  }
+  else if (!InstrumentedByteStream::first())
+  {
+    shell.io().writeBlock("no instrumented streams\n");
+  }
+  else
+  {
+    ioStatJob.stream = InstrumentedByteStream::first();
+    ioStatJob.part = 0;
+    shell.startJob(ioStatJob);
+  }
+}
+
+const CommandDescription ioStatCommand = { "iostat", "display or reset the byte stream counters", "[reset]", &cmd_ioStat, 0, 0, 0 };
+
+} // namespace Shell
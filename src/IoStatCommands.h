@@ -0,0 +1,19 @@
+/*
+ * IoStatCommands.h
+ *
+ */
+
+#ifndef IOSTATCOMMANDS_H_
+#define IOSTATCOMMANDS_H_
+
+#include "TinySh.h"
+
+namespace Shell
+{
+
+/* "iostat [reset]": display or reset the counters of all InstrumentedByteStream objects */
+extern const CommandDescription ioStatCommand;
+
+} // namespace Shell
+
+#endif /* IOSTATCOMMANDS_H_ */
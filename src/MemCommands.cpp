@@ -4,172 +4,1313 @@
  */
 
 #include "MemCommands.h"
+#include "ShellJob.h"
+#include "ShellClock.h"
+#include "SymbolCommands.h"
 
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef NDEBUG
+#undef DEBUG
+#else
+#ifndef DEBUG
+#define DEBUG
+#endif
+#endif
+
+#include "Util/PrintfToStream.h"
+#include "Util/NumberParser.h"
+#include "Util/Crc32.h"
+#include "Util/Base64.h"
+
+namespace Shell
+{
+static unsigned ptr = 0;
+
+extern
+unsigned char *memCmdsBasePtr;
+unsigned char *memCmdsBasePtr = 0;
+
+#ifdef DEBUG
+static
+void cmd_mapTest(TinyShBase& shell, int argc, const char **argv)
+{
+  static unsigned char* obj = 0;
+  static unsigned objSize = 64;
+
+  PrintfToStream fio(shell.io());
+
+  if (0 == obj)
+  {
+    unsigned i;
+    obj = (unsigned char*)malloc(objSize);
+    for (i = 0; i < objSize; i++)
+    {
+      obj[i] = i;
+    }
+    memCmdsBasePtr = obj;
+  }
+
+  fio.printf("addr: 0x%08lx size: %u (0x%04x)\n", (intptr_t)obj, objSize, objSize);
+}
+#endif // DEBUG
+
+#ifndef MEMCMDS_SLICE_SIZE
+#define MEMCMDS_SLICE_SIZE 256 /* bytes or elements to process per job step */
+#endif
+
+/*
+ * The mem commands working on ranges run as a job, MEMCMDS_SLICE_SIZE units
+ * per step. So the shell stays responsive on large ranges and they can be
+ * cancelled with CTRL-C. Commands with output produce one line per generate()
+ * call, so they are formatted only as fast as the IO stream takes them.
+ */
+class MemJob: public OutputJob
+{
+public:
+  enum Kind
+  {
+    HEXDUMP, COPY, COMPARE, READ, FILL
+  };
+
+  /* get the job for the shell, or 0, if it is busy for an other shell */
+  static MemJob* claim(TinyShBase& shell);
+
+  void start(TinyShBase& shell, Kind k, unsigned num);
+
+  virtual void cancel(TinyShBase& shell);
+  virtual bool progress(unsigned long& done, unsigned long& total);
+
+  intptr_t opType;
+  unsigned src;
+  unsigned dest;
+  unsigned long value;
+  bool diff;
+
+protected:
+  virtual bool generate(TinyShBase& shell, ByteStream& out);
+
+private:
+  void finish(ByteStream& out);
+
+  Kind kind;
+  unsigned len;
+  unsigned pos;
+  unsigned differences;
+  bool lineOpen; /* the annotation and the end of the hexdump line follow in the next chunk */
+  uintptr_t lineAddr;
+};
+
+static MemJob memJob;
+
+MemJob* MemJob::claim(TinyShBase& shell)
+{
+  if (memJob.isRunning())
+  {
+    shell.io().writeBlock("mem: busy\n");
+    return 0;
+  }
+
+  memJob.opType = 0;
+  memJob.diff = false;
+  return &memJob;
+}
+
+void MemJob::start(TinyShBase& shell, Kind k, unsigned num)
+{
+  kind = k;
+  len = num;
+  pos = 0;
+  differences = 0;
+  lineOpen = false;
+  shell.startJob(*this);
+}
+
+bool MemJob::generate(TinyShBase&, ByteStream& out)
+{
+  PrintfToStream fio(out);
+  unsigned end = pos + MEMCMDS_SLICE_SIZE;
+  unsigned j;
+
+  if ((end > len) || (end < pos))
+    end = len;
+
+  switch (kind)
+  {
+  case HEXDUMP:
+    if (lineOpen)
+    {
+      /* in a chunk of its own, the symbol may fill most of it */
+      annotateAddress(out, lineAddr);
+      fio.printf("\n");
+      lineOpen = false;
+    }
+    else if (pos < len)
+    {
+      unsigned char *buf = memCmdsBasePtr + src;
+      fio.printf("%08lx: ", (intptr_t)(buf + pos));
+      for (j = 0; j < 16; j++)
+        if (pos + j < len)
+          fio.printf("%02x ", buf[pos + j]);
+        else
+          fio.printf("   ");
+      fio.printf(" ");
+      for (j = 0; j < 16; j++)
+        if (pos + j < len)
+          fio.printf("%c", isprint(buf[pos + j]) ? buf[pos + j] : '.');
+      lineAddr = (uintptr_t)(buf + pos);
+      lineOpen = (0 != symbolTable());
+      if (!lineOpen)
+        fio.printf("\n");
+      pos = (len - pos > 16) ? pos + 16 : len;
+    }
+    break;
+
+  case COPY:
+    for (; pos < end; ++pos)
+    {
+      memCmdsBasePtr[dest + pos] = memCmdsBasePtr[src + pos];
+    }
+    break;
+
+  case COMPARE:
+    for (; pos < end; ++pos)
+    {
+      if (memCmdsBasePtr[dest + pos] != memCmdsBasePtr[src + pos])
+      {
+        differences++;
+        if (diff)
+        {
+          unsigned char c1 = memCmdsBasePtr[src + pos];
+          unsigned char c2 = memCmdsBasePtr[dest + pos];
+          fio.printf("found difference 0x%08lx: %02x %c | 0x%08lx: %02x %c\n", (intptr_t)&memCmdsBasePtr[src + pos], c1, isprint(c1)?c1:'.', (intptr_t)&memCmdsBasePtr[dest + pos], c2, isprint(c2)?c2:'.');
+          ++pos;
+          break; /* one line per chunk */
+        }
+      }
+    }
+    break;
+
+  case READ:
+    if (pos < len)
+    {
+      const char* format;
+      intptr_t addr;
+      unsigned long v;
+
+      switch (opType)
+      {
+      default:
+      case 0:
+        format = "0x%08lx: 0x%02x";
+        v = memCmdsBasePtr[src + pos];
+        addr = (intptr_t)(&memCmdsBasePtr[src + pos]);
+        break;
+
+      case 1:
+        format = "0x%08lx: 0x%04x";
+        v = *((unsigned short*)(&memCmdsBasePtr[src]) + pos);
+        addr = (intptr_t)((unsigned short*)(&memCmdsBasePtr[src]) + pos);
+        break;
+
+      case 2:
+        format = "0x%08lx: 0x%08x";
+        v = *((unsigned long*)(&memCmdsBasePtr[src]) + pos);
+        addr = (intptr_t)((unsigned long*)(&memCmdsBasePtr[src]) + pos);
+        break;
+
+      }
+
+      fio.printf(format, addr, v);
+      annotateAddress(out, (uintptr_t)addr);
+      fio.printf("\n");
+      ++pos;
+    }
+    break;
+
+  case FILL:
+    for (; pos < end; ++pos)
+    {
+      switch (opType)
+      {
+      case 0:
+        memCmdsBasePtr[src + pos] = (unsigned char)value;
+        break;
+
+      case 1:
+        *((unsigned short*)&memCmdsBasePtr[src] + pos) = (unsigned short)value;
+        break;
+
+      case 2:
+        *((unsigned long*)&memCmdsBasePtr[src] + pos) = (unsigned long)value;
+        break;
+
+      }
+    }
+    break;
+  }
+
+  if ((pos < len) || lineOpen)
+    return true;
+
+  finish(out);
+  return false;
+}
+
+void MemJob::cancel(TinyShBase& shell)
+{
+  OutputJob::cancel(shell);
+  if (lineOpen)
+    shell.io().write('\n');
+  lineOpen = false;
+  finish(shell.io());
+}
+
+bool MemJob::progress(unsigned long& done, unsigned long& total)
+{
+  done = pos;
+  total = len;
+  return true;
+}
+
+void MemJob::finish(ByteStream& out)
+{
+  PrintfToStream fio(out);
+
+  switch (kind)
+  {
+  case HEXDUMP:
+    ptr = src + pos;
+    break;
+
+  case COMPARE:
+    if (pos < len)
+      fio.printf("%u differences in the first %u bytes\n", differences, pos);
+    else
+      fio.printf("total %u differences\n", differences);
+    break;
+
+  default:
+    break;
+  }
+}
+
+#ifndef MEMCMDS_LOAD_WINDOW
+#define MEMCMDS_LOAD_WINDOW 256 /* raw bytes per acknowledgement, the input buffer of the stream must take them */
+#endif
+
+#ifndef MEMCMDS_LOAD_TIMEOUT
+#define MEMCMDS_LOAD_TIMEOUT 5 /* seconds without raw data, until the load is aborted (with a tick source) */
+#endif
+
+/*
+ * mem load puts the session into a streaming receive mode for an image. Intel
+ * HEX and S-record lines are decoded as they arrive, each record is answered
+ * with ACK, when its checksum is right and its data is written, or with NAK,
+ * then the host sends it again. A raw block is a 32 bit length (little
+ * endian) followed by the bytes, which are read straight into the memory, an
+ * ACK follows every MEMCMDS_LOAD_WINDOW bytes and the last one. The host sends
+ * the next record or window after the ACK only, so nothing is lost.
+ *
+ * The end record or the end of the block finishes the load with the CRC-32 of
+ * the written data and the throughput since the command. Text formats can be
+ * cancelled with CTRL-C, a raw block takes all bytes and ends by a timeout,
+ * so it is refused without a tick source.
+ */
+class LoadJob: public Job
+{
+public:
+  enum Format
+  {
+    IHEX, SREC, RAW
+  };
+
+  void start(TinyShBase& shell, Format f, unsigned off);
+
+  virtual bool step(TinyShBase& shell);
+  virtual void cancel(TinyShBase& shell);
+  virtual bool progress(unsigned long& done, unsigned long& total);
+  virtual bool input(TinyShBase& shell, char c);
+  virtual bool rawInput() const;
+
+private:
+  enum
+  {
+    ACK = 0x06,
+    NAK = 0x15,
+    CANCEL = 0x03, /* CTRL-C */
+    RECORD_SIZE = 260 /* Intel HEX with 255 data bytes */
+  };
+
+  enum State
+  {
+    IDLE, TYPE, DATA
+  };
+
+  void receive(ByteStream& io, unsigned char c);
+  void rawStored(ByteStream& io, unsigned n);
+  void endOfRecord(ByteStream& io);
+  bool ihexRecord();
+  bool srecRecord();
+  void store(unsigned long addr, const unsigned char *data, unsigned n);
+  void summary(ByteStream& out, const char *result);
+
+  Format format;
+  State state;
+  unsigned offset;
+  unsigned long base; /* Intel HEX segment or linear address */
+  unsigned char record[RECORD_SIZE];
+  unsigned recordLen;
+  char recordType; /* S-record type digit */
+  bool lowNibble;
+  bool bad;
+  bool finished;
+  unsigned header; /* length bytes of a raw block received */
+  unsigned long length;
+  unsigned long bytes;
+  unsigned long records;
+  unsigned long errors;
+  unsigned long arrived;
+  unsigned long seen;
+  uint32_t crc;
+  uint32_t startTicks;
+  uint32_t lastTicks;
+};
+
+static LoadJob loadJob;
+
+void LoadJob::start(TinyShBase& shell, Format f, unsigned off)
+{
+  format = f;
+  state = IDLE;
+  offset = off;
+  base = 0;
+  recordLen = 0;
+  finished = false;
+  header = 0;
+  length = 0;
+  bytes = 0;
+  records = 0;
+  errors = 0;
+  arrived = 0;
+  seen = 0;
+  crc = 0;
+  startTicks = ticks();
+  lastTicks = startTicks;
+  shell.startJob(*this);
+}
+
+bool LoadJob::step(TinyShBase& shell)
+{
+  ByteStream& io = shell.io();
+  unsigned n = 0;
+  unsigned char c;
+
+  /* take what the stream has, the data of a raw block without a copy */
+  while (!finished && (n < MEMCMDS_SLICE_SIZE))
+  {
+    if ((RAW == format) && (4 == header))
+    {
+      unsigned want = MEMCMDS_LOAD_WINDOW - bytes % MEMCMDS_LOAD_WINDOW;
+      unsigned got;
+
+      if (want > length - bytes)
+        want = length - bytes;
+      got = io.readBlock(memCmdsBasePtr + (unsigned)(offset + bytes), want);
+      if (!got)
+        break;
+      arrived += got;
+      rawStored(io, got);
+      n += got;
+    }
+    else if (io.read(c))
+    {
+      if ((RAW != format) && (CANCEL == c))
+      {
+        io.writeBlock("^C\n");
+        summary(io, "cancelled");
+        return false;
+      }
+      receive(io, c);
+      n++;
+    }
+    else
+      break;
+  }
+
+  if (finished)
+  {
+    summary(io, "done");
+    return false;
+  }
+
+  if (arrived != seen)
+  {
+    seen = arrived;
+    lastTicks = ticks();
+  }
+  else if ((RAW == format) && ticksPerSecond()
+           && (ticks() - lastTicks > (uint32_t)MEMCMDS_LOAD_TIMEOUT * ticksPerSecond()))
+  {
+    summary(io, "timeout");
+    return false;
+  }
+
+  return true;
+}
+
+void LoadJob::cancel(TinyShBase& shell)
+{
+  summary(shell.io(), "cancelled");
+}
+
+bool LoadJob::progress(unsigned long& done, unsigned long& total)
+{
+  done = bytes;
+  total = (RAW == format) ? length : 0;
+  return true;
+}
+
+bool LoadJob::input(TinyShBase& shell, char c)
+{
+  if (!finished)
+    receive(shell.io(), (unsigned char)c);
+  return true;
+}
+
+bool LoadJob::rawInput() const
+{
+  return RAW == format;
+}
+
+/* one byte of the stream
+ */
+void LoadJob::receive(ByteStream& io, unsigned char c)
+{
+  unsigned d;
+
+  arrived++;
+
+  if (RAW == format)
+  {
+    if (header < 4)
+    {
+      length |= (unsigned long)c << (8 * header++);
+      if ((4 == header) && !length)
+      {
+        io.write((unsigned char)ACK);
+        finished = true;
+      }
+    }
+    else
+    {
+      memCmdsBasePtr[(unsigned)(offset + bytes)] = c;
+      rawStored(io, 1);
+    }
+    return;
+  }
+
+  switch (state)
+  {
+  case IDLE:
+    /* anything between the records, e.g. the line ends, is skipped */
+    recordLen = 0;
+    lowNibble = false;
+    bad = false;
+    if ((IHEX == format) && (':' == c))
+      state = DATA;
+    else if ((SREC == format) && ('S' == c))
+      state = TYPE;
+    break;
+
+  case TYPE:
+    recordType = c;
+    bad = (c < '0') || (c > '9');
+    state = DATA;
+    break;
+
+  case DATA:
+    if (('\r' == c) || ('\n' == c))
+    {
+      endOfRecord(io);
+      state = IDLE;
+      break;
+    }
+    d = c - '0';
+    if (d > 9)
+      d = ((c | 0x20) - 'a' < 6) ? (c | 0x20) - 'a' + 10 : 16;
+    if ((d > 15) || (recordLen >= RECORD_SIZE))
+      bad = true;
+    else if (lowNibble)
+      record[recordLen++] |= d;
+    else
+      record[recordLen] = d << 4;
+    lowNibble = !lowNibble;
+    break;
+  }
+}
+
+/* n bytes of a raw block are in the memory
+ */
+void LoadJob::rawStored(ByteStream& io, unsigned n)
+{
+  crc = Crc32::update(crc, memCmdsBasePtr + (unsigned)(offset + bytes), n);
+  bytes += n;
+  if ((0 == bytes % MEMCMDS_LOAD_WINDOW) || (bytes == length))
+    io.write((unsigned char)ACK);
+  if (bytes == length)
+    finished = true;
+}
+
+void LoadJob::endOfRecord(ByteStream& io)
+{
+  bool ok = !bad && !lowNibble && ((IHEX == format) ? ihexRecord() : srecRecord());
+
+  if (ok)
+    records++;
+  else
+    errors++;
+  io.write((unsigned char)(ok ? ACK : NAK));
+}
+
+/* :LLAAAATT<data>CC, the sum of all bytes is 0
+ */
+bool LoadJob::ihexRecord()
+{
+  unsigned char sum = 0;
+  unsigned len = record[0];
+  unsigned i;
+
+  if ((recordLen < 5) || (len + 5 != recordLen))
+    return false;
+  for (i = 0; i < recordLen; i++)
+    sum += record[i];
+  if (sum)
+    return false;
+
+  switch (record[3])
+  {
+  case 0: /* data */
+    store(base + ((unsigned)record[1] << 8) + record[2], &record[4], len);
+    return true;
+
+  case 1: /* end of file */
+    finished = true;
+    return true;
+
+  case 2: /* extended segment address */
+  case 4: /* extended linear address */
+    if (2 != len)
+      return false;
+    base = (((unsigned long)record[4] << 8) | record[5]) << ((2 == record[3]) ? 4 : 16);
+    return true;
+
+  case 3: /* start addresses */
+  case 5:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/* S<type>LL<address><data>CC, LL counts the bytes after it, the sum of all bytes is 0xFF
+ */
+bool LoadJob::srecRecord()
+{
+  static const unsigned char ADDRESS_SIZE[10] = { 2, 2, 3, 4, 0, 2, 3, 4, 3, 2 };
+  unsigned char sum = 0;
+  unsigned type = recordType - '0';
+  unsigned addrLen = ADDRESS_SIZE[type];
+  unsigned long addr = 0;
+  unsigned i;
+
+  if (!addrLen || (recordLen < addrLen + 2) || (record[0] + 1u != recordLen))
+    return false;
+  for (i = 0; i < recordLen; i++)
+    sum += record[i];
+  if (0xFF != sum)
+    return false;
+
+  for (i = 1; i <= addrLen; i++)
+    addr = (addr << 8) | record[i];
+
+  if ((type >= 1) && (type <= 3)) /* data */
+    store(addr, &record[1 + addrLen], recordLen - addrLen - 2);
+  else if (type >= 7) /* end, the start address is not used */
+    finished = true;
+  /* S0 header and S5/S6 record count are only checked */
+
+  return true;
+}
+
+void LoadJob::store(unsigned long addr, const unsigned char *data, unsigned n)
+{
+  memcpy(memCmdsBasePtr + (unsigned)(offset + addr), data, n);
+  crc = Crc32::update(crc, data, n);
+  bytes += n;
+}
+
+void LoadJob::summary(ByteStream& out, const char *result)
+{
+  PrintfToStream fio(out);
+
+  fio.printf("load %s: %lu bytes", result, bytes);
+  if (RAW != format)
+    fio.printf(" in %lu records, %lu errors", records, errors);
+  fio.printf(", crc32 0x%08lx", (unsigned long)crc);
+  if (ticksPerSecond())
+  {
+    uint64_t us = ticksToMicros(ticks() - startTicks);
+
+    fio.printf(", %llu us", (unsigned long long)us);
+    if (us)
+      fio.printf(", %llu bytes/s", (unsigned long long)(bytes * 1000000ull / us));
+  }
+  fio.printf("\n");
+}
+
+/*
+ * mem get streams a memory range to the host as a frame: raw as STX, the 32
+ * bit length (little endian), the bytes and their CRC-32 (little endian), or
+ * as base64 lines of 76 characters and a line with the CRC-32. The chunks are
+ * copied or encoded at the rate the stream takes them.
+ */
+class GetJob: public OutputJob
+{
+public:
+  void start(TinyShBase& shell, unsigned addr, unsigned num, bool rawFrame);
+
+  virtual void cancel(TinyShBase& shell);
+  virtual bool progress(unsigned long& done, unsigned long& total);
+
+protected:
+  virtual bool generate(TinyShBase& shell, ByteStream& out);
+
+private:
+  enum
+  {
+    STX = 0x02,
+    /* bytes per base64 line with its line end */
+    LINE_BYTES = ((TINYSH_OUTPUT_CHUNK_SIZE - 1) / 4 * 3 < 57) ? (TINYSH_OUTPUT_CHUNK_SIZE - 1) / 4 * 3 : 57
+  };
+
+  void writeWord(ByteStream& out, uint32_t w);
+
+  unsigned src;
+  unsigned len;
+  unsigned pos;
+  bool raw;
+  bool started;
+  uint32_t crc;
+};
+
+static GetJob getJob;
+
+void GetJob::start(TinyShBase& shell, unsigned addr, unsigned num, bool rawFrame)
+{
+  src = addr;
+  len = num;
+  pos = 0;
+  raw = rawFrame;
+  started = false;
+  crc = 0;
+  shell.startJob(*this);
+}
+
+void GetJob::writeWord(ByteStream& out, uint32_t w)
+{
+  unsigned char b[4] = { (unsigned char)w, (unsigned char)(w >> 8), (unsigned char)(w >> 16), (unsigned char)(w >> 24) };
+
+  out.writeBlock(b, sizeof(b));
+}
+
+bool GetJob::generate(TinyShBase&, ByteStream& out)
+{
+  const unsigned char *data = memCmdsBasePtr + src + pos;
+  unsigned n = len - pos;
+
+  if (!started)
+  {
+    started = true;
+    if (raw)
+    {
+      out.write((unsigned char)STX);
+      writeWord(out, len);
+    }
+    return true;
+  }
+
+  if (!n)
+  {
+    if (raw)
+      writeWord(out, crc);
+    else
+      PrintfToStream(out).printf("crc32 0x%08lx\n", (unsigned long)crc);
+    return false;
+  }
+
+  if (n > (raw ? TINYSH_OUTPUT_CHUNK_SIZE : LINE_BYTES))
+    n = raw ? TINYSH_OUTPUT_CHUNK_SIZE : LINE_BYTES;
+  crc = Crc32::update(crc, data, n);
+  pos += n;
+
+  if (raw)
+  {
+    out.writeBlock(data, n);
+  }
+  else
+  {
+    char line[LINE_BYTES / 3 * 4 + 1];
+    unsigned k = Base64::encode(line, data, n);
+
+    line[k++] = '\n';
+    out.writeBlock(line, k);
+  }
+
+  return true;
+}
+
+void GetJob::cancel(TinyShBase& shell)
+{
+  PrintfToStream fio(shell.io());
+
+  OutputJob::cancel(shell);
+  fio.printf("get cancelled after %u of %u bytes\n", pos, len);
+}
+
+bool GetJob::progress(unsigned long& done, unsigned long& total)
+{
+  done = pos;
+  total = len;
+  return true;
+}
+
+#ifndef MEMCMDS_SNAP_ARENA_SIZE
+#define MEMCMDS_SNAP_ARENA_SIZE 4096 /* bytes of the built in snapshot arena, see memSnapArena() */
+#endif
+
+#ifndef MEMCMDS_SNAP_COUNT
+#define MEMCMDS_SNAP_COUNT 4
+#endif
+
+#ifndef MEMCMDS_SNAP_BLOCK
+#define MEMCMDS_SNAP_BLOCK 64 /* bytes per block hash, a multiple of the word size */
+#endif
+
+/*
+ * mem snap keeps a copy of a range and a hash per block of it in the
+ * snapshot arena, the snapshots are packed at its start. mem delta hashes the
+ * blocks of the range, an unchanged block is skipped after reading it once,
+ * the others are compared word by word with the copy to find the changed
+ * ranges. A changed block with the same hash (probability 2^-32) is missed.
+ */
+struct Snapshot
+{
+  char name[12];
+  unsigned addr;
+  unsigned len;
+  unsigned offset; /* in the arena, the hashes, then the copy */
+};
+
+typedef uintptr_t SnapWord;
+
+static uint32_t snapArenaDefault[MEMCMDS_SNAP_ARENA_SIZE / sizeof(uint32_t)];
+static unsigned char *snapArena = (unsigned char*)snapArenaDefault;
+static unsigned snapArenaSize = sizeof(snapArenaDefault);
+static Snapshot snapshots[MEMCMDS_SNAP_COUNT];
+static unsigned snapCount = 0;
+
+static inline unsigned snap_blocks(unsigned len)
+{
+  return (len + MEMCMDS_SNAP_BLOCK - 1) / MEMCMDS_SNAP_BLOCK;
+}
+
+/* arena bytes of a snapshot, a multiple of 4 for the hashes of the next one */
+static inline unsigned snap_size(unsigned len)
+{
+  return snap_blocks(len) * sizeof(uint32_t) + ((len + 3) & ~3u);
+}
+
+static inline uint32_t* snap_hashes(const Snapshot& s)
+{
+  return (uint32_t*)(snapArena + s.offset);
+}
+
+static inline unsigned char* snap_copy(const Snapshot& s)
+{
+  return snapArena + s.offset + snap_blocks(s.len) * sizeof(uint32_t);
+}
+
+/* hash of len bytes, a word at a time
+ */
+static uint32_t snap_hash(const unsigned char *p, unsigned len)
+{
+  SnapWord h = 0, w;
+  unsigned i;
+
+  for (i = 0; i + sizeof(SnapWord) <= len; i += sizeof(SnapWord))
+  {
+    memcpy(&w, p + i, sizeof(w));
+    h = (h ^ w) * (SnapWord)0x9E3779B97F4A7C15ULL;
+  }
+  for (; i < len; i++)
+    h = (h ^ p[i]) * (SnapWord)0x9E3779B97F4A7C15ULL;
+
+  return (uint32_t)(h ^ (h >> (sizeof(SnapWord) * 4)));
+}
+
+static Snapshot* snap_find(const char *name)
+{
+  unsigned i;
+
+  for (i = 0; i < snapCount; i++)
+    if (0 == strcmp(snapshots[i].name, name))
+      return &snapshots[i];
+
+  return 0;
+}
+
+/* remove a snapshot, the ones behind it move down in the arena
+ */
+static void snap_drop(Snapshot* s)
+{
+  unsigned size = snap_size(s->len);
+  unsigned end = s->offset + size;
+  Snapshot& last = snapshots[snapCount - 1];
+  unsigned i = s - snapshots;
+
+  memmove(snapArena + s->offset, snapArena + end, last.offset + snap_size(last.len) - end);
+  for (; i + 1 < snapCount; i++)
+  {
+    snapshots[i] = snapshots[i + 1];
+    snapshots[i].offset -= size;
+  }
+  snapCount--;
+}
+
+void memSnapArena(void *mem, unsigned size)
+{
+  snapArena = (unsigned char*)mem;
+  snapArenaSize = size;
+  snapCount = 0;
+}
+
+/*
+ * mem delta, one line per changed range, a range may span blocks
+ */
+class DeltaJob: public OutputJob
+{
+public:
+  void start(TinyShBase& shell, Snapshot& s, bool rollForward);
+
+  virtual void cancel(TinyShBase& shell);
+  virtual bool progress(unsigned long& done, unsigned long& total);
+
+protected:
+  virtual bool generate(TinyShBase& shell, ByteStream& out);
+
+private:
+  void range(ByteStream& out, unsigned end);
+  void finish(ByteStream& out);
+
+  Snapshot *snap;
+  bool roll;
+  bool inRun;
+  unsigned pos;
+  unsigned runStart;
+  unsigned ranges;
+  unsigned changed;
+  unsigned skipped; /* blocks with an unchanged hash */
+};
+
+static DeltaJob deltaJob;
+
+void DeltaJob::start(TinyShBase& shell, Snapshot& s, bool rollForward)
+{
+  snap = &s;
+  roll = rollForward;
+  inRun = false;
+  pos = 0;
+  ranges = 0;
+  changed = 0;
+  skipped = 0;
+  shell.startJob(*this);
+}
+
+void DeltaJob::range(ByteStream& out, unsigned end)
+{
+  const unsigned char *live = memCmdsBasePtr + snap->addr;
+  PrintfToStream fio(out);
+
+  inRun = false;
+  ranges++;
+  changed += end - runStart;
+  fio.printf("0x%08lx..0x%08lx: %u bytes", (intptr_t)(live + runStart), (intptr_t)(live + end - 1), end - runStart);
+  annotateAddress(out, (uintptr_t)(live + runStart));
+  fio.printf("\n");
+}
+
+bool DeltaJob::generate(TinyShBase&, ByteStream& out)
+{
+  const unsigned char *live = memCmdsBasePtr + snap->addr;
+  unsigned char *copy = snap_copy(*snap);
+  uint32_t *hashes = snap_hashes(*snap);
+  unsigned budget = 4 * MEMCMDS_SLICE_SIZE; /* bytes, mostly hashed ones */
+
+  while (pos < snap->len)
+  {
+    unsigned block = pos / MEMCMDS_SNAP_BLOCK;
+    unsigned end = (block + 1) * MEMCMDS_SNAP_BLOCK;
+    unsigned i = pos;
+
+    if (end > snap->len)
+      end = snap->len;
+
+    if (budget < end - pos)
+      return true;
+    budget -= end - pos;
+
+    /* an unchanged block ends an open range at its first byte */
+    if ((pos == block * MEMCMDS_SNAP_BLOCK) && !inRun && (snap_hash(live + pos, end - pos) == hashes[block]))
+    {
+      skipped++;
+      pos = end;
+      continue;
+    }
+
+    while (i < end)
+    {
+      if (!inRun)
+      {
+        while ((i + sizeof(SnapWord) <= end) && (0 == memcmp(live + i, copy + i, sizeof(SnapWord))))
+          i += sizeof(SnapWord);
+        while ((i < end) && (live[i] == copy[i]))
+          i++;
+        if (i < end)
+        {
+          inRun = true;
+          runStart = i;
+        }
+      }
+      else
+      {
+        while ((i < end) && (live[i] != copy[i]))
+          i++;
+        if (i < end)
+        {
+          /* one line per chunk, the block is continued in the next one */
+          range(out, i);
+          pos = i;
+          return true;
+        }
+      }
+    }
+
+    if (roll)
+    {
+      unsigned start = block * MEMCMDS_SNAP_BLOCK;
+
+      memcpy(copy + start, live + start, end - start);
+      hashes[block] = snap_hash(copy + start, end - start);
+    }
+    pos = end;
+  }
 
-#include <stdlib.h>
-#include <stdint.h>
-#include <ctype.h>
+  if (inRun)
+  {
+    range(out, pos);
+    return true;
+  }
 
-#ifdef NDEBUG
-#undef DEBUG
+  finish(out);
+  return false;
+}
+
+void DeltaJob::cancel(TinyShBase& shell)
+{
+  OutputJob::cancel(shell);
+  if (inRun)
+    range(shell.io(), pos);
+  finish(shell.io());
+}
+
+bool DeltaJob::progress(unsigned long& done, unsigned long& total)
+{
+  done = pos;
+  total = snap->len;
+  return true;
+}
+
+void DeltaJob::finish(ByteStream& out)
+{
+  PrintfToStream fio(out);
+
+  if (pos < snap->len)
+    fio.printf("%u ranges, %u bytes changed in the first %u bytes", ranges, changed, pos);
+  else
+    fio.printf("%u ranges, %u bytes changed, %u of %u blocks unchanged", ranges, changed, skipped, snap_blocks(snap->len));
+  fio.printf(roll ? ", rolled forward\n" : "\n");
+}
+
+#ifndef MEMCMDS_POLL_SPINS
+#define MEMCMDS_POLL_SPINS 1000 /* reads with a pause instruction in between in the first step of mem poll */
+#endif
+
+#ifndef MEMCMDS_POLL_YIELDS
+#define MEMCMDS_POLL_YIELDS 1000 /* steps with one read after the spinning, then the reads sleep */
+#endif
+
+#ifndef MEMCMDS_POLL_SLEEP_US
+#define MEMCMDS_POLL_SLEEP_US 1000 /* time between two reads, while they sleep (with a tick source) */
+#endif
+
+#ifndef MEMCMDS_CPU_RELAX
+#if defined(__i386__) || defined(__x86_64__)
+#define MEMCMDS_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__arm__) || defined(__aarch64__)
+#define MEMCMDS_CPU_RELAX() __asm__ volatile ("yield")
 #else
-#ifndef DEBUG
-#define DEBUG
+#define MEMCMDS_CPU_RELAX() do {} while (0)
 #endif
 #endif
 
-#include "Util/PrintfToStream.h"
+/*
+ * mem poll waits for (*addr & mask) == value. The first step spins with a
+ * pause instruction between the reads for the fastest answer, then each step
+ * reads once and returns to the main loop (yield), at last the reads are
+ * MEMCMDS_POLL_SLEEP_US apart and the main loop may sleep in between.
+ */
+class PollJob: public Job
+{
+public:
+  void start(TinyShBase& shell, unsigned width, unsigned addr, uint64_t mask, uint64_t value, uint32_t timeoutMs);
+
+  virtual bool step(TinyShBase& shell);
+  virtual void cancel(TinyShBase& shell);
+  virtual bool progress(unsigned long& done, unsigned long& total);
+
+private:
+  bool spin(unsigned n);
+  void summary(ByteStream& out, const char *result);
+
+  const volatile void *location;
+  unsigned bytes;
+  uint64_t mask;
+  uint64_t value;
+  uint64_t last;
+  unsigned long reads;
+  unsigned long steps;
+  uint32_t startTicks;
+  uint32_t timeout; /* ticks, 0 for none */
+  uint32_t nextRead; /* ticks, while sleeping */
+};
+
+static PollJob pollJob;
+
+/* n reads of *p, with a pause in between, until the value matches, return the number of reads
+ */
+template<typename T>
+static unsigned poll_spin(const volatile T *p, T mask, T value, unsigned n, uint64_t& last)
+{
+  unsigned i = 0;
+  T v;
 
-namespace Shell
+  while (1)
+  {
+    v = *p;
+    i++;
+    if (((v & mask) == value) || (i >= n))
+      break;
+    MEMCMDS_CPU_RELAX();
+  }
+  last = v;
+
+  return i;
+}
+
+void PollJob::start(TinyShBase& shell, unsigned width, unsigned addr, uint64_t m, uint64_t v, uint32_t timeoutMs)
 {
-static unsigned ptr = 0;
+  location = memCmdsBasePtr + addr;
+  bytes = width;
+  mask = m;
+  value = v & m;
+  last = 0;
+  reads = 0;
+  steps = 0;
+  startTicks = ticks();
+  nextRead = startTicks;
+  timeout = (uint32_t)((uint64_t)timeoutMs * ticksPerSecond() / 1000);
+  if (timeoutMs && !timeout)
+    timeout = 1;
+  shell.startJob(*this);
+}
 
-extern
-unsigned char *memCmdsBasePtr;
-unsigned char *memCmdsBasePtr = 0;
+/* n reads, return true on a match
+ */
+bool PollJob::spin(unsigned n)
+{
+  switch (bytes)
+  {
+  case 1:
+    reads += poll_spin((const volatile uint8_t*)location, (uint8_t)mask, (uint8_t)value, n, last);
+    break;
 
-#ifdef DEBUG
-static
-void cmd_mapTest(TinySh& shell, int argc, const char **argv)
+  case 2:
+    reads += poll_spin((const volatile uint16_t*)location, (uint16_t)mask, (uint16_t)value, n, last);
+    break;
+
+  case 4:
+    reads += poll_spin((const volatile uint32_t*)location, (uint32_t)mask, (uint32_t)value, n, last);
+    break;
+
+  default:
+    reads += poll_spin((const volatile uint64_t*)location, mask, value, n, last);
+    break;
+  }
+
+  return (last & mask) == value;
+}
+
+bool PollJob::step(TinyShBase& shell)
 {
-  static unsigned char* obj = 0;
-  static unsigned objSize = 64;
+  uint32_t now = ticks();
 
-  PrintfToStream fio(shell.io());
+  if (timeout && (now - startTicks >= timeout))
+  {
+    summary(shell.io(), "timeout");
+    return false;
+  }
 
-  if (0 == obj)
+  if (steps > MEMCMDS_POLL_YIELDS)
   {
-    unsigned i;
-    obj = (unsigned char*)malloc(objSize);
-    for (i = 0; i < objSize; i++)
-    {
-      obj[i] = i;
-    }
-    memCmdsBasePtr = obj;
+    if ((int32_t)(now - nextRead) < 0)
+      return true;
+    nextRead = now + (uint32_t)((uint64_t)MEMCMDS_POLL_SLEEP_US * ticksPerSecond() / 1000000);
   }
 
-  fio.printf("addr: 0x%08lx size: %u (0x%04x)\n", (intptr_t)obj, objSize, objSize);
+  if (spin(steps++ ? 1 : MEMCMDS_POLL_SPINS))
+  {
+    summary(shell.io(), "hit");
+    return false;
+  }
+
+  return true;
+}
+
+void PollJob::cancel(TinyShBase& shell)
+{
+  summary(shell.io(), "cancelled");
+}
+
+bool PollJob::progress(unsigned long& done, unsigned long& total)
+{
+  done = ticks() - startTicks;
+  total = timeout;
+  return true;
+}
+
+void PollJob::summary(ByteStream& out, const char *result)
+{
+  PrintfToStream fio(out);
+
+  fio.printf("poll: %s after %lu us, %lu reads, value 0x%0*llx\n", result,
+      (unsigned long)ticksToMicros(ticks() - startTicks), reads, (int)(2 * bytes), (unsigned long long)last);
 }
-#endif // DEBUG
 
 static
-void cmd_hexdump(TinySh& shell, int argc, const char **argv)
+void cmd_hexdump(TinyShBase& shell, int argc, const char **argv)
 {
   static unsigned dumplen = 64;
 
-  PrintfToStream fio(shell.io());
+  MemJob* job = MemJob::claim(shell);
+
+  if (!job)
+    return;
 
   if ((2 <= argc) && (3 >= argc))
   {
-    ptr = TinySh::atoxi(argv[1]);
+    ptr = TinyShBase::atoxi(argv[1]);
 
     if (3 == argc)
     {
-      dumplen = TinySh::atoxi(argv[2]);
+      dumplen = TinyShBase::atoxi(argv[2]);
     }
   }
 
-  unsigned char *buf = memCmdsBasePtr + ptr;
-  unsigned i, j;
-  for (i = 0; i < dumplen; i += 16)
-  {
-    fio.printf("%08lx: ", (intptr_t)(buf + i));
-    for (j = 0; j < 16; j++)
-      if (i + j < dumplen)
-        fio.printf("%02x ", buf[i + j]);
-      else
-        fio.printf("   ");
-    fio.printf(" ");
-    for (j = 0; j < 16; j++)
-      if (i + j < dumplen)
-        fio.printf("%c", isprint(buf[i+j]) ? buf[i + j] : '.');
-    fio.printf("\n");
-  }
-
-  ptr += dumplen;
+  job->src = ptr;
+  job->start(shell, MemJob::HEXDUMP, dumplen);
 }
 
 static
-void cmd_setBase(TinySh& shell, int argc, const char **argv)
+void cmd_setBase(TinyShBase& shell, int argc, const char **argv)
 {
   PrintfToStream fio(shell.io());
 
   if (2 == argc)
   {
-    memCmdsBasePtr = (unsigned char*)TinySh::atoxi(argv[1]);
+    memCmdsBasePtr = (unsigned char*)TinyShBase::atoxi(argv[1]);
   }
   fio.printf("base addr: 0x%08lx\n", (intptr_t)memCmdsBasePtr);
 }
 
 static
-void cmd_copy(TinySh& shell, int argc, const char **argv)
+void cmd_copy(TinyShBase& shell, int argc, const char **argv)
 {
   if (4 == argc)
   {
-    unsigned i;
-    unsigned len = TinySh::atoxi(argv[3]);
-    unsigned dest = TinySh::atoxi(argv[2]);
-    ptr = TinySh::atoxi(argv[1]);
+    MemJob* job = MemJob::claim(shell);
 
-    for (i = 0; i < len; ++i)
+    if (job)
     {
-      memCmdsBasePtr[dest + i] = memCmdsBasePtr[ptr + i];
+      unsigned len = TinyShBase::atoxi(argv[3]);
+      job->dest = TinyShBase::atoxi(argv[2]);
+      ptr = TinyShBase::atoxi(argv[1]);
+      job->src = ptr;
+      job->start(shell, MemJob::COPY, len);
     }
   }
 }
 
 static
-void cmd_comp(TinySh& shell, int argc, const char **argv)
+void cmd_comp(TinyShBase& shell, int argc, const char **argv)
 {
-  PrintfToStream fio(shell.io());
-
   if (4 == argc)
   {
-    unsigned i, differences;
-    intptr_t diff = (intptr_t)shell.get_arg();
-    unsigned len = TinySh::atoxi(argv[3]);
-    unsigned dest = TinySh::atoxi(argv[2]);
-    ptr = TinySh::atoxi(argv[1]);
+    MemJob* job = MemJob::claim(shell);
 
-    differences = 0;
-    for (i = 0; i < len; ++i)
+    if (job)
     {
-      if (memCmdsBasePtr[dest + i] != memCmdsBasePtr[ptr + i])
-      {
-        differences++;
-        if (diff)
-        {
-          unsigned char c1 = memCmdsBasePtr[ptr + i];
-          unsigned char c2 = memCmdsBasePtr[dest + i];
-          fio.printf("found difference 0x%08lx: %02x %c | 0x%08lx: %02x %c\n", (intptr_t)memCmdsBasePtr[ptr + i], c1, isprint(c1)?c1:'.', (intptr_t)&memCmdsBasePtr[dest + i], c2, isprint(c2)?c2:'.');
-        }
-      }
+      unsigned len = TinyShBase::atoxi(argv[3]);
+      job->diff = (0 != (intptr_t)shell.get_arg());
+      job->dest = TinyShBase::atoxi(argv[2]);
+      ptr = TinyShBase::atoxi(argv[1]);
+      job->src = ptr;
+      job->start(shell, MemJob::COMPARE, len);
     }
-    fio.printf("total %u differences\n", differences);
   }
 }
 
 static
-void cmd_readMem(TinySh& shell, int argc, const char **argv)
+void cmd_readMem(TinyShBase& shell, int argc, const char **argv)
 {
-  PrintfToStream fio(shell.io());
-
-  intptr_t opType = (intptr_t)shell.get_arg();
-//  unsigned long mask = ~(-1 << (numBytes * 8));
-  const char* format;
+  MemJob* job = MemJob::claim(shell);
   unsigned count = 1;
-  unsigned i;
-  unsigned long value;
-  intptr_t addr;
+
+  if (!job)
+    return;
 
   if (2 == argc)
   {
-    ptr = TinySh::atoxi(argv[1]);
+    ptr = TinyShBase::atoxi(argv[1]);
   }
   else if (3 == argc)
   {
-    ptr = TinySh::atoxi(argv[1]);
-    count = TinySh::atoxi(argv[2]);
+    ptr = TinyShBase::atoxi(argv[1]);
+    count = TinyShBase::atoxi(argv[2]);
   }
 
 //  // alignment
@@ -178,48 +1319,35 @@ void cmd_readMem(TinySh& shell, int argc, const char **argv)
 //    ptr &= alignMask;
 //  }
 
-  for (i = 0; i < count; ++i)
-  {
-    switch (opType)
-    {
-    default:
-    case 0:
-      format = "0x%08lx: 0x%02x\n";
-      value = memCmdsBasePtr[ptr + i];
-      addr = (intptr_t)(&memCmdsBasePtr[ptr + i]);
-      break;
-
-    case 1:
-      format = "0x%08lx: 0x%04x\n";
-      value = *((unsigned short*)(&memCmdsBasePtr[ptr]) + i);
-      addr = (intptr_t)((unsigned short*)(&memCmdsBasePtr[ptr]) + i);
-      break;
-
-    case 2:
-      format = "0x%08lx: 0x%08x\n";
-      value = *((unsigned long*)(&memCmdsBasePtr[ptr]) + i);
-      addr = (intptr_t)((unsigned long*)(&memCmdsBasePtr[ptr]) + i);
-      break;
-
-    }
+  job->opType = (intptr_t)shell.get_arg();
+  job->src = ptr;
+  job->start(shell, MemJob::READ, count);
+}
 
-    fio.printf(format, addr, value);
-  }
+/* the values of an operand of 1 << opType bytes, without shifting a 64 bit value by its width */
+static inline uint64_t width_mask(intptr_t opType)
+{
+  return (3 <= opType) ? ~(uint64_t)0 : ((uint64_t)1 << (8 << opType)) - 1;
 }
 
 static
-void cmd_writeMem(TinySh& shell, int argc, const char **argv)
+void cmd_writeMem(TinyShBase& shell, int argc, const char **argv)
 {
   if (2 < argc)
   {
     intptr_t opType = (intptr_t)shell.get_arg();
-    unsigned numBytes = 1 << opType;
-    unsigned long mask = ~(-1 << (numBytes * 8));
+    uint64_t mask = width_mask(opType);
     unsigned count;
     unsigned i;
-    unsigned long value;
+    uint64_t value;
 
-    ptr = TinySh::atoxi(argv[1]);
+    if ((NumberParser::VALID != NumberParser::parse(argv[1], value)) && !TinyShBase::resolveSymbol(argv[1], value))
+    {
+      PrintfToStream fio(shell.io());
+      fio.printf("mem: invalid address: %s\n", argv[1]);
+      return;
+    }
+    ptr = (unsigned)value;
     count = argc - 2;
     i = 0;
 
@@ -231,7 +1359,13 @@ void cmd_writeMem(TinySh& shell, int argc, const char **argv)
 
     while (0 < count)
     {
-      value = (unsigned long)TinySh::atoxi(argv[i + 2]);
+      if ((NumberParser::VALID != NumberParser::parse(argv[i + 2], value)) && !TinyShBase::resolveSymbol(argv[i + 2], value))
+      {
+        /* the values before are written */
+        PrintfToStream fio(shell.io());
+        fio.printf("mem: invalid value: %s\n", argv[i + 2]);
+        break;
+      }
       value &= mask;
       switch (opType)
       {
@@ -256,70 +1390,52 @@ void cmd_writeMem(TinySh& shell, int argc, const char **argv)
 }
 
 static
-void cmd_fillMem(TinySh& shell, int argc, const char **argv)
+void cmd_fillMem(TinyShBase& shell, int argc, const char **argv)
 {
   if ((2 < argc) && (4 >= argc))
   {
-    intptr_t opType = (intptr_t)shell.get_arg();
-    unsigned numBytes = 1 << opType;
-    unsigned long mask = ~(-1 << (numBytes * 8));
-    unsigned count = 1;
-    unsigned long value;
-    unsigned i;
-
-    ptr = TinySh::atoxi(argv[1]);
-    value = TinySh::atoxi(argv[2]);
-    value &= mask;
-    if (4 == argc)
-    {
-      count = TinySh::atoxi(argv[3]);
-    }
-
-//    // alignment
-//    {
-//      unsigned alignMask = (-1 << opType);
-//      ptr &= alignMask;
-//    }
+    MemJob* job = MemJob::claim(shell);
 
-    i = 0;
-    while (0 < count)
+    if (job)
     {
-      switch (opType)
+      intptr_t opType = (intptr_t)shell.get_arg();
+      uint64_t mask = width_mask(opType);
+      unsigned count = 1;
+
+      ptr = TinyShBase::atoxi(argv[1]);
+      job->value = TinyShBase::atoxi(argv[2]);
+      job->value &= mask;
+      if (4 == argc)
       {
-      case 0:
-        memCmdsBasePtr[ptr + i] = (unsigned char)value;
-        break;
-
-      case 1:
-        *((unsigned short*)&memCmdsBasePtr[ptr] + i) = (unsigned short)value;
-        break;
-
-      case 2:
-        *((unsigned long*)&memCmdsBasePtr[ptr] + i) = (unsigned long)value;
-        break;
-
+        count = TinyShBase::atoxi(argv[3]);
       }
 
-      i++;
-      count--;
+//      // alignment
+//      {
+//        unsigned alignMask = (-1 << opType);
+//        ptr &= alignMask;
+//      }
+
+      job->opType = opType;
+      job->src = ptr;
+      job->start(shell, MemJob::FILL, count);
     }
   }
 }
 
 static
-void cmd_memModify(TinySh& shell, int argc, const char **argv)
+void cmd_memModify(TinyShBase& shell, int argc, const char **argv)
 {
   if (4 == argc)
   {
     intptr_t opType = (intptr_t)shell.get_arg();
-    unsigned numBytes = 1 << opType;
-    unsigned long mask = ~(-1 << (numBytes * 8));
+    uint64_t mask = width_mask(opType);
     unsigned long value;
     unsigned long operand = 0;
     char c;
 
-    ptr = TinySh::atoxi(argv[1]);
-    value = TinySh::atoxi(argv[3]);
+    ptr = TinyShBase::atoxi(argv[1]);
+    value = TinyShBase::atoxi(argv[3]);
     value &= mask;
 
 //    // alignment
@@ -415,24 +1531,258 @@ void cmd_memModify(TinySh& shell, int argc, const char **argv)
   }
 }
 
+static
+void cmd_load(TinyShBase& shell, int argc, const char **argv)
+{
+  PrintfToStream fio(shell.io());
+  LoadJob::Format format;
+  uint64_t offset = 0;
+
+  if ((2 > argc) || (3 < argc))
+    return;
+
+  if (0 == strcmp(argv[1], "ihex"))
+    format = LoadJob::IHEX;
+  else if (0 == strcmp(argv[1], "srec"))
+    format = LoadJob::SREC;
+  else if (0 == strcmp(argv[1], "raw"))
+    format = LoadJob::RAW;
+  else
+  {
+    fio.printf("mem: unknown format: %s\n", argv[1]);
+    return;
+  }
+
+  if ((3 == argc) && ((NumberParser::VALID != NumberParser::parse(argv[2], offset)) || (offset > (unsigned)-1)))
+  {
+    fio.printf("mem: invalid offset: %s\n", argv[2]);
+    return;
+  }
+
+  if ((LoadJob::RAW == format) && !ticksPerSecond())
+  {
+    /* a raw block takes CTRL-C as data, only the timeout ends it */
+    shell.io().writeBlock("mem: raw needs a tick source\n");
+    return;
+  }
+
+  if (loadJob.isRunning())
+  {
+    shell.io().writeBlock("mem: busy\n");
+    return;
+  }
+
+  loadJob.start(shell, format, (unsigned)offset);
+}
+
+static
+void cmd_get(TinyShBase& shell, int argc, const char **argv)
+{
+  bool raw = false;
+
+  if ((3 > argc) || (4 < argc))
+    return;
+
+  if (4 == argc)
+  {
+    raw = (0 == strcmp(argv[3], "raw"));
+    if (!raw && strcmp(argv[3], "base64"))
+    {
+      PrintfToStream fio(shell.io());
+      fio.printf("mem: unknown format: %s\n", argv[3]);
+      return;
+    }
+  }
+
+  if (getJob.isRunning())
+  {
+    shell.io().writeBlock("mem: busy\n");
+    return;
+  }
+
+  ptr = TinyShBase::atoxi(argv[1]);
+  getJob.start(shell, ptr, TinyShBase::atoxi(argv[2]), raw);
+}
+
+static
+void cmd_snap(TinyShBase& shell, int argc, const char **argv)
+{
+  PrintfToStream fio(shell.io());
+  Snapshot *s;
+  unsigned addr, len, used, i;
+
+  if ((3 == argc) || (4 < argc))
+    return;
+
+  if (deltaJob.isRunning())
+  {
+    shell.io().writeBlock("mem: busy\n");
+    return;
+  }
+
+  if (1 == argc)
+  {
+    for (i = 0, used = 0; i < snapCount; i++)
+    {
+      s = &snapshots[i];
+      fio.printf("%-11s 0x%08lx %u bytes\n", s->name, (intptr_t)(memCmdsBasePtr + s->addr), s->len);
+      used += snap_size(s->len);
+    }
+    fio.printf("%u of %u arena bytes used\n", used, snapArenaSize);
+    return;
+  }
+
+  s = snap_find(argv[1]);
+  if (2 == argc)
+  {
+    if (s)
+      snap_drop(s);
+    else
+      fio.printf("mem: unknown snapshot: %s\n", argv[1]);
+    return;
+  }
+
+  if (strlen(argv[1]) >= sizeof(s->name))
+  {
+    fio.printf("mem: name too long: %s\n", argv[1]);
+    return;
+  }
+
+  /* a snapshot of the same name is replaced, its room counts as free */
+  addr = TinyShBase::atoxi(argv[2]);
+  len = TinyShBase::atoxi(argv[3]);
+  used = snapCount ? snapshots[snapCount - 1].offset + snap_size(snapshots[snapCount - 1].len) : 0;
+  if (s)
+    used -= snap_size(s->len);
+  if ((!s && (MEMCMDS_SNAP_COUNT == snapCount)) || !len || (snap_size(len) < len) || (snap_size(len) > snapArenaSize - used))
+  {
+    fio.printf("mem: no room for %u bytes, %u of %u arena bytes used\n", len, used, snapArenaSize);
+    return;
+  }
+  if (s)
+    snap_drop(s);
+
+  s = &snapshots[snapCount++];
+  strcpy(s->name, argv[1]);
+  s->addr = addr;
+  s->len = len;
+  s->offset = used;
+  memcpy(snap_copy(*s), memCmdsBasePtr + addr, len);
+  for (i = 0; i < snap_blocks(len); i++)
+  {
+    unsigned start = i * MEMCMDS_SNAP_BLOCK;
+    snap_hashes(*s)[i] = snap_hash(snap_copy(*s) + start, (len - start > MEMCMDS_SNAP_BLOCK) ? MEMCMDS_SNAP_BLOCK : len - start);
+  }
+}
+
+static
+void cmd_delta(TinyShBase& shell, int argc, const char **argv)
+{
+  Snapshot *s;
+  bool roll = false;
+
+  if ((2 > argc) || (3 < argc))
+    return;
+
+  if (3 == argc)
+  {
+    roll = (0 == strcmp(argv[2], "roll"));
+    if (!roll)
+    {
+      PrintfToStream fio(shell.io());
+      fio.printf("mem: unknown option: %s\n", argv[2]);
+      return;
+    }
+  }
+
+  s = snap_find(argv[1]);
+  if (!s)
+  {
+    PrintfToStream fio(shell.io());
+    fio.printf("mem: unknown snapshot: %s\n", argv[1]);
+    return;
+  }
+
+  if (deltaJob.isRunning())
+  {
+    shell.io().writeBlock("mem: busy\n");
+    return;
+  }
+
+  deltaJob.start(shell, *s, roll);
+}
+
+static
+void cmd_poll(TinyShBase& shell, int argc, const char **argv)
+{
+  PrintfToStream fio(shell.io());
+  intptr_t opType = (intptr_t)shell.get_arg();
+  uint64_t width = width_mask(opType);
+  uint64_t addr, mask, value, timeout = 0;
+  int i;
+
+  if ((4 > argc) || (5 < argc))
+    return;
+
+  if ((NumberParser::VALID != NumberParser::parse(argv[1], addr)) && !TinyShBase::resolveSymbol(argv[1], addr))
+  {
+    fio.printf("mem: invalid address: %s\n", argv[1]);
+    return;
+  }
+  for (i = 2; i < 4; i++)
+  {
+    if ((NumberParser::VALID != NumberParser::parse(argv[i], (2 == i) ? mask : value))
+        && !TinyShBase::resolveSymbol(argv[i], (2 == i) ? mask : value))
+    {
+      fio.printf("mem: invalid value: %s\n", argv[i]);
+      return;
+    }
+  }
+  if ((5 == argc) && ((NumberParser::VALID != NumberParser::parse(argv[4], timeout)) || (timeout > 0xFFFFFFFFu)))
+  {
+    fio.printf("mem: invalid timeout: %s\n", argv[4]);
+    return;
+  }
+  if (timeout && !ticksPerSecond())
+  {
+    /* without a tick source the time does not pass, the poll would not end */
+    shell.io().writeBlock("mem: a timeout needs a tick source\n");
+    return;
+  }
+
+  if (pollJob.isRunning())
+  {
+    shell.io().writeBlock("mem: busy\n");
+    return;
+  }
+
+  ptr = (unsigned)addr;
+  pollJob.start(shell, 1 << opType, ptr, mask & width, value & width, (uint32_t)timeout);
+}
+
 #ifdef DEBUG
 static const CommandDescription testCmd = { "testArea", "map a test memory area, set base address and return address and size", 0, &cmd_mapTest, 0, 0, 0 };
 #endif
-static const CommandDescription mod32Cmd = { "mod", "modify long", "addr <C assignment op> value", &cmd_memModify, (void *)2, 0 , 0 };
+static const CommandDescription poll32Cmd = { "poll", "wait for (long & mask) == value (timeout in ms)", "addr mask value [timeout]", &cmd_poll, (void *)2, 0, 0 };
+static const CommandDescription mod32Cmd = { "mod", "modify long", "addr <C assignment op> value", &cmd_memModify, (void *)2, (CommandDescription*)&poll32Cmd, 0 };
 static const CommandDescription fill32Cmd = { "fill", "write long(s)", "addr value [count:1]", &cmd_fillMem, (void *)2, (CommandDescription*)&mod32Cmd, 0 };
 static const CommandDescription wr32Cmd = { "write", "write long(s)", "addr value [value [...]]", &cmd_writeMem, (void *)2, (CommandDescription*)&fill32Cmd, 0 };
 static const CommandDescription rd32Cmd = { "read", "read long(s)", "[addr [count:1]]", &cmd_readMem, (void *)2, (CommandDescription*)&wr32Cmd, 0 };
+static const CommandDescription poll64Cmd = { "poll", "wait for (quad & mask) == value (timeout in ms)", "addr mask value [timeout]", &cmd_poll, (void *)3, 0, 0 };
 #ifdef DEBUG
-static const CommandDescription dwordCmd = { "long", "work on int32", 0, 0, 0, (CommandDescription*)&testCmd, (CommandDescription*)&rd32Cmd };
+static const CommandDescription qwordCmd = { "quad", "work on int64", 0, 0, 0, (CommandDescription*)&testCmd, (CommandDescription*)&poll64Cmd };
 #else
-static const CommandDescription dwordCmd = { "long", "work on int32", 0, 0, 0, 0, (CommandDescription*)&rd32Cmd };
+static const CommandDescription qwordCmd = { "quad", "work on int64", 0, 0, 0, 0, (CommandDescription*)&poll64Cmd };
 #endif
-static const CommandDescription mod16Cmd = { "mod", "modify short", "addr <C assignment op> value", &cmd_memModify, (void *)1, 0 , 0 };
+static const CommandDescription dwordCmd = { "long", "work on int32", 0, 0, 0, (CommandDescription*)&qwordCmd, (CommandDescription*)&rd32Cmd };
+static const CommandDescription poll16Cmd = { "poll", "wait for (short & mask) == value (timeout in ms)", "addr mask value [timeout]", &cmd_poll, (void *)1, 0, 0 };
+static const CommandDescription mod16Cmd = { "mod", "modify short", "addr <C assignment op> value", &cmd_memModify, (void *)1, (CommandDescription*)&poll16Cmd, 0 };
 static const CommandDescription fill16Cmd = { "fill", "write short(s)", "addr value [count:1]", &cmd_fillMem, (void *)1, (CommandDescription*)&mod16Cmd, 0 };
 static const CommandDescription wr16Cmd = { "write", "write short(s)", "addr value [value [...]]", &cmd_writeMem, (void *)1, (CommandDescription*)&fill16Cmd, 0 };
 static const CommandDescription rd16Cmd = { "read", "read short(s)", "[addr [count:1]]", &cmd_readMem, (void *)1, (CommandDescription*)&wr16Cmd, 0 };
 static const CommandDescription wordCmd = { "short", "work on int16", 0, 0, 0, (CommandDescription*)&dwordCmd, (CommandDescription*)&rd16Cmd };
-static const CommandDescription mod8Cmd = { "mod", "modify byte", "addr <C assignment op> value", &cmd_memModify, (void *)0, 0 , 0 };
+static const CommandDescription poll8Cmd = { "poll", "wait for (byte & mask) == value (timeout in ms)", "addr mask value [timeout]", &cmd_poll, (void *)0, 0, 0 };
+static const CommandDescription mod8Cmd = { "mod", "modify byte", "addr <C assignment op> value", &cmd_memModify, (void *)0, (CommandDescription*)&poll8Cmd, 0 };
 static const CommandDescription fill8Cmd = { "fill", "write byte(s)", "addr value [count:1]", &cmd_fillMem, (void *)0, (CommandDescription*)&mod8Cmd, 0 };
 static const CommandDescription wr8Cmd = { "write", "write byte(s)", "addr value [value [...]]", &cmd_writeMem, (void *)0, (CommandDescription*)&fill8Cmd, 0 };
 static const CommandDescription rd8Cmd = { "read", "read byte(s)", "[addr [count:1]]", &cmd_readMem, (void *)0, (CommandDescription*)&wr8Cmd, 0 };
@@ -440,7 +1790,11 @@ static const CommandDescription byteCmd = { "byte", "work on bytes", 0, 0, 0, (C
 static const CommandDescription diffCmd = { "diff", "display memory differences", "addr1 addr2 count", &cmd_comp, (void *)1, (CommandDescription*)&byteCmd, 0 };
 static const CommandDescription compCmd = { "cmp", "compare memory bytes", "addr1 addr2 count", &cmd_comp, 0, (CommandDescription*)&diffCmd, 0 };
 static const CommandDescription copyCmd = { "cp", "copy memory bytes", "src dest count", cmd_copy, 0, (CommandDescription*)&compCmd, 0 };
-static const CommandDescription dumpCmd = { "hexdump", "dump memory bytes in hex (with base addr)", "[addr [num:64]]", &cmd_hexdump, 0, (CommandDescription*)&copyCmd, 0 };
+static const CommandDescription deltaCmd = { "delta", "display the ranges changed since a snapshot (and take them into it)", "name [roll]", &cmd_delta, 0, (CommandDescription*)&copyCmd, 0 };
+static const CommandDescription snapCmd = { "snap", "take, drop or list snapshots of memory ranges", "[name [addr len]]", &cmd_snap, 0, (CommandDescription*)&deltaCmd, 0 };
+static const CommandDescription getCmd = { "get", "send memory bytes in base64 or a raw frame, with CRC-32", "addr count [base64|raw]", &cmd_get, 0, (CommandDescription*)&snapCmd, 0 };
+static const CommandDescription loadCmd = { "load", "receive an image in Intel HEX, S-record or raw format (with offset)", "ihex|srec|raw [offset:0]", &cmd_load, 0, (CommandDescription*)&getCmd, 0 };
+static const CommandDescription dumpCmd = { "hexdump", "dump memory bytes in hex (with base addr)", "[addr [num:64]]", &cmd_hexdump, 0, (CommandDescription*)&loadCmd, 0 };
 const CommandDescription memCommands = { "base", "set or display base address for memory operations", "[addr]", &cmd_setBase, 0, (CommandDescription*)&dumpCmd, 0 };
 CommandDescription memCmdGroup = { "mem", "manipulate memory relative to a base address", "sub_cmd", 0, 0, 0, (CommandDescription*)&memCommands };
 }
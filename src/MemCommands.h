@@ -14,6 +14,10 @@ namespace Shell
 extern const CommandDescription memCommands;
 extern CommandDescription memCmdGroup;
 
+/* use size bytes at mem (4 byte aligned) for the snapshots of mem snap instead of the
+ * built in MEMCMDS_SNAP_ARENA_SIZE bytes, the snapshots taken so far are dropped */
+void memSnapArena(void *mem, unsigned size);
+
 } // namespace Shell
 
 #endif /* MEMCOMMANDS_H_ */
@@ -0,0 +1,49 @@
+/*
+ * SessionPool.cpp
+ *
+ */
+
+#include "SessionPool.h"
+
+#include <assert.h>
+
+namespace Shell
+{
+
+SessionPool::SessionPool(void *blocks_, unsigned count_, unsigned size_)
+: blocks((char*)blocks_), freeList(0), count(count_), size(size_), fresh(0), used(0)
+{
+}
+
+void* SessionPool::take()
+{
+  void *block;
+
+  if (freeList)
+  {
+    block = freeList;
+    freeList = *(void**)block;
+  }
+  else if (fresh < count)
+  {
+    block = &blocks[fresh++ * size];
+  }
+  else
+  {
+    return 0;
+  }
+  used++;
+
+  return block;
+}
+
+void SessionPool::give(void *block)
+{
+  assert(((char*)block >= blocks) && ((char*)block < &blocks[fresh * size])); // der Block stammt nicht aus diesem Pool
+
+  *(void**)block = freeList;
+  freeList = block;
+  used--;
+}
+
+} // namespace Shell
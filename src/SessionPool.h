@@ -0,0 +1,105 @@
+/*
+ * SessionPool.h
+ *
+ */
+
+#ifndef SESSIONPOOL_H_
+#define SESSIONPOOL_H_
+
+namespace Shell
+{
+  /**
+   * Fixed size blocks for the state of the active sessions, so thousands of
+   * shells only need the memory of the ones, that have input at a time. The
+   * blocks are handed out in order of their address at first, returned blocks
+   * are kept in a free list, that is linked through the blocks themselves.
+   */
+  class SessionPool
+  {
+  public:
+    SessionPool(void *blocks, unsigned count, unsigned size);
+
+    /* a block of blockSize() bytes, 0 if all are in use */
+    void* take();
+
+    /* return a block taken from this pool */
+    void give(void *block);
+
+    unsigned blockSize() const;
+    unsigned blockCount() const;
+    unsigned blocksInUse() const;
+
+  private:
+    char * const blocks;
+    void *freeList;
+    const unsigned count;
+    const unsigned size;
+    unsigned fresh; /* blocks handed out at least once */
+    unsigned used;
+  };
+
+  /* a pool with static storage for COUNT blocks of SIZE bytes */
+  template<unsigned COUNT, unsigned SIZE>
+  class StaticSessionPool: public SessionPool
+  {
+  public:
+    StaticSessionPool()
+    : SessionPool(storage, COUNT, sizeof(storage[0]))
+    {
+    }
+
+  private:
+    union Block
+    {
+      void *link; /* aligns the block for the free list and the session state */
+      char data[SIZE];
+    };
+
+    Block storage[COUNT];
+  };
+
+  /* the one pool for COUNT blocks of SIZE bytes, no pool for COUNT == 0 */
+  template<unsigned COUNT, unsigned SIZE>
+  struct SessionPoolFor
+  {
+    static StaticSessionPool<COUNT, SIZE> pool;
+
+    static constexpr SessionPool* get()
+    {
+      return &pool;
+    }
+  };
+
+  template<unsigned COUNT, unsigned SIZE>
+  StaticSessionPool<COUNT, SIZE> SessionPoolFor<COUNT, SIZE>::pool;
+
+  template<unsigned SIZE>
+  struct SessionPoolFor<0, SIZE>
+  {
+    static constexpr SessionPool* get()
+    {
+      return 0;
+    }
+  };
+
+  inline
+  unsigned SessionPool::blockSize() const
+  {
+    return size;
+  }
+
+  inline
+  unsigned SessionPool::blockCount() const
+  {
+    return count;
+  }
+
+  inline
+  unsigned SessionPool::blocksInUse() const
+  {
+    return used;
+  }
+
+} // namespace Shell
+
+#endif /* SESSIONPOOL_H_ */
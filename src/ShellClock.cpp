@@ -0,0 +1,38 @@
+/*
+ * ShellClock.cpp
+ *
+ */
+
+#include "ShellClock.h"
+
+namespace Shell
+{
+
+static TickFunction_t tickSource = 0;
+static uint32_t tickRate = 0;
+
+void setTickSource(TickFunction_t tickFunction, uint32_t ticksPerSecond)
+{
+  tickSource = tickFunction;
+  tickRate = tickFunction ? ticksPerSecond : 0;
+}
+
+uint32_t ticks()
+{
+  return tickSource ? tickSource() : 0;
+}
+
+uint32_t ticksPerSecond()
+{
+  return tickRate;
+}
+
+uint64_t ticksToMicros(uint32_t t)
+{
+  if (!tickRate)
+    return 0;
+
+  return ((uint64_t)t * 1000000u) / tickRate;
+}
+
+} // namespace Shell
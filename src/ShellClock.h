@@ -0,0 +1,30 @@
+/*
+ * ShellClock.h
+ *
+ */
+
+#ifndef SHELLCLOCK_H_
+#define SHELLCLOCK_H_
+
+#include <stdint.h>
+
+namespace Shell
+{
+  /* free running tick counter of the application, allowed to wrap around */
+  typedef uint32_t (*TickFunction_t)(void);
+
+  /* install the time base for all time measurements of the shell */
+  void setTickSource(TickFunction_t tickFunction, uint32_t ticksPerSecond);
+
+  /* current tick count, 0 if no tick source is installed */
+  uint32_t ticks();
+
+  /* resolution of the tick source, 0 if no tick source is installed */
+  uint32_t ticksPerSecond();
+
+  /* convert a tick difference to microseconds */
+  uint64_t ticksToMicros(uint32_t ticks);
+
+} // namespace Shell
+
+#endif /* SHELLCLOCK_H_ */
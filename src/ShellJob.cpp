@@ -0,0 +1,119 @@
+/*
+ * ShellJob.cpp
+ *
+ */
+
+#include "ShellJob.h"
+#include "TinySh.h"
+
+#include <assert.h>
+#include <string.h>
+
+namespace Shell
+{
+
+Job::Job()
+: runningOn(0)
+{}
+
+Job::~Job()
+{}
+
+void Job::cancel(TinyShBase&)
+{}
+
+bool Job::progress(unsigned long&, unsigned long&)
+{
+  return false;
+}
+
+bool Job::input(TinyShBase&, char)
+{
+  return false;
+}
+
+bool Job::rawInput() const
+{
+  return false;
+}
+
+OutputJob::OutputJob()
+: more(true)
+{
+  chunk.len = 0;
+  chunk.pos = 0;
+  chunk.overflow = false;
+}
+
+unsigned OutputJob::Chunk::write(unsigned char b)
+{
+  if (len < sizeof(data))
+  {
+    data[len++] = b;
+    return 1;
+  }
+  overflow = true;
+  return 0;
+}
+
+unsigned OutputJob::Chunk::writeBlock(const unsigned char *b, unsigned numBytes)
+{
+  if (numBytes > sizeof(data) - len)
+  {
+    numBytes = sizeof(data) - len;
+    overflow = true;
+  }
+  memcpy(&data[len], b, numBytes);
+  len += numBytes;
+  return numBytes;
+}
+
+/* write out as much of the pending chunk as the stream takes, return true, if all is gone
+ */
+bool OutputJob::drain(ByteStream& io)
+{
+  if (chunk.pos < chunk.len)
+    chunk.pos += io.writeBlock(&chunk.data[chunk.pos], chunk.len - chunk.pos);
+
+  return chunk.pos >= chunk.len;
+}
+
+bool OutputJob::step(TinyShBase& shell)
+{
+  unsigned n;
+
+  for (n = 0; n < TINYSH_OUTPUT_CHUNKS_PER_STEP; n++)
+  {
+    if (!drain(shell.io()))
+      return true; /* stream is full, try again later */
+
+    if (!more)
+    {
+      more = true; /* ready for the next run */
+      return false;
+    }
+
+    chunk.len = 0;
+    chunk.pos = 0;
+    more = generate(shell, chunk);
+
+    assert(!chunk.overflow); // ein generate()-Aufruf darf höchstens TINYSH_OUTPUT_CHUNK_SIZE Bytes ausgeben
+    if (chunk.overflow)
+    {
+      /* make the loss visible */
+      memcpy(&chunk.data[sizeof(chunk.data) - 4], "...\n", 4);
+      chunk.overflow = false;
+    }
+  }
+
+  return true;
+}
+
+void OutputJob::cancel(TinyShBase&)
+{
+  chunk.len = 0;
+  chunk.pos = 0;
+  more = true;
+}
+
+} // namespace Shell
@@ -0,0 +1,116 @@
+/*
+ * ShellJob.h
+ *
+ */
+
+#ifndef SHELLJOB_H_
+#define SHELLJOB_H_
+
+#include "ByteStream.h"
+
+#ifndef TINYSH_OUTPUT_CHUNK_SIZE
+#define TINYSH_OUTPUT_CHUNK_SIZE 128
+#endif
+
+#ifndef TINYSH_OUTPUT_CHUNKS_PER_STEP
+#define TINYSH_OUTPUT_CHUNKS_PER_STEP 4
+#endif
+
+namespace Shell
+{
+  class TinyShBase;
+
+  /**
+   * A Job is a resumable command: instead of doing all its work inside the
+   * CommandFunction_t, a command function hands a Job to TinyShBase::startJob()
+   * and returns. The shell then calls step() from checkInput() until step()
+   * reports that no more work is pending.
+   *
+   * Each step() call shall do a bounded amount of work (a time slice), so the
+   * shell keeps servicing its input in between. While a job is active, the
+   * input line is not processed; CTRL-C cancels the job and CTRL-T asks for
+   * progress. Other input is offered to input() and kept as type-ahead for the
+   * next input line, if the job does not take it. A job receiving binary data
+   * takes all input with rawInput(), then CTRL-C and CTRL-T are just bytes.
+   */
+  class Job
+  {
+  public:
+    Job();
+    virtual ~Job();
+
+    /* true, while the job is started on a shell, so a shared job object can detect the use by an other shell */
+    bool isRunning() const;
+
+    /* do the next slice of work, return true, if there is more to do */
+    virtual bool step(TinyShBase& shell) = 0;
+
+    /* the job has been cancelled by the user, default does nothing */
+    virtual void cancel(TinyShBase& shell);
+
+    /* report progress in arbitrary units, return false, if not supported */
+    virtual bool progress(unsigned long& done, unsigned long& total);
+
+    /* input character while the job is running, return true, if taken, default takes nothing */
+    virtual bool input(TinyShBase& shell, char c);
+
+    /* true, while every input byte goes to input(), also CTRL-C and CTRL-T, default false */
+    virtual bool rawInput() const;
+
+  private:
+    friend class TinyShBase;
+    TinyShBase* runningOn;
+  };
+
+  inline
+  bool Job::isRunning() const
+  {
+    return 0 != runningOn;
+  }
+
+  /**
+   * An OutputJob is a Job, that produces its output as a generator: the shell
+   * pulls the next chunk of output by calling generate() only, when the
+   * previous chunk has been taken completely by the IO stream. So the
+   * formatting is done at the rate the link drains, and nothing gets lost,
+   * when the stream write returns 0 because its buffer is full.
+   *
+   * A single generate() call must not produce more than TINYSH_OUTPUT_CHUNK_SIZE
+   * bytes, a longer output is continued in the next call (e.g. a line in two
+   * parts). More is a programming error: it asserts, without assertions the
+   * chunk ends with "...\n" to show the loss.
+   */
+  class OutputJob: public Job
+  {
+  public:
+    OutputJob();
+
+    virtual bool step(TinyShBase& shell);
+    virtual void cancel(TinyShBase& shell);
+
+  protected:
+    /* produce the next chunk of output into out, return true, if more is to follow */
+    virtual bool generate(TinyShBase& shell, ByteStream& out) = 0;
+
+  private:
+    class Chunk: public ByteStream
+    {
+    public:
+      virtual unsigned write(unsigned char b);
+      virtual unsigned writeBlock(const unsigned char *b, unsigned numBytes);
+
+      unsigned char data[TINYSH_OUTPUT_CHUNK_SIZE];
+      unsigned len;
+      unsigned pos;
+      bool overflow; /* generate() wrote more than fits */
+    };
+
+    bool drain(ByteStream& io);
+
+    Chunk chunk;
+    bool more;
+  };
+
+} // namespace Shell
+
+#endif /* SHELLJOB_H_ */
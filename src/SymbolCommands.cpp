@@ -0,0 +1,133 @@
+/*
+ * SymbolCommands.cpp
+ *
+ */
+
+#include "SymbolCommands.h"
+#include "ShellJob.h"
+
+#include "Util/PrintfToStream.h"
+
+#include <string.h>
+
+namespace Shell
+{
+
+#ifndef TINYSH_SYMBOL_WIDTH
+#define TINYSH_SYMBOL_WIDTH 32 /* characters of a symbol name in annotations, so an annotated line fits in a chunk */
+#endif
+
+/* the longest annotated line, a mem delta range, has up to 80 characters besides the name (64 bit addresses) */
+static_assert(TINYSH_SYMBOL_WIDTH + 80 <= TINYSH_OUTPUT_CHUNK_SIZE, "TINYSH_SYMBOL_WIDTH too large for TINYSH_OUTPUT_CHUNK_SIZE");
+
+static SymbolTable* installed = 0;
+static bool annotate = true;
+
+static bool resolve(const char *name, unsigned len, uint64_t& value)
+{
+  const SymbolTable::Entry *e = installed->find(name, len);
+
+  if (!e)
+    return false;
+  value = e->addr;
+  return true;
+}
+
+void setSymbolTable(SymbolTable* table)
+{
+  installed = table;
+  TinyShBase::setSymbolResolver(table ? &resolve : 0);
+}
+
+SymbolTable* symbolTable()
+{
+  return installed;
+}
+
+void annotateAddress(ByteStream& out, uintptr_t addr)
+{
+  const SymbolTable::Entry *e;
+
+  if (!installed || !annotate || (0 == (e = installed->lookup(addr))))
+    return;
+
+  PrintfToStream fio(out);
+  if (addr == e->addr)
+    fio.printf(" <%.*s>", TINYSH_SYMBOL_WIDTH, installed->name(*e));
+  else
+    fio.printf(" <%.*s+0x%lx>", TINYSH_SYMBOL_WIDTH, installed->name(*e), (unsigned long)(addr - e->addr));
+}
+
+static
+void cmd_symAddr(TinyShBase& shell, int argc, const char **argv)
+{
+  PrintfToStream fio(shell.io());
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    uint64_t value;
+
+    if (TinyShBase::resolveSymbol(argv[i], value))
+      fio.printf("%s: 0x%08llx\n", argv[i], (unsigned long long)value);
+    else
+      fio.printf("sym: unknown symbol: %s\n", argv[i]);
+  }
+}
+
+static
+void cmd_symAnnotate(TinyShBase& shell, int argc, const char **argv)
+{
+  PrintfToStream fio(shell.io());
+
+  if (2 == argc)
+    annotate = (0 == strcmp(argv[1], "on"));
+  fio.printf("annotation %s\n", annotate ? "on" : "off");
+}
+
+static
+void cmd_symInfo(TinyShBase& shell, int, const char **)
+{
+  PrintfToStream fio(shell.io());
+
+  if (!installed)
+  {
+    fio.printf("no symbol table\n");
+    return;
+  }
+  const SymbolTable::Data& t = installed->table();
+  fio.printf("%lu symbols, %lu bytes of names, %lu index slots\n", (unsigned long)t.count,
+      (unsigned long)t.namesSize, t.slots ? (unsigned long)t.slotMask + 1 : 0ul);
+}
+
+#if TINYSH_SYMBOL_LOADER
+static
+void cmd_symLoad(TinyShBase& shell, int argc, const char **argv)
+{
+  static SymbolTable loaded;
+  PrintfToStream fio(shell.io());
+
+  if (2 != argc)
+    return;
+
+  if (installed == &loaded)
+    setSymbolTable(0);
+  if (!loaded.load(argv[1]))
+  {
+    fio.printf("sym: no symbols in %s\n", argv[1]);
+    return;
+  }
+  setSymbolTable(&loaded);
+  fio.printf("%lu symbols\n", (unsigned long)loaded.table().count);
+}
+
+static const CommandDescription symLoadCmd = { "load", "load the symbols of an ELF, nm or GNU ld map file", "file", &cmd_symLoad, 0, 0, 0 };
+static const CommandDescription symInfoCmd = { "info", "display the size of the symbol table", 0, &cmd_symInfo, 0, (CommandDescription*)&symLoadCmd, 0 };
+#else
+static const CommandDescription symInfoCmd = { "info", "display the size of the symbol table", 0, &cmd_symInfo, 0, 0, 0 };
+#endif
+static const CommandDescription symAnnotateCmd = { "annotate", "switch the symbols after the addresses of hexdump and read", "[on|off]", &cmd_symAnnotate, 0, (CommandDescription*)&symInfoCmd, 0 };
+static const CommandDescription symAddrCmd = { "addr", "display the address of symbols", "symbol[+offset] [...]", &cmd_symAddr, 0, (CommandDescription*)&symAnnotateCmd, 0 };
+CommandDescription symCmdGroup = { "sym", "symbol table for symbolic addresses", "sub_cmd", 0, 0, 0, (CommandDescription*)&symAddrCmd };
+
+} // namespace Shell
@@ -0,0 +1,29 @@
+/*
+ * SymbolCommands.h
+ *
+ */
+
+#ifndef SYMBOLCOMMANDS_H_
+#define SYMBOLCOMMANDS_H_
+
+#include "TinySh.h"
+#include "SymbolTable.h"
+
+namespace Shell
+{
+  /* install the table for symbol[+|-offset] arguments (TinyShBase::atoxi) and the sym commands, 0 to remove */
+  void setSymbolTable(SymbolTable* table);
+
+  /* the installed table, 0 if none */
+  SymbolTable* symbolTable();
+
+  /* write " <symbol>" or " <symbol+0x1c>" for an address printed by the mem commands, if it is in a symbol and
+   * the annotation is on ("sym annotate") */
+  void annotateAddress(ByteStream& out, uintptr_t addr);
+
+  /* "sym": addr, annotate, info and load (with TINYSH_SYMBOL_LOADER) */
+  extern CommandDescription symCmdGroup;
+
+} // namespace Shell
+
+#endif /* SYMBOLCOMMANDS_H_ */
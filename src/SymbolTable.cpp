@@ -0,0 +1,488 @@
+/*
+ * SymbolTable.cpp
+ *
+ */
+
+#include "SymbolTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if TINYSH_SYMBOL_LOADER
+#include <stdio.h>
+#include <elf.h>
+#endif
+
+namespace Shell
+{
+
+SymbolTable::SymbolTable()
+: hit(0), hitEnd(0), entries(0), capacity(0), names(0), namesCapacity(0), internSlots(0), internMask(0),
+  internCount(0), slots(0)
+{
+  memset(&data, 0, sizeof(data));
+}
+
+SymbolTable::~SymbolTable()
+{
+  clear();
+}
+
+void SymbolTable::use(const Data& table)
+{
+  clear();
+  data = table;
+}
+
+void SymbolTable::clear()
+{
+  free(entries);
+  free(names);
+  free(internSlots);
+  free(slots);
+  entries = 0;
+  capacity = 0;
+  names = 0;
+  namesCapacity = 0;
+  internSlots = 0;
+  internMask = 0;
+  internCount = 0;
+  slots = 0;
+  hit = 0;
+  memset(&data, 0, sizeof(data));
+}
+
+uint32_t SymbolTable::hash(const char *name, unsigned len)
+{
+  uint32_t h = 2166136261u;
+
+  while (len--)
+    h = (h ^ (unsigned char)*name++) * 16777619u;
+
+  return h;
+}
+
+/* the offset of the name in the pool, appended, if it is new
+ */
+bool SymbolTable::intern(const char *name, unsigned len, uint32_t& offset)
+{
+  uint32_t i;
+
+  if ((2 * (internCount + 1) > internMask) && !growIntern())
+    return false;
+
+  for (i = hash(name, len) & internMask; internSlots[i]; i = (i + 1) & internMask)
+  {
+    const char *n = names + internSlots[i] - 1;
+
+    if ((0 == strncmp(n, name, len)) && !n[len])
+    {
+      offset = internSlots[i] - 1;
+      return true;
+    }
+  }
+
+  if (data.namesSize + len + 1 > namesCapacity)
+  {
+    uint32_t c = namesCapacity ? 2 * namesCapacity : 4096;
+    char *p;
+
+    while (c < data.namesSize + len + 1)
+      c *= 2;
+    p = (char*)realloc(names, c);
+    if (!p)
+      return false;
+    names = p;
+    namesCapacity = c;
+  }
+
+  offset = data.namesSize;
+  memcpy(names + offset, name, len);
+  names[offset + len] = 0;
+  data.namesSize += len + 1;
+  internSlots[i] = offset + 1;
+  internCount++;
+
+  return true;
+}
+
+bool SymbolTable::growIntern()
+{
+  uint32_t size = internMask ? 2 * (internMask + 1) : 1024;
+  uint32_t *p = (uint32_t*)calloc(size, sizeof(uint32_t));
+  uint32_t i, j;
+
+  if (!p)
+    return false;
+
+  for (i = 0; internMask && (i <= internMask); i++)
+  {
+    if (internSlots[i])
+    {
+      const char *n = names + internSlots[i] - 1;
+
+      for (j = hash(n, strlen(n)) & (size - 1); p[j]; j = (j + 1) & (size - 1))
+        ;
+      p[j] = internSlots[i];
+    }
+  }
+  free(internSlots);
+  internSlots = p;
+  internMask = size - 1;
+
+  return true;
+}
+
+bool SymbolTable::add(const char *name, unsigned len, uintptr_t addr, uint32_t size)
+{
+  Entry e;
+
+  if (data.entries && !entries)
+    clear(); /* a generated table is replaced */
+
+  if (data.count >= capacity)
+  {
+    uint32_t c = capacity ? 2 * capacity : 1024;
+    Entry *p = (Entry*)realloc(entries, c * sizeof(Entry));
+
+    if (!p)
+      return false;
+    entries = p;
+    capacity = c;
+  }
+
+  if (!intern(name, len, e.name))
+    return false;
+  e.addr = addr;
+  e.size = size;
+  entries[data.count++] = e;
+
+  return true;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+  const SymbolTable::Entry *x = (const SymbolTable::Entry*)a;
+  const SymbolTable::Entry *y = (const SymbolTable::Entry*)b;
+
+  if (x->addr != y->addr)
+    return (x->addr < y->addr) ? -1 : 1;
+
+  return (x->name < y->name) ? -1 : (x->name > y->name);
+}
+
+bool SymbolTable::build()
+{
+  uint32_t size = 16;
+  uint32_t i, j;
+
+  qsort(entries, data.count, sizeof(Entry), &compare_entries);
+
+  /* at most half of the slots are used */
+  while (size < 2 * data.count)
+    size *= 2;
+  free(slots);
+  slots = (Slot*)calloc(size, sizeof(Slot));
+  if (!slots)
+    return false;
+
+  for (i = 0; i < data.count; i++)
+  {
+    const char *n = names + entries[i].name;
+    uint32_t h = hash(n, strlen(n));
+
+    /* the names are interned, the same name has the same offset */
+    for (j = h & (size - 1); slots[j].entry; j = (j + 1) & (size - 1))
+      if (entries[slots[j].entry - 1].name == entries[i].name)
+        break;
+    if (!slots[j].entry)
+    {
+      slots[j].hash = h;
+      slots[j].entry = i + 1;
+    }
+  }
+
+  data.entries = entries;
+  data.names = names;
+  data.slots = slots;
+  data.slotMask = size - 1;
+  hit = 0;
+
+  return true;
+}
+
+const SymbolTable::Entry* SymbolTable::find(const char *name, unsigned len) const
+{
+  uint32_t h = hash(name, len);
+  uint32_t i;
+
+  if (!data.slots)
+    return 0;
+
+  for (i = h & data.slotMask; data.slots[i].entry; i = (i + 1) & data.slotMask)
+  {
+    if (data.slots[i].hash == h)
+    {
+      const Entry *e = &data.entries[data.slots[i].entry - 1];
+      const char *n = data.names + e->name;
+
+      if ((0 == strncmp(n, name, len)) && !n[len])
+        return e;
+    }
+  }
+
+  return 0;
+}
+
+const SymbolTable::Entry* SymbolTable::lookup(uintptr_t addr) const
+{
+  const Entry *e;
+  uint32_t lo = 0, hi = data.count, first;
+  uintptr_t end;
+
+  if (hit && (addr >= data.entries[hit - 1].addr) && (addr < hitEnd))
+    return &data.entries[hit - 1];
+
+  /* the first entry starting above addr */
+  while (lo < hi)
+  {
+    uint32_t mid = lo + (hi - lo) / 2;
+
+    if (data.entries[mid].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (!lo)
+    return 0;
+
+  /* the first of the entries starting there, up to its end or the next start */
+  for (first = lo - 1; first && (data.entries[first - 1].addr == data.entries[first].addr); first--)
+    ;
+  e = &data.entries[first];
+  end = e->size ? e->addr + e->size : ((lo < data.count) ? data.entries[lo].addr : e->addr + 1);
+  if ((lo < data.count) && (end > data.entries[lo].addr))
+    end = data.entries[lo].addr;
+  if (addr >= end)
+    return 0;
+
+  hit = first + 1;
+  hitEnd = end;
+  return e;
+}
+
+#if TINYSH_SYMBOL_LOADER
+/* a field of an ELF file in host byte order */
+template<typename T>
+static T elf_value(T v, bool swap)
+{
+  T r = 0;
+  unsigned i;
+
+  if (!swap)
+    return v;
+  for (i = 0; i < sizeof(T); i++)
+  {
+    r = (T)((r << 8) | (v & 0xFF));
+    v = (T)(v >> 8);
+  }
+
+  return r;
+}
+
+/* the defined functions, objects and labels of the symbol tables
+ */
+template<class Ehdr, class Shdr, class Sym>
+static bool load_elf(SymbolTable& table, const unsigned char *file, size_t size, bool swap)
+{
+  Ehdr eh;
+  uint64_t shoff;
+  unsigned shnum, shentsize, i;
+  bool found = false;
+
+  if (size < sizeof(Ehdr))
+    return false;
+  memcpy(&eh, file, sizeof(eh));
+  shoff = elf_value(eh.e_shoff, swap);
+  shnum = elf_value(eh.e_shnum, swap);
+  shentsize = elf_value(eh.e_shentsize, swap);
+  if ((shentsize < sizeof(Shdr)) || (shoff > size) || ((uint64_t)shnum * shentsize > size - shoff))
+    return false;
+
+  for (i = 0; i < shnum; i++)
+  {
+    Shdr sh, strh;
+    uint64_t offset, strOffset, strSize, entSize, count, j;
+    unsigned link;
+
+    memcpy(&sh, file + shoff + (uint64_t)i * shentsize, sizeof(sh));
+    if (SHT_SYMTAB != elf_value(sh.sh_type, swap))
+      continue;
+    link = elf_value(sh.sh_link, swap);
+    if (link >= shnum)
+      continue;
+    memcpy(&strh, file + shoff + (uint64_t)link * shentsize, sizeof(strh));
+    strOffset = elf_value(strh.sh_offset, swap);
+    strSize = elf_value(strh.sh_size, swap);
+    offset = elf_value(sh.sh_offset, swap);
+    entSize = elf_value(sh.sh_entsize, swap);
+    if ((strOffset > size) || (strSize > size - strOffset) || (offset > size) || (entSize < sizeof(Sym)))
+      continue;
+    count = elf_value(sh.sh_size, swap) / entSize;
+    if (count > (size - offset) / entSize)
+      continue;
+
+    for (j = 0; j < count; j++)
+    {
+      Sym s;
+      uint64_t name, value;
+      unsigned type;
+      const char *n;
+      unsigned len;
+
+      memcpy(&s, file + offset + j * entSize, sizeof(s));
+      name = elf_value(s.st_name, swap);
+      type = s.st_info & 0xF;
+      if ((SHN_UNDEF == elf_value(s.st_shndx, swap)) || !name || (name >= strSize)
+          || ((STT_FUNC != type) && (STT_OBJECT != type) && (STT_NOTYPE != type)))
+        continue;
+      n = (const char*)file + strOffset + name;
+      for (len = 0; (name + len < strSize) && n[len]; len++)
+        ;
+      if (!len || ('$' == n[0])) /* ARM mapping symbols */
+        continue;
+      value = elf_value(s.st_value, swap);
+      if ((EM_ARM == elf_value(eh.e_machine, swap)) && (STT_FUNC == type))
+        value &= ~(uint64_t)1; /* Thumb bit */
+      if (!table.add(n, len, (uintptr_t)value, (uint32_t)elf_value(s.st_size, swap)))
+        return false;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+static bool is_hex(const char *s, const char *end)
+{
+  if (s == end)
+    return false;
+  for (; s < end; s++)
+    if (!(((*s >= '0') && (*s <= '9')) || (((*s | 0x20) >= 'a') && ((*s | 0x20) <= 'f'))))
+      return false;
+  return true;
+}
+
+/* lines of nm ("addr [size] type name") or of the memory map of GNU ld ("0xaddr name"), other lines
+ * are skipped
+ */
+static bool load_text(SymbolTable& table, char *text, bool map)
+{
+  char *line, *next;
+  bool found = false;
+
+  for (line = text; *line; line = next)
+  {
+    const char *token[5];
+    const char *end[5];
+    unsigned n = 0;
+    char *p;
+
+    next = strchr(line, '\n');
+    next = next ? next + 1 : line + strlen(line);
+    for (p = line; (p < next) && (n < 5);)
+    {
+      while ((p < next) && ((' ' == *p) || ('\t' == *p) || ('\r' == *p) || ('\n' == *p)))
+        p++;
+      if (p >= next)
+        break;
+      token[n] = p;
+      while ((p < next) && (' ' != *p) && ('\t' != *p) && ('\r' != *p) && ('\n' != *p))
+        p++;
+      end[n++] = p;
+    }
+
+    const char *name;
+    unsigned len;
+    uint64_t addr, size = 0;
+
+    if (map)
+    {
+      /* a symbol is "0xaddr name", assignments like "0xaddr name = ." have more tokens */
+      if ((2 != n) || (token[0][0] != '0') || (token[0][1] != 'x') || !is_hex(token[0] + 2, end[0]))
+        continue;
+      addr = strtoull(token[0] + 2, 0, 16);
+      name = token[1];
+      len = end[1] - token[1];
+    }
+    else if ((3 == n) && is_hex(token[0], end[0]) && (1 == end[1] - token[1]))
+    {
+      addr = strtoull(token[0], 0, 16);
+      name = token[2];
+      len = end[2] - token[2];
+    }
+    else if ((4 == n) && is_hex(token[0], end[0]) && is_hex(token[1], end[1]) && (1 == end[2] - token[2]))
+    {
+      addr = strtoull(token[0], 0, 16);
+      size = strtoull(token[1], 0, 16);
+      name = token[3];
+      len = end[3] - token[3];
+    }
+    else
+      continue;
+
+    if (!map && strchr("UN?-", *token[n - 2])) /* undefined, debugging */
+      continue;
+    if (!table.add(name, len, (uintptr_t)addr, (uint32_t)size))
+      return false;
+    found = true;
+  }
+
+  return found;
+}
+
+bool SymbolTable::load(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  unsigned char *file;
+  long size;
+  bool ok = false;
+
+  if (!f)
+    return false;
+  clear();
+
+  if ((0 == fseek(f, 0, SEEK_END)) && ((size = ftell(f)) > 0) && (0 == fseek(f, 0, SEEK_SET))
+      && (0 != (file = (unsigned char*)malloc(size + 1))))
+  {
+    if ((size_t)size == fread(file, 1, size, f))
+    {
+      file[size] = 0;
+      if ((size > EI_NIDENT) && (0 == memcmp(file, ELFMAG, SELFMAG)))
+      {
+        bool swap = (file[EI_DATA] == ELFDATA2MSB) != (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__);
+
+        if (ELFCLASS64 == file[EI_CLASS])
+          ok = load_elf<Elf64_Ehdr, Elf64_Shdr, Elf64_Sym>(*this, file, size, swap);
+        else
+          ok = load_elf<Elf32_Ehdr, Elf32_Shdr, Elf32_Sym>(*this, file, size, swap);
+      }
+      else
+      {
+        ok = load_text(*this, (char*)file, 0 != strstr((char*)file, "Linker script and memory map"));
+      }
+    }
+    free(file);
+  }
+  fclose(f);
+
+  if (ok)
+    ok = build();
+  if (!ok)
+    clear();
+
+  return ok;
+}
+#endif
+
+} // namespace Shell
@@ -0,0 +1,131 @@
+/*
+ * SymbolTable.h
+ *
+ */
+
+#ifndef SYMBOLTABLE_H_
+#define SYMBOLTABLE_H_
+
+#include <stdint.h>
+
+#ifndef TINYSH_SYMBOL_LOADER
+#ifdef __linux__
+#define TINYSH_SYMBOL_LOADER 1 /* 1: SymbolTable::load() reads ELF, nm and GNU map files */
+#else
+#define TINYSH_SYMBOL_LOADER 0
+#endif
+#endif
+
+namespace Shell
+{
+  /**
+   * Names and addresses of the symbols of a program, e.g. for symbolic
+   * arguments of the mem commands (see SymbolCommands.h).
+   *
+   * The table is a Data view of three arrays: the entries sorted by address,
+   * the interned names (each one once, NUL terminated) and an open addressing
+   * hash index over the names with the hash kept in the slot, so a lookup
+   * compares a name only on a matching hash. A name given for several
+   * addresses (e.g. static functions of different files) is found at the
+   * lowest one. An address is found by a binary search over the entries.
+   *
+   * On a target the arrays are constant and generated by tools/symtable.cpp,
+   * use() takes them without a copy. On the host the table is built on the
+   * heap with add() and build(), or by load() from a file.
+   */
+  class SymbolTable
+  {
+  public:
+    struct Entry
+    {
+      uintptr_t addr;
+      uint32_t size;
+      uint32_t name; /* offset in Data::names */
+    };
+
+    struct Slot
+    {
+      uint32_t hash;
+      uint32_t entry; /* index in Data::entries + 1, 0 is a free slot */
+    };
+
+    struct Data
+    {
+      const Entry *entries;
+      const char *names;
+      const Slot *slots;
+      uint32_t count;
+      uint32_t namesSize;
+      uint32_t slotMask; /* number of slots - 1, a power of 2 - 1 */
+    };
+
+    SymbolTable();
+    ~SymbolTable();
+
+    /* take a generated table, it is not copied */
+    void use(const Data& table);
+
+    /* remove all symbols */
+    void clear();
+
+    /* add a symbol to the table on the heap, return false, if out of memory */
+    bool add(const char *name, unsigned len, uintptr_t addr, uint32_t size);
+
+    /* sort the added symbols and index them, return false, if out of memory */
+    bool build();
+
+#if TINYSH_SYMBOL_LOADER
+    /* replace the table by the symbols of an ELF, nm or GNU ld map file, return false, if it has none */
+    bool load(const char *path);
+#endif
+
+    /* the entry of the name of len characters, 0, if unknown */
+    const Entry* find(const char *name, unsigned len) const;
+
+    /* the entry containing addr, 0 if none: the last one starting at or below addr, if addr is below its end
+     * (the next start for a size of 0), the last hit is kept for the sequential addresses of a dump */
+    const Entry* lookup(uintptr_t addr) const;
+
+    const char* name(const Entry& e) const;
+    const Data& table() const;
+
+    /* FNV-1a of the name, as in the Slots */
+    static uint32_t hash(const char *name, unsigned len);
+
+  private:
+    SymbolTable(const SymbolTable&);
+    SymbolTable& operator=(const SymbolTable&);
+
+    bool intern(const char *name, unsigned len, uint32_t& offset);
+    bool growIntern();
+
+    Data data;
+    mutable uint32_t hit; /* index + 1 of the last entry found by lookup(), 0 if none */
+    mutable uintptr_t hitEnd;
+
+    /* the table under construction, owned */
+    Entry *entries;
+    uint32_t capacity;
+    char *names;
+    uint32_t namesCapacity;
+    uint32_t *internSlots; /* name offset + 1 */
+    uint32_t internMask;
+    uint32_t internCount;
+    Slot *slots;
+  };
+
+  inline
+  const char* SymbolTable::name(const Entry& e) const
+  {
+    return data.names + e.name;
+  }
+
+  inline
+  const SymbolTable::Data& SymbolTable::table() const
+  {
+    return data;
+  }
+
+} // namespace Shell
+
+#endif /* SYMBOLTABLE_H_ */
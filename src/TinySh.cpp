@@ -4,31 +4,117 @@
  */
 
 #include "TinySh.h"
+#include "ShellJob.h"
+#include "CommandIndex.h"
+#include "HelpText.h"
+#include "NumberParser.h"
+#if TINYSH_STATS
+#include "CommandStats.h"
+#include "PrintfToStream.h"
+#endif
+#if TINYSH_STATS || TINYSH_EXEC_HOOKS
+#include "ShellClock.h"
+#endif
 
 #include <assert.h>
+#include <new>
 
 namespace Shell
 {
 
-const CommandDescription TinySh::help_cmd_template = { "help", "display help", "<cr>", cmd_help, 0, 0, 0 };
+const CommandDescription TinyShBase::builtins[BUILTIN_COUNT] =
+{
+  { "help", "display help", "<cr>", cmd_help, 0, 0, 0 },
+#if TINYSH_STATS
+  { "stats", "display or reset command statistics", "[reset]", cmd_stats, 0, 0, 0 },
+  { "time", "execute command and display its execution time", "command [args]", cmd_time, 0, 0, 0 },
+#endif
+};
+
+uint32_t TinyShBase::treeGeneration = 0;
+
+TinyShBase::TinyShBase(const Config& config_, void *block, void * container)
+: config(&config_), active(0), prompt("$ "), root_cmd(0),
+  plusArg(0), containerPtr(container), ioStream(nullptr), curJob(0),
+  cursorPos(0), cur_context(0), cur_buf_index(0), echo(1), cmdListIsWritable(true)
+{
+  static uint16_t sessionCount = 0;
+
+  session = sessionCount++;
+
+  if (block)
+    activate(block);
+}
 
-TinySh::TinySh(void * container)
-: help_cmd(help_cmd_template), cur_buf_index(0), cur_context(0), cursorPos(0),
-  prompt("$ "), root_cmd(&help_cmd),
-  cur_cmd_ctx(0), plusArg(0), containerPtr(container), ioStream(nullptr),
-  echo(1), cmdListIsWritable(true)
+/* make block the Active state, with empty buffers, return false, if there is no block
+ */
+bool TinyShBase::activate(void *block)
 {
   unsigned i;
 
-  trash_buffer[0] = 0;
-  context_buffer[0] = 0;
-  for (i = 0; i < HISTORY_DEPTH; ++i)
+  if (!block)
+    return false;
+
+  active = new (block) Active;
+#if TINYSH_STATS || TINYSH_EXEC_HOOKS
+  active->jobStart = 0;
+  active->jobArgc = 0;
+#endif
+#if TINYSH_STATS
+  active->timeStart = 0;
+  active->timeArgc = 0;
+  active->timing = false;
+#endif
+  active->typeaheadLen = 0;
+
+  cur_buf_index = 0;
+  for (i = 0; i < config->historyDepth + 2u; ++i)
+  {
+    line_buffer(i)[0] = 0;
+  }
+  for (i = 0; (config->historyDepth > 1) && (i < config->historyDepth); ++i)
   {
-    input_buffers[i][0] = 0;
+    new (memo(i)) Memo;
   }
+  parse_reset();
+
+  return true;
 }
 
-//  TinySh::~TinySh()
+void TinyShBase::release()
+{
+  if (curJob)
+  {
+    curJob->cancel(*this);
+    finish_job();
+  }
+
+  if (active && config->pool)
+  {
+    config->pool->give(active);
+    active = 0;
+    cursorPos = 0;
+    cur_context = 0;
+    cur_cmd_ctx = CommandNode();
+  }
+}
+
+/* without history, a session with an empty line needs its buffers only for the context
+ */
+void TinyShBase::release_unused()
+{
+  if ((1 == config->historyDepth) && !curJob && !cur_context && !active->typeaheadLen && !line_buffer(cur_buf_index)[0])
+    release();
+}
+
+/* the top level of the shell
+ */
+CommandNode TinyShBase::root() const
+{
+  return CommandNode::topLevel(&root_cmd);
+}
+
+//  TinyShBase::~TinyShBase()
 //  {
 //    // Auto-generated destructor stub
 //  }
@@ -47,18 +133,63 @@ static int tinysh_strlen(const char *s)
 
 /* callback for help function
  */
-void TinySh::cmd_help(TinySh& shell, int, const char **)
+void TinyShBase::cmd_help(TinyShBase& shell, int, const char **)
 {
-  shell.io().writeBlock("?            display help on given or available commands\n");
-  shell.io().writeBlock("<TAB>        auto-completion\n");
+  if (shell.config->help)
+    shell.io().writeBlock("?            display help on given or available commands\n");
+  if (shell.config->complete)
+    shell.io().writeBlock("<TAB>        auto-completion\n");
   shell.io().write(TOPCHAR);
   shell.io().writeBlock( "            return to command root (must be very first char on input line)\n");
   shell.io().writeBlock("<cr>         execute command line\n");
-  shell.io().writeBlock("CTRL-P       recall previous input line\n");
-  shell.io().writeBlock("CTRL-N       recall next input line\n");
+  if (shell.config->history)
+  {
+    shell.io().writeBlock("CTRL-P       recall previous input line\n");
+    shell.io().writeBlock("CTRL-N       recall next input line\n");
+  }
   shell.io().writeBlock("<any>        treat as input character\n");
 }
 
+#if TINYSH_STATS
+/* callback for stats function
+ */
+void TinyShBase::cmd_stats(TinyShBase& shell, int argc, const char **argv)
+{
+  if ((2 == argc) && (argv[1][0] == 'r'))
+    commandStats.reset();
+  else
+    commandStats.print(shell);
+}
+
+/* callback for time function
+ */
+void TinyShBase::cmd_time(TinyShBase& shell, int argc, const char **argv)
+{
+  char *line = (argc > 1) ? const_cast<char*>(argv[1]) : shell.trash_buffer();
+  int i;
+
+  /* put the command line back together, in place, the arguments follow each other in the trash buffer */
+  for (i = 1; i < argc - 1; i++)
+    const_cast<char*>(argv[i])[tinysh_strlen(argv[i])] = ' ';
+
+  shell.active->timeStart = ticks();
+  shell.exec_command_line(shell.root(), line, line);
+  if (shell.curJob)
+    shell.active->timing = true; /* display the time at the end of the job */
+  else
+    shell.print_time();
+}
+
+void TinyShBase::print_time()
+{
+  PrintfToStream fio(*ioStream);
+  uint32_t t = ticks() - active->timeStart;
+
+  fio.printf("time: %lu ticks (%lu us)\n", (unsigned long)t, (unsigned long)ticksToMicros(t));
+  active->timing = false;
+}
+#endif
+
 /*
  */
 
@@ -92,24 +223,17 @@ int strstart(const char *s1, const char *s2)
     return UNMATCH; /* no match */
 }
 
-const CommandDescription* CommandDescription::next() const
-{
-  if ((const CommandDescription*)~0 == nextPtr)
-    return this + 1;
-  else
-    return nextPtr;
-}
-
 /*
  * check commands at given level with input string.
  * _cmd: point to first command at this level, return matched cmd
  * _str: point to current unprocessed input, return next unprocessed
  */
-int TinySh::parse_command(const CommandDescription **_cmd, char **_str)
+int TinyShBase::parse_command(CommandNode *_cmd, char **_str)
 {
   char *str = *_str;
-  const CommandDescription *cmd;
-  const CommandDescription *matched_cmd = 0;
+  CommandNode cmd;
+  CommandNode matched_cmd;
+  bool ambiguous = false;
 
   /* first eliminate first blanks */
   while (*str == ' ')
@@ -120,10 +244,34 @@ int TinySh::parse_command(const CommandDescription **_cmd, char **_str)
     return NULLMATCH; /* end of input */
   }
 
+  const CommandIndex::Level *lvl = CommandIndex::level(*_cmd);
+  if (lvl)
+  {
+    /* a full match is the first one of the sorted range */
+    unsigned len, lo, hi;
+
+    for (len = 0; str[len] && str[len] != ' '; len++)
+      ;
+    CommandIndex::range(lvl, str, len, lo, hi);
+    if (lo == hi)
+      return UNMATCH;
+
+    const CommandIndex::Entry& e = CommandIndex::entry(lvl, lo);
+    *_cmd = e.cmd;
+    if ((e.len != len) && (hi - lo > 1))
+      return AMBIG;
+
+    str += len;
+    while (*str == ' ')
+      str++;
+    *_str = str;
+    return MATCH;
+  }
+
   /* first pass: count matches */
-  for (cmd = *_cmd; cmd; cmd = cmd->next())
+  for (cmd = *_cmd; !cmd.isNull(); cmd = cmd.next())
   {
-    int ret = strstart(cmd->name, str);
+    int ret = strstart(cmd.name(), str);
 
     if (ret == FULLMATCH)
     {
@@ -138,21 +286,22 @@ int TinySh::parse_command(const CommandDescription **_cmd, char **_str)
     }
     else if (ret == PARTMATCH)
     {
-      if (matched_cmd)
-      {
-        *_cmd = matched_cmd;
-        return AMBIG;
-      }
+      /* keep on searching, a full match further down wins */
+      if (!matched_cmd.isNull())
+        ambiguous = true;
       else
-      {
         matched_cmd = cmd;
-      }
     }
     else /* UNMATCH */
     {
     }
   }
-  if (matched_cmd)
+  if (ambiguous)
+  {
+    *_cmd = matched_cmd;
+    return AMBIG;
+  }
+  else if (!matched_cmd.isNull())
   {
     while (*str && *str != ' ')
       str++;
@@ -166,37 +315,177 @@ int TinySh::parse_command(const CommandDescription **_cmd, char **_str)
     return UNMATCH;
 }
 
+/* forget the parse of the current line
+ */
+void TinyShBase::parse_reset()
+{
+  active->parseLevel = CommandNode();
+  active->lastLevel = CommandNode();
+  active->parseGeneration = treeGeneration;
+  active->parseFrom = 0;
+  active->lastFrom = 0;
+  active->parseEnd = 0;
+  active->parseLine = cur_buf_index;
+  active->parseStop = 0;
+}
+
+/* parse the next word of the line, if it is finished by a space, return false if there is none
+ */
+bool TinyShBase::parse_word(char *line)
+{
+  Active& a = *active;
+  char *str = line + a.parseFrom;
+  char *end = str;
+  CommandNode cmd = a.parseLevel;
+
+  while (*end == ' ')
+    end++;
+  while (*end && *end != ' ')
+    end++;
+  if (*end != ' ')
+    return false;
+
+  if (cmd.isNull())
+    cmd = cur_cmd_ctx.isNull() ? root() : cur_cmd_ctx.child();
+  int ret = parse_command(&cmd, &str);
+
+  a.parseEnd = end - line;
+  if ((ret == MATCH) && !cmd.child().isNull()) /* a command word, the next one is a sub-command */
+  {
+    a.lastLevel = a.parseLevel;
+    a.lastFrom = a.parseFrom;
+    a.parseLevel = cmd.child();
+    a.parseFrom = end - line;
+    return true;
+  }
+
+  a.parseStop = ret; /* the arguments follow or there is no such command */
+  return false;
+}
+
+/* bring the parse up to the finished words of the current line, return the command level, the parse continues
+ * with, and in str the position in line
+ *
+ * the parse stays in front of the last command word, if only spaces follow it, to parse it as the last word
+ * of the line again
+ */
+CommandNode TinyShBase::parse_line(char *line, char **str)
+{
+  Active& a = *active;
+  CommandNode level;
+  char *s;
+
+  if ((a.parseLine != cur_buf_index) || (a.parseGeneration != treeGeneration) || (cursorPos <= a.parseEnd))
+    parse_reset();
+  while (!a.parseStop && parse_word(line))
+    ;
+
+  level = a.parseLevel;
+  s = line + a.parseFrom;
+  while (*s == ' ')
+    s++;
+  if (!*s && a.parseFrom)
+  {
+    level = a.lastLevel;
+    s = line + a.lastFrom;
+  }
+  if (level.isNull())
+    level = cur_cmd_ctx.isNull() ? root() : cur_cmd_ctx.child();
+  *str = s;
+
+  return level;
+}
+
+/* true, if m is a resolution for the current context and command tree
+ */
+bool TinyShBase::memo_valid(const Memo& m) const
+{
+  return !m.cmd.isNull() && (m.generation == treeGeneration) && (m.context == cur_cmd_ctx.key());
+}
+
+/* the current line is changed, its resolution is gone
+ */
+void TinyShBase::edited()
+{
+  if (config->historyDepth > 1)
+    memo(cur_buf_index)->cmd = CommandNode();
+  if (cursorPos <= active->parseEnd)
+    parse_reset();
+}
+
+/* execute the current line without parsing, if it or the previous line with the same command words has been
+ * resolved before, return false, if it has to be parsed, the resolution is memorized then
+ */
+bool TinyShBase::exec_memo(char *line)
+{
+  int depth = config->historyDepth;
+  Memo *m = memo(cur_buf_index);
+
+  if (!memo_valid(*m))
+  {
+    int prev = (cur_buf_index + depth - 1) % depth;
+    const Memo *p = memo(prev);
+    const char *old = line_buffer(prev);
+    unsigned i, n = p->argOffset;
+
+    for (i = 0; (i < n) && (old[i] == line[i]); i++)
+      ;
+    if (!memo_valid(*p) || (i < n) || !(!n || (old[n - 1] == ' ') || !line[n] || (line[n] == ' ')))
+    {
+      m->cmd = CommandNode();
+      m->context = cur_cmd_ctx.key();
+      m->generation = treeGeneration;
+      return false;
+    }
+    *m = *p;
+  }
+
+  exec_command(m->cmd, line + m->argOffset);
+
+  return true;
+}
+
 /* create a context from current input line
  */
-void TinySh::do_context(const CommandDescription *cmd, const char *str)
+void TinyShBase::do_context(CommandNode cmd, const char *str)
 {
-  while (*str)
-    context_buffer[cur_context++] = *str++;
+  char *context = context_buffer();
+
+  while (*str && cur_context < config->bufferSize)
+    context[cur_context++] = *str++;
 
-  while (' ' == context_buffer[cur_context - 1])
+  while (cur_context && ' ' == context[cur_context - 1])
     --cur_context;
 
-  context_buffer[cur_context] = 0;
+  context[cur_context] = 0;
   cur_cmd_ctx = cmd;
 }
 
 /* execute the given command by calling callback with appropriate
  * arguments
  */
-void TinySh::exec_command(const CommandDescription *cmd, char *str)
+void TinyShBase::exec_command(CommandNode cmd, char *str)
 {
-  const char *argv[MAX_ARGS];
+  config->exec(*this, cmd, str);
+}
+
+/* the same with the argv storage of the caller
+ */
+void TinyShBase::exec_command(CommandNode cmd, char *str, const char **argv, unsigned maxArgs)
+{
+  char *trash = trash_buffer();
   unsigned argc = 0;
   int i;
 
-  /* copy command line to preserve it for history */
-  for (i = 0; i < BUFFER_SIZE; i++)
-    trash_buffer[i] = str[i];
-  str = trash_buffer;
+  /* copy command line to preserve it for history, it may be in the trash buffer already (time) */
+  for (i = 0; i < config->bufferSize && str[i]; i++)
+    trash[i] = str[i];
+  trash[i] = 0;
+  str = trash;
 
   /* cut into arguments */
-  argv[argc++] = cmd->name;
-  while (*str && argc < MAX_ARGS)
+  argv[argc++] = cmd.name();
+  while (*str && argc < maxArgs)
   {
     // skip over leading spaces
     while (*str == ' ')
@@ -216,29 +505,94 @@ void TinySh::exec_command(const CommandDescription *cmd, char *str)
     *str++ = 0;
   }
   /* call command function if present */
-  if (cmd->function)
+  if (cmd.function())
   {
-    plusArg = cmd->arg;
-    cmd->function(*this, argc, &argv[0]);
+#if TINYSH_STATS || TINYSH_EXEC_HOOKS
+    uint32_t start = ticks();
+#endif
+#if TINYSH_EXEC_HOOKS
+    if (preExecHook)
+      preExecHook(*this, cmd, argc, &argv[0]);
+#endif
+
+    plusArg = cmd.arg();
+    cmd.function()(*this, argc, &argv[0]);
+
+#if TINYSH_STATS || TINYSH_EXEC_HOOKS
+    if (curJob && active->jobCmd.isNull())
+    {
+      /* the command has started a job, it is done at the end of the job */
+      active->jobCmd = cmd;
+      active->jobStart = start;
+      active->jobArgc = argc;
+    }
+#if TINYSH_STATS
+    else if (curJob && active->timing && active->timeCmd.isNull())
+    {
+      /* time has started a job with the timed command, both are done at the end of the job */
+      active->timeCmd = cmd;
+      active->timeArgc = argc;
+    }
+#endif
+    else
+    {
+      exec_done(cmd, argc, start);
+    }
+#endif
   }
 }
 
-/* try to execute the current command line
+#if TINYSH_STATS || TINYSH_EXEC_HOOKS
+/* account a finished command
  */
-int TinySh::exec_command_line(const CommandDescription *cmd, char *_str)
+void TinyShBase::exec_done(CommandNode cmd, int argc, uint32_t start)
 {
-  char *str = _str;
+#if TINYSH_STATS
+  commandStats.record(cmd, ticks() - start);
+#endif
+#if TINYSH_EXEC_HOOKS
+  if (postExecHook)
+    postExecHook(*this, cmd, argc, start);
+#endif
+}
+#endif
+
+#if TINYSH_EXEC_HOOKS
+PreExecHook_t TinyShBase::preExecHook = 0;
+PostExecHook_t TinyShBase::postExecHook = 0;
+
+void TinyShBase::setExecHooks(PreExecHook_t pre, PostExecHook_t post)
+{
+  preExecHook = pre;
+  postExecHook = post;
+}
 
+void TinyShBase::getExecHooks(PreExecHook_t& pre, PostExecHook_t& post)
+{
+  pre = preExecHook;
+  post = postExecHook;
+}
+#endif
+
+/* try to execute the current command line
+ */
+int TinyShBase::exec_command_line(CommandNode cmd, char *_str, char *str, Memo *m)
+{
   while (1)
   {
     int ret;
     ret = parse_command(&cmd, &str);
     if (ret == MATCH) /* found unique match */
     {
-      if (cmd)
+      if (!cmd.isNull())
       {
-        if (!cmd->child) /* no sub-command, execute */
+        if (cmd.child().isNull()) /* no sub-command, execute */
         {
+          if (m)
+          {
+            m->cmd = cmd;
+            m->argOffset = str - _str;
+          }
           exec_command(cmd, str);
           return 0;
         }
@@ -251,7 +605,7 @@ int TinySh::exec_command_line(const CommandDescription *cmd, char *_str)
           }
           else /* process next command word */
           {
-            cmd = cmd->child;
+            cmd = cmd.child();
           }
         }
       }
@@ -282,32 +636,197 @@ int TinySh::exec_command_line(const CommandDescription *cmd, char *_str)
   return 0;
 }
 
+static const char spaces[] = "                ";
+
+/* write n spaces as blocks, return the number written
+ */
+static unsigned write_spaces(ByteStream& out, unsigned n)
+{
+  unsigned done = 0;
+
+  while (done < n)
+  {
+    unsigned k = n - done;
+    unsigned r;
+
+    if (k > sizeof(spaces) - 1)
+      k = sizeof(spaces) - 1;
+    r = out.writeBlock(spaces, k);
+    done += r;
+    if (r < k)
+      break;
+  }
+
+  return done;
+}
+
+/* the help lines of a command level, one line per generate() call, with an optional pager
+ */
+class HelpJob: public OutputJob
+{
+public:
+  void start(TinyShBase& shell, CommandNode level, unsigned width, bool paged);
+
+  virtual bool input(TinyShBase& shell, char c);
+  virtual void cancel(TinyShBase& shell);
+
+protected:
+  virtual bool generate(TinyShBase& shell, ByteStream& out);
+
+private:
+  void next(CommandNode cm);
+
+  CommandNode cmd;
+  HelpText text; /* of cmd */
+  unsigned column; /* the help text column */
+  unsigned pos; /* of the current line, already written */
+  unsigned lines; /* on the current page */
+  bool paged;
+  bool waiting;
+  bool resumed;
+};
+
+/* go to cm or the next command with help after it
+ */
+void HelpJob::next(CommandNode cm)
+{
+  while (!cm.isNull() && !cm.help())
+    cm = cm.next();
+  cmd = cm;
+  if (!cm.isNull())
+    text.assign(cm.help());
+}
+
+void HelpJob::start(TinyShBase& shell, CommandNode level, unsigned width, bool paged_)
+{
+  next(level);
+  column = width + 2;
+  pos = 0;
+  lines = 0;
+  paged = paged_ && (TINYSH_HELP_PAGE_LINES > 0);
+  waiting = false;
+  resumed = false;
+  if (!cmd.isNull())
+    shell.startJob(*this);
+}
+
+bool HelpJob::generate(TinyShBase&, ByteStream& out)
+{
+  if (waiting)
+    return true; /* for a key */
+
+  if (resumed)
+  {
+    /* erase the pager prompt */
+    out.write('\r');
+    write_spaces(out, 10);
+    out.write('\r');
+    resumed = false;
+  }
+
+  if (cmd.isNull())
+    return false;
+
+#if TINYSH_HELP_PAGE_LINES
+  if (paged && (lines >= TINYSH_HELP_PAGE_LINES))
+  {
+    out.writeBlock("-- more --");
+    waiting = true;
+    lines = 0;
+    return true;
+  }
+#endif
+
+  /* the line is the name, the padding up to the column, the help and the newline */
+  unsigned nameLen = tinysh_strlen(cmd.name());
+  unsigned helpLen = text.length();
+
+  if (pos < nameLen)
+    pos += out.writeBlock(&cmd.name()[pos], nameLen - pos);
+  if ((pos >= nameLen) && (pos < column))
+    pos += write_spaces(out, column - pos);
+  if ((pos >= column) && (pos < column + helpLen))
+    pos += out.writeBlock(&text.str()[pos - column], column + helpLen - pos);
+  if (pos == column + helpLen)
+    pos += out.write('\n');
+
+  if (pos > column + helpLen)
+  {
+    pos = 0;
+    lines++;
+    next(cmd.next());
+  }
+
+  return !cmd.isNull() || resumed;
+}
+
+bool HelpJob::input(TinyShBase&, char c)
+{
+  if (!waiting)
+    return false;
+
+  waiting = false;
+  resumed = true;
+  if (c == 'q')
+    cmd = CommandNode();
+
+  return true;
+}
+
+void HelpJob::cancel(TinyShBase& shell)
+{
+  OutputJob::cancel(shell);
+  cmd = CommandNode();
+}
+
 /* display help for list of commands
  */
-void TinySh::display_child_help(const CommandDescription *cmd)
+void TinyShBase::display_child_help(CommandNode cmd)
 {
-  const CommandDescription *cm;
-  int len = 0;
+  CommandNode cm;
+  const CommandIndex::Level *lvl = CommandIndex::level(cmd);
+  unsigned len = 0;
 
   ioStream->write('\n');
-  for (cm = cmd; cm; cm = cm->next())
-    if (len < tinysh_strlen(cm->name))
-      len = tinysh_strlen(cm->name);
-  for (cm = cmd; cm; cm = cm->next())
-    if (cm->help)
+  if (lvl)
+  {
+    len = lvl->maxLen;
+  }
+  else
+  {
+    for (cm = cmd; !cm.isNull(); cm = cm.next())
     {
-      int i;
-      ioStream->writeBlock(cm->name);
-      for (i = tinysh_strlen(cm->name); i < len + 2; i++)
-        ioStream->write(' ');
-      ioStream->writeBlock(cm->help);
+      unsigned l = tinysh_strlen(cm.name());
+      if (len < l)
+        len = l;
+    }
+  }
+
+  static HelpJob helpJob; /* here, so that it is left out without the help feature */
+
+  if (!helpJob.isRunning())
+  {
+    /* the prompt follows at the end of the job */
+    helpJob.start(*this, cmd, len, echo);
+    return;
+  }
+
+  /* the job is busy on an other shell, write it all now */
+  for (cm = cmd; !cm.isNull(); cm = cm.next())
+    if (cm.help())
+    {
+      unsigned l = tinysh_strlen(cm.name());
+      HelpText text(cm.help());
+      ioStream->writeBlock(cm.name(), l);
+      write_spaces(*ioStream, len + 2 - l);
+      ioStream->writeBlock(text.str(), text.length());
       ioStream->write('\n');
     }
 }
 
 /* try to display help for current comand line
  */
-int TinySh::help_command_line(const CommandDescription *cmd, char *_str)
+int TinyShBase::help_command_line(CommandNode cmd, char *_str)
 {
   char *str = _str;
 
@@ -317,20 +836,23 @@ int TinySh::help_command_line(const CommandDescription *cmd, char *_str)
     ret = parse_command(&cmd, &str);
     if (ret == MATCH && *str == 0) /* found unique match or empty line */
     {
-      if (cmd->child) /* display sub-commands help */
+      if (!cmd.child().isNull()) /* display sub-commands help */
       {
-        display_child_help(cmd->child);
+        display_child_help(cmd.child());
         return 0;
       }
       else /* no sub-command, show single help */
       {
+        HelpText text(cmd.usage());
+
         if (*(str - 1) != ' ')
           ioStream->write(' ');
-        if (cmd->usage)
-          ioStream->writeBlock(cmd->usage);
+        if (text.str())
+          ioStream->writeBlock(text.str(), text.length());
         ioStream->writeBlock(": ");
-        if (cmd->help)
-          ioStream->writeBlock(cmd->help);
+        text.assign(cmd.help());
+        if (text.str())
+          ioStream->writeBlock(text.str(), text.length());
         else
           ioStream->writeBlock("no help available");
         ioStream->write('\n');
@@ -339,7 +861,7 @@ int TinySh::help_command_line(const CommandDescription *cmd, char *_str)
     }
     else if (ret == MATCH && *str)
     { /* continue processing the line */
-      cmd = cmd->child;
+      cmd = cmd.child();
     }
     else if (ret == AMBIG)
     {
@@ -357,10 +879,10 @@ int TinySh::help_command_line(const CommandDescription *cmd, char *_str)
     }
     else /* NULLMATCH */
     {
-      if (cur_cmd_ctx)
-        display_child_help(cur_cmd_ctx->child);
+      if (!cur_cmd_ctx.isNull())
+        display_child_help(cur_cmd_ctx.child());
       else
-        display_child_help(root_cmd);
+        display_child_help(root());
       return 0;
     }
   }
@@ -368,108 +890,162 @@ int TinySh::help_command_line(const CommandDescription *cmd, char *_str)
   return 0;
 }
 
+/* append text to the input line and echo it as one block
+ */
+void TinyShBase::insert_text(const char *text, int len)
+{
+  char *line = line_buffer(cur_buf_index);
+
+  if (len > config->bufferSize - cursorPos)
+    len = config->bufferSize - cursorPos;
+  if (len <= 0)
+    return;
+
+  if (echo)
+    ioStream->writeBlock(text, len);
+  while (len--)
+    line[cursorPos++] = *text++;
+  line[cursorPos] = 0;
+  edited();
+}
+
 /* try to complete current command line
  */
-int TinySh::complete_command_line(const CommandDescription *cmd, char *_str)
+int TinyShBase::complete_command_line(CommandNode cmd, char *_str)
 {
   char *str = _str;
 
+  while (*str == ' ')
+    str++;
+
   while (1)
   {
     int ret;
-    int common_len = BUFFER_SIZE;
     int _str_len;
-    int i;
     char *__str = str;
 
-    ret = parse_command(&cmd, &str);
     for (_str_len = 0; __str[_str_len] && __str[_str_len] != ' '; _str_len++)
       ;
-    if (ret == MATCH && *str)
+    if (__str[_str_len] == ' ')
     {
-      cmd = cmd->child;
+      /* a finished word, descend */
+      ret = parse_command(&cmd, &str);
+      if (ret != MATCH)
+        return 0;
+      cmd = cmd.child();
+      continue;
     }
-    else if (ret == AMBIG || ret == MATCH || ret == NULLMATCH)
-    {
-      const CommandDescription *cm;
-      const CommandDescription *matched_cmd = 0;
-      int nb_match = 0;
 
-      for (cm = cmd; cm; cm = cm->next())
+    /* the last word, find all commands starting with it */
+    CommandNode cm;
+    CommandNode matched_cmd;
+    CommandNode full_cmd;
+    const CommandIndex::Level *lvl = CommandIndex::level(cmd);
+    unsigned lo = 0, hi = 0;
+    int nb_match = 0;
+    int common_len = config->bufferSize;
+
+    if (lvl)
+    {
+      CommandIndex::range(lvl, __str, _str_len, lo, hi);
+      if (lo < hi)
+      {
+        const CommandIndex::Entry& e = CommandIndex::entry(lvl, lo);
+        matched_cmd = e.cmd;
+        if (e.len == _str_len)
+          full_cmd = e.cmd;
+        nb_match = hi - lo;
+        common_len = CommandIndex::commonPrefix(lvl, lo, hi);
+      }
+    }
+    else
+    {
+      for (cm = cmd; !cm.isNull(); cm = cm.next())
       {
-        int r = strstart(cm->name, __str);
+        int r = strstart(cm.name(), __str);
         if (r == FULLMATCH)
         {
-          for (i = _str_len; cmd->name[i]; i++)
-            char_in(cmd->name[i]);
-          if (*(str - 1) != ' ')
-            char_in(' ');
-          if (!cmd->child)
-          {
-            if (cmd->usage)
-            {
-              ioStream->writeBlock(cmd->usage);
-              ioStream->write('\n');
-              return 1;
-            }
-            else
-              return 0;
-          }
-          else
-          {
-            cmd = cmd->child;
-            break;
-          }
+          full_cmd = cm;
+          break;
         }
         else if (r == PARTMATCH)
         {
           nb_match++;
-          if (!matched_cmd)
+          if (matched_cmd.isNull())
           {
             matched_cmd = cm;
-            common_len = tinysh_strlen(cm->name);
+            common_len = tinysh_strlen(cm.name());
           }
           else
           {
-            for (i = _str_len; cm->name[i] && i < common_len && cm->name[i] == matched_cmd->name[i]; i++)
+            int i;
+            for (i = _str_len; cm.name()[i] && i < common_len && cm.name()[i] == matched_cmd.name()[i]; i++)
               ;
             if (i < common_len)
               common_len = i;
           }
         }
       }
-      if (cm)
-        continue;
-      if (matched_cmd)
+    }
+
+    if (!full_cmd.isNull())
+    {
+      insert_text(" ", 1);
+      if (full_cmd.child().isNull())
       {
-        if (_str_len == common_len)
+        if (full_cmd.usage())
         {
+          HelpText usage(full_cmd.usage());
+          ioStream->writeBlock(usage.str(), usage.length());
           ioStream->write('\n');
-          for (cm = cmd; cm; cm = cm->next())
+          return 1;
+        }
+        else
+          return 0;
+      }
+      cmd = full_cmd.child();
+      str += _str_len;
+      while (*str == ' ')
+        str++;
+      continue;
+    }
+
+    if (!matched_cmd.isNull())
+    {
+      if (_str_len == common_len)
+      {
+        ioStream->write('\n');
+        if (lvl)
+        {
+          unsigned i;
+          for (i = lo; i < hi; i++)
           {
-            int r = strstart(cm->name, __str);
+            ioStream->writeBlock(CommandIndex::entry(lvl, i).cmd.name());
+            ioStream->write('\n');
+          }
+        }
+        else
+        {
+          for (cm = cmd; !cm.isNull(); cm = cm.next())
+          {
+            int r = strstart(cm.name(), __str);
             if (r == FULLMATCH || r == PARTMATCH)
             {
-              ioStream->writeBlock(cm->name);
+              ioStream->writeBlock(cm.name());
               ioStream->write('\n');
             }
           }
-          return 1;
-        }
-        else
-        {
-          for (i = _str_len; i < common_len; i++)
-            char_in(matched_cmd->name[i]);
-          if (nb_match == 1)
-            char_in(' ');
         }
+        return 1;
+      }
+      else
+      {
+        insert_text(&matched_cmd.name()[_str_len], common_len - _str_len);
+        if (nb_match == 1)
+          insert_text(" ", 1);
       }
-      return 0;
-    }
-    else /* UNMATCH */
-    {
-      return 0;
     }
+    return 0;
   }
 
   return 0;
@@ -477,28 +1053,35 @@ int TinySh::complete_command_line(const CommandDescription *cmd, char *_str)
 
 /* start a new line
  */
-void TinySh::start_of_line()
+void TinyShBase::start_of_line()
 {
   /* display start of new line */
   ioStream->writeBlock(prompt);
   if (cur_context)
   {
-    ioStream->writeBlock(context_buffer);
+    ioStream->writeBlock(context_buffer());
     ioStream->writeBlock(" > ");
   }
   cursorPos = 0;
 }
 
 /* new character input */
-void TinySh::char_in(char c)
+void TinyShBase::char_in(char c)
 {
   assert(ioStream);
 
-  char *line = input_buffers[cur_buf_index];
+  /* an idle session takes its buffers with the first input, that is not an empty line */
+  if (!active && (c != '\n') && (c != '\r') && !activate(config->pool->take()))
+  {
+    ioStream->write('\a'); /* dropped, all blocks are in use */
+    return;
+  }
+
+  char *line = active ? line_buffer(cur_buf_index) : 0;
 
   if (c == '\n' || c == '\r') /* validate command */
   {
-    const CommandDescription *cmd;
+    CommandNode cmd;
 
     /* first, echo the newline */
     if (echo)
@@ -507,17 +1090,29 @@ void TinySh::char_in(char c)
     if (echo && ('\r' == c))
       ioStream->write('\n');
 
-    while (*line && *line == ' ')
-      line++;
-    if (*line) /* not empty line */
+    char *str = line;
+
+    while (str && *str == ' ')
+      str++;
+    if (str && *str) /* not empty line */
     {
-      cmd = cur_cmd_ctx ? cur_cmd_ctx->child : root_cmd;
-      exec_command_line(cmd, line);
-      cur_buf_index = (cur_buf_index + 1) % HISTORY_DEPTH;
+      if ((config->historyDepth <= 1) || !exec_memo(line))
+      {
+        Memo *m = (config->historyDepth > 1) ? memo(cur_buf_index) : 0;
+        char *from;
+
+        cmd = parse_line(line, &from);
+        exec_command_line(cmd, str, from, m);
+        if (m)
+          m->argOffset += str - line;
+      }
+      cur_buf_index = (cur_buf_index + 1) % config->historyDepth;
       cursorPos = 0;
-      input_buffers[cur_buf_index][0] = 0;
+      line_buffer(cur_buf_index)[0] = 0;
+      edited();
     }
-    start_of_line();
+    if (!curJob) /* otherwise the prompt follows at the end of the job */
+      start_of_line();
   }
   else if ((c == TOPCHAR) && (cursorPos == 0)) /* return to top level */
   {
@@ -525,7 +1120,7 @@ void TinySh::char_in(char c)
       ioStream->write(c);
 
     cur_context = 0;
-    cur_cmd_ctx = 0;
+    cur_cmd_ctx = CommandNode();
   }
   else if (c == CTRL('H') || c == 127) /* backspace */
   {
@@ -535,81 +1130,110 @@ void TinySh::char_in(char c)
         ioStream->writeBlock("\b \b");
       cursorPos--;
       line[cursorPos] = 0;
+      edited();
     }
   }
-  else if (c == CTRL('P')) /* CTRL-P: back in history */
+  else if ((c == CTRL('P') || c == CTRL('N')) && config->history)
   {
-    int prevline = (cur_buf_index + HISTORY_DEPTH - 1) % HISTORY_DEPTH;
-
-    if (input_buffers[prevline][0])
-    {
-      line = input_buffers[prevline];
-      /* fill the rest of the line with spaces */
-      while (cursorPos-- > tinysh_strlen(line))
-        ioStream->writeBlock("\b \b");
-      ioStream->write('\r');
-      start_of_line();
-      ioStream->writeBlock(line);
-      cursorPos = tinysh_strlen(line);
-      cur_buf_index = prevline;
-    }
+    config->history(*this, c);
   }
-  else if (c == CTRL('N')) /* CTRL-N: next in history */
+  else if (c == '?' && config->help)
   {
-    int nextline = (cur_buf_index + 1) % HISTORY_DEPTH;
-
-    if (input_buffers[nextline][0])
-    {
-      line = input_buffers[nextline];
-      /* fill the rest of the line with spaces */
-      while (cursorPos-- > tinysh_strlen(line))
-        ioStream->writeBlock("\b \b");
-      ioStream->write('\r');
-      start_of_line();
-      ioStream->writeBlock(line);
-      cursorPos = tinysh_strlen(line);
-      cur_buf_index = nextline;
-    }
+    config->help(*this);
   }
-  else if (c == '?') /* display help */
+  else if ((c == CTRL('I') || c == '!') && config->complete)
   {
-    const CommandDescription *cmd;
-    cmd = cur_cmd_ctx ? cur_cmd_ctx->child : root_cmd;
-    help_command_line(cmd, line);
-    start_of_line();
-    ioStream->writeBlock(line);
-    cursorPos = tinysh_strlen(line);
-  }
-  else if (c == CTRL('I') || c == '!') /* TAB: autocompletion */
-  {
-    const CommandDescription *cmd;
-    cmd = cur_cmd_ctx ? cur_cmd_ctx->child : root_cmd;
-    if (complete_command_line(cmd, line))
-    {
-      start_of_line();
-      ioStream->writeBlock(line);
-    }
-    cursorPos = tinysh_strlen(line);
+    config->complete(*this);
   }
   else if ((' ' <= c) && (127 >= c))/* any input character */
   {
-    if (cursorPos < BUFFER_SIZE) // accept warning for comparison signed vs unsigned
+    if (cursorPos < config->bufferSize)
     {
       if (echo)
         ioStream->write(c);
       line[cursorPos++] = c;
       line[cursorPos] = 0;
+      edited();
+      if ((c == ' ') && (cursorPos > 1) && (line[cursorPos - 2] != ' '))
+      {
+        /* a finished word */
+        char *from;
+        uint8_t stop = active->parseStop;
+
+        parse_line(line, &from);
+        if (config->liveCheck && echo && !stop && ((active->parseStop == UNMATCH) || (active->parseStop == AMBIG)))
+          ioStream->write('\a');
+      }
     }
   }
 }
 
+/* CTRL-P: back in history, CTRL-N: next in history
+ */
+void TinyShBase::key_history(TinyShBase& shell, char c)
+{
+  int depth = shell.config->historyDepth;
+  int other = (c == shell.CTRL('P')) ? (shell.cur_buf_index + depth - 1) % depth : (shell.cur_buf_index + 1) % depth;
+  char *line = shell.line_buffer(other);
+
+  if (line[0])
+  {
+    /* fill the rest of the line with spaces */
+    while (shell.cursorPos-- > tinysh_strlen(line))
+      shell.ioStream->writeBlock("\b \b");
+    shell.ioStream->write('\r');
+    shell.start_of_line();
+    shell.ioStream->writeBlock(line);
+    shell.cursorPos = tinysh_strlen(line);
+    shell.cur_buf_index = other;
+  }
+}
+
+/* '?': display help
+ */
+void TinyShBase::key_help(TinyShBase& shell)
+{
+  CommandNode cmd;
+  char *line = shell.line_buffer(shell.cur_buf_index);
+  char *from;
+
+  cmd = shell.parse_line(line, &from);
+  shell.help_command_line(cmd, from);
+  if (!shell.curJob) /* otherwise the line is redrawn at the end of the job */
+  {
+    shell.start_of_line();
+    shell.ioStream->writeBlock(line);
+    shell.cursorPos = tinysh_strlen(line);
+  }
+}
+
+/* TAB: autocompletion
+ */
+void TinyShBase::key_complete(TinyShBase& shell)
+{
+  CommandNode cmd;
+  char *line = shell.line_buffer(shell.cur_buf_index);
+  char *from;
+
+  cmd = shell.parse_line(line, &from);
+  if (shell.complete_command_line(cmd, from))
+  {
+    shell.start_of_line();
+    shell.ioStream->writeBlock(line);
+  }
+  shell.cursorPos = tinysh_strlen(line);
+}
+
 /* add a new command */
-Shell::TinySh& TinySh::add_command(CommandDescription *cmd, CommandDescription *parent)
+Shell::TinyShBase& TinyShBase::add_command(CommandDescription *cmd, CommandDescription *parent)
 {
   CommandDescription *cm;
 
   assert(cmdListIsWritable); // oder es wurde ein Kommando (eine Liste) const hinzugefügt, danach ist die gesamte Liste readonly
 
+  CommandIndex::invalidate();
+  treeGeneration++;
+
   if (parent)
   {
     cm = const_cast<CommandDescription*>(parent->child);
@@ -639,61 +1263,319 @@ Shell::TinySh& TinySh::add_command(CommandDescription *cmd, CommandDescription *
   return *this;
 }
 
+/* mount a packed tree */
+Shell::TinyShBase& TinyShBase::add_command(const PackedTree& tree, CommandDescription *parent)
+{
+  assert(parent && !parent->child); // ein gepackter Baum wird immer unter einem Kommando ohne Unterkommandos eingehängt
+
+  bool mounted = CommandNode::mount(parent, &tree);
+  assert(mounted); // die Tabelle der gepackten Bäume ist voll, TINYSH_PACKED_MOUNTS erhöhen
+  (void)mounted;
+
+  CommandIndex::invalidate();
+  treeGeneration++;
+
+  return *this;
+}
+
 /* string to decimal/hexadecimal conversion
  */
-unsigned long TinySh::atoxi(const char *s, bool isHex)
+unsigned long TinyShBase::atoxi(const char *s, bool isHex)
 {
-  int ishex = int(isHex);
-  unsigned long res = 0;
+  uint64_t value;
 
-  if (*s == 0)
-    return 0;
+  /* the value up to an invalid character, as before, numbers go before symbols */
+  if (NumberParser::INVALID == NumberParser::parse(s, value, isHex))
+    resolveSymbol(s, value, isHex);
 
-  if (*s == '0' && *(s + 1) == 'x')
-  {
-    ishex = 1;
-    s += 2;
-  }
+  return (unsigned long)value;
+}
 
-  while (*s)
-  {
-    if (ishex)
-      res *= 16;
-    else
-      res *= 10;
-
-    if (*s >= '0' && *s <= '9')
-      res += *s - '0';
-    else if (ishex && *s >= 'a' && *s <= 'f')
-      res += *s + 10 - 'a';
-    else if (ishex && *s >= 'A' && *s <= 'F')
-      res += *s + 10 - 'A';
-    else
-      break;
+SymbolResolver_t TinyShBase::symbolResolver = 0;
 
-    s++;
-  }
+void TinyShBase::setSymbolResolver(SymbolResolver_t resolver)
+{
+  symbolResolver = resolver;
+}
 
-  return res;
+bool TinyShBase::resolveSymbol(const char *s, uint64_t& value, bool isHex)
+{
+  uint64_t addr, offset = 0;
+  unsigned len = 0;
+
+  while (s[len] && (s[len] != '+') && (s[len] != '-'))
+    len++;
+  if (!symbolResolver || !len || !symbolResolver(s, len, addr))
+    return false;
+  if (s[len] && (NumberParser::VALID != NumberParser::parse(s + len, offset, isHex)))
+    return false;
+
+  value = addr + offset;
+  return true;
 }
 
-bool TinySh::checkInput()
+bool TinyShBase::checkInput()
 {
   assert(0 != ioStream); // erst setIo() ausführen, bevor die ersten Ausgaben gemacht werden
 
   char c;
   bool hadInput = false;
 
-  if (ioStream->read(c))
+  if (curJob)
+  {
+    /* while busy, only CTRL-C and CTRL-T are serviced, other input goes to the job or is kept as type-ahead */
+    if (ioStream->read(c))
+    {
+      if (curJob->rawInput() && curJob->input(*this, c))
+      {
+      }
+      else if (c == CTRL('C'))
+      {
+        ioStream->writeBlock("^C\n");
+        if (active)
+          active->typeaheadLen = 0;
+        curJob->cancel(*this);
+        end_job();
+        return true;
+      }
+      else if (c == CTRL('T'))
+      {
+        unsigned long done, total;
+        if (curJob->progress(done, total))
+        {
+          char buf[24];
+          int i = sizeof(buf);
+
+          buf[--i] = '\n';
+          buf[--i] = ']';
+          if (total)
+          {
+            unsigned long percent;
+            if (done >= total)
+              percent = 100;
+            else if (total < ((unsigned long)-1) / 100)
+              percent = done * 100 / total;
+            else
+              percent = done / (total / 100);
+            buf[--i] = '%';
+            do
+            {
+              buf[--i] = '0' + percent % 10;
+              percent /= 10;
+            } while (percent);
+          }
+          else
+          {
+            buf[--i] = '?';
+          }
+          buf[--i] = '[';
+          ioStream->writeBlock(&buf[i], sizeof(buf) - i);
+        }
+      }
+      else if (curJob->input(*this, c))
+      {
+      }
+      else if (active && (active->typeaheadLen < TYPEAHEAD_SIZE))
+      {
+        active->typeahead[active->typeaheadLen++] = c;
+      }
+    }
+    run_job();
+    hadInput = true;
+  }
+  else if (ioStream->read(c))
   {
     char_in(c);
+    if (active && config->pool)
+      release_unused();
     hadInput = true;
   }
 
   return hadInput;
 }
 
-void TinySh::feed(const char* script)
+void TinyShBase::startJob(Job& job)
+{
+  assert(!curJob); // es kann immer nur ein Job pro Sitzung laufen
+  assert(!job.isRunning());
+
+  if (!active && config->pool)
+    activate(config->pool->take()); /* for the type-ahead, the job may run without */
+
+  job.runningOn = this;
+  curJob = &job;
+}
+
+CommandNode TinyShBase::resolveCommand(char *line, char **args)
+{
+  CommandNode cmd = root();
+  char *str = line;
+
+  while (1)
+  {
+    int ret = parse_command(&cmd, &str);
+
+    if (ret == MATCH)
+    {
+      if (cmd.child().isNull() || !*str)
+        break;
+      cmd = cmd.child();
+    }
+    else
+    {
+      if (ret == AMBIG)
+        ioStream->writeBlock("ambiguity: ");
+      else if (ret == UNMATCH)
+        ioStream->writeBlock("no match: ");
+      else
+        ioStream->writeBlock("no command");
+      ioStream->writeBlock(str);
+      ioStream->write('\n');
+      return CommandNode();
+    }
+  }
+
+  if (!cmd.function())
+  {
+    ioStream->writeBlock("not executable: ");
+    ioStream->writeBlock(cmd.name());
+    ioStream->write('\n');
+    return CommandNode();
+  }
+
+  *args = str;
+  return cmd;
+}
+
+Job* TinyShBase::execNested(CommandNode cmd, int argc, const char **argv)
+{
+  Job *outer = curJob;
+  Job *job;
+
+  /* a job started by the function is taken from curJob, the outer one stays current */
+  curJob = 0;
+  plusArg = cmd.arg();
+  cmd.function()(*this, argc, argv);
+  job = curJob;
+  curJob = outer;
+
+  return job;
+}
+
+void TinyShBase::endNested(Job& job)
+{
+  job.runningOn = 0;
+}
+
+/* do one slice of the current job, finish it, if it has nothing more to do
+ */
+void TinyShBase::run_job()
+{
+  if (!curJob->step(*this))
+    end_job();
+}
+
+void TinyShBase::end_job()
+{
+  unsigned i = 0, j = 0;
+
+  finish_job();
+
+  /* redraw the input line, it is not empty, if the job was started by a key like '?' */
+  start_of_line();
+  if (!active)
+    return;
+  ioStream->writeBlock(line_buffer(cur_buf_index));
+  cursorPos = tinysh_strlen(line_buffer(cur_buf_index));
+
+  /* process the type-ahead, until it is done or the next job is started */
+  while ((i < active->typeaheadLen) && !curJob)
+    char_in(active->typeahead[i++]);
+  while (i < active->typeaheadLen)
+    active->typeahead[j++] = active->typeahead[i++];
+  active->typeaheadLen = j;
+  if (!curJob && config->pool)
+    release_unused();
+}
+
+/* the job is gone, account its command
+ */
+void TinyShBase::finish_job()
+{
+  curJob->runningOn = 0;
+  curJob = 0;
+
+  if (!active)
+    return;
+#if TINYSH_STATS || TINYSH_EXEC_HOOKS
+  if (!active->jobCmd.isNull())
+  {
+    CommandNode cmd = active->jobCmd;
+    active->jobCmd = CommandNode();
+    exec_done(cmd, active->jobArgc, active->jobStart);
+  }
+#endif
+#if TINYSH_STATS
+  if (active->timing)
+  {
+    print_time();
+    if (!active->timeCmd.isNull())
+    {
+      CommandNode cmd = active->timeCmd;
+      active->timeCmd = CommandNode();
+      exec_done(cmd, active->timeArgc, active->timeStart);
+    }
+  }
+#endif
+}
+
+/* depth first search of the command with the given key, the path to it is collected in buf
+ */
+bool TinyShBase::find_path(CommandNode level, const void *key, char *buf, unsigned pos, unsigned size)
+{
+  CommandNode cm;
+
+  for (cm = level; !cm.isNull(); cm = cm.next())
+  {
+    unsigned i = pos;
+    const char *name = cm.name();
+
+    if (i && i < size)
+      buf[i++] = ' ';
+    while (*name && i < size)
+      buf[i++] = *name++;
+    if (i >= size)
+      continue;
+    buf[i] = 0;
+
+    if (cm.key() == key)
+      return true;
+    if (!cm.child().isNull() && find_path(cm.child(), key, buf, i, size))
+      return true;
+  }
+
+  return false;
+}
+
+bool TinyShBase::commandPath(CommandNode cmd, char *buf, unsigned size) const
+{
+  return commandPath(cmd.key(), buf, size);
+}
+
+bool TinyShBase::commandPath(const void *key, char *buf, unsigned size) const
+{
+  if (!size)
+    return false;
+
+  buf[0] = 0;
+  if (find_path(root(), key, buf, 0, size))
+    return true;
+
+  buf[0] = 0;
+  return false;
+}
+
+void TinyShBase::feed(const char* script)
 {
   if (script)
   {
@@ -702,10 +1584,25 @@ void TinySh::feed(const char* script)
     echo = false;
     prompt = "";
     while (*script)
+    {
+      unsigned long steps = 0;
+
       char_in(*script++);
+      /* scripts have no interactive input, jobs are run to their end or cancelled */
+      while (curJob && (steps++ < TINYSH_FEED_STEPS))
+        run_job();
+      if (curJob)
+      {
+        ioStream->writeBlock("feed: job cancelled, it does not end\n");
+        curJob->cancel(*this);
+        end_job();
+      }
+    }
     prompt = oldPrompt;
     echo = oldEcho;
     triggerPrompt();
+    if (active && config->pool)
+      release_unused();
   }
 }
 
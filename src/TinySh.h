@@ -7,69 +7,183 @@
 #define TINYSH_H_
 
 #include "ByteStream.h"
+#include "CommandNode.h"
+#include "SessionPool.h"
+
+#include <stdint.h>
 
 #ifndef TINYSH_BUFFER_SIZE
-#define TINYSH_BUFFER_SIZE 80
+#define TINYSH_BUFFER_SIZE 80 /* the default of TinyShPolicy */
 #endif
 
 #ifndef TINYSH_HISTORY_DEPTH
-#define TINYSH_HISTORY_DEPTH 8
+#define TINYSH_HISTORY_DEPTH 8 /* the default of TinyShPolicy */
 #endif
 
 #ifndef TINYSH_MAX_ARGS
-#define TINYSH_MAX_ARGS 16
+#define TINYSH_MAX_ARGS 16 /* the default of TinyShPolicy */
 #endif
 
-#ifndef TINYSH_TOPCHAR
-#define TINYSH_TOPCHAR '/'
+#ifndef TINYSH_TYPEAHEAD_SIZE
+#define TINYSH_TYPEAHEAD_SIZE 16
+#endif
+
+#ifndef TINYSH_HELP_PAGE_LINES
+#define TINYSH_HELP_PAGE_LINES 0 /* >0: interactive help stops after that many lines for a key, 'q' quits */
+#endif
+
+#ifndef TINYSH_COMPRESSED_HELP
+#define TINYSH_COMPRESSED_HELP 0 /* 1: help and usage texts are compressed by tools/helpcompress */
 #endif
 
-#ifndef TINYSH_COMMANDCHAIN_MUTABLE
-#define TINYSH_COMMANDCHAIN_MUTABLE
+#ifndef TINYSH_STATS
+#define TINYSH_STATS 0 /* 1: per command statistics, stats and time builtins */
+#endif
+
+#ifndef TINYSH_EXEC_HOOKS
+#define TINYSH_EXEC_HOOKS 0 /* 1: pre and post execution hooks, e.g. for the command trace */
+#endif
+
+#ifndef TINYSH_FEED_STEPS
+#define TINYSH_FEED_STEPS 65536 /* job slices a script command may take, then its job is cancelled */
+#endif
+
+#ifndef TINYSH_TOPCHAR
+#define TINYSH_TOPCHAR '/'
 #endif
 
 namespace Shell
 {
-  class TinySh;
+  class Job;
+
+  /* called right before the command function */
+  typedef void (*PreExecHook_t)(TinyShBase& shell, CommandNode cmd, int argc, const char **argv);
+
+  /* called when the command is done, this is at the end of its job, if it started one */
+  typedef void (*PostExecHook_t)(TinyShBase& shell, CommandNode cmd, int argc, uint32_t startTicks);
+
+  /* the address of the symbol name of len characters, return false, if unknown */
+  typedef bool (*SymbolResolver_t)(const char *name, unsigned len, uint64_t& value);
+
+  /*
+   * the sizes and features of a shell, for BasicTinySh<Policy>
+   *
+   * an own policy derives from this one and overrides, what differs:
+   *
+   *   struct ServicePortPolicy: Shell::TinyShPolicy
+   *   {
+   *     static const unsigned BUFFER_SIZE = 40;
+   *     static const bool HISTORY = false;
+   *   };
+   *   Shell::BasicTinySh<ServicePortPolicy> shell;
+   *
+   * the code of disabled features is not referenced and is dropped by the linker (-ffunction-sections, --gc-sections)
+   *
+   * with SESSION_POOL > 0 the buffers are not part of the shell, an idle shell takes them from a pool
+   * of that many blocks on its first input and returns them with release(), or after each command
+   * line without history
+   */
+  struct TinyShPolicy
+  {
+    static const unsigned BUFFER_SIZE = TINYSH_BUFFER_SIZE; /* characters of an input line */
+    static const unsigned HISTORY_DEPTH = TINYSH_HISTORY_DEPTH; /* input lines kept for CTRL-P and CTRL-N */
+    static const unsigned MAX_ARGS = TINYSH_MAX_ARGS; /* argv entries, including the command name */
+    static const bool HELP = true; /* '?' displays help */
+    static const bool COMPLETION = true; /* TAB completes */
+    static const bool HISTORY = true; /* CTRL-P and CTRL-N recall input lines, otherwise only one line is kept */
+    static const bool LIVE_CHECK = false; /* BEL, as soon as an unknown or ambiguous command word is typed */
+    static const unsigned SESSION_POOL = 0; /* >0: active sessions of this policy share that many buffer blocks */
+  };
 
-  typedef void (*CommandFunction_t)(TinySh& shell, int argc, const char **argv);
+  template<class Policy>
+  struct ShellBlockSize;
 
-  struct CommandDescription
+  /*
+   * the shell, as seen by the command functions, the buffers come from BasicTinySh<Policy>
+   */
+  class TinyShBase
   {
-    const char *name; /* command input name, not 0 */
-    const char *help; /* help string, can be 0 */
-    const char *usage; /* usage string, can be 0 */
-    CommandFunction_t function; /* function to launch on cmd, can be 0 */
-    void *arg; /* current argument when function called */
-    const CommandDescription TINYSH_COMMANDCHAIN_MUTABLE *nextPtr; /* must be set to 0 at init, must be ~0 on array members, last array member must be 0 on init */
-    const CommandDescription TINYSH_COMMANDCHAIN_MUTABLE *child; /* must be set to 0 at init */
+  protected:
+    /* the sizes and features of a shell, one static table per policy, a disabled feature is 0 */
+    struct Config
+    {
+      uint16_t bufferSize;
+      uint8_t historyDepth;
+      SessionPool *pool; /* of the Active blocks, 0 if the shell has its own */
+      void (*exec)(TinyShBase& shell, CommandNode cmd, char *str); /* cuts the arguments, argv is on its stack */
+      void (*help)(TinyShBase& shell);
+      void (*complete)(TinyShBase& shell);
+      void (*history)(TinyShBase& shell, char c);
+      bool liveCheck;
+    };
+
+    /* the resolved command of a history line, to execute it again without parsing */
+    struct Memo
+    {
+      CommandNode cmd; /* null, if not resolved */
+      const void *context; /* the key of the context, the line was resolved in */
+      uint32_t generation; /* of the command tree */
+      uint16_t argOffset; /* the arguments start here in the line */
+    };
+
+    /*
+     * the state of a session with input, followed by a Memo per history line (with history)
+     * and historyDepth + 2 buffers of bufferSize + 1 characters
+     */
+    struct Active
+    {
+#if TINYSH_STATS || TINYSH_EXEC_HOOKS
+      CommandNode jobCmd; /* the command, that started the current job */
+      uint32_t jobStart;
+      int jobArgc;
+#endif
+#if TINYSH_STATS
+      CommandNode timeCmd; /* time, when the timed command has started a job */
+      uint32_t timeStart;
+      int timeArgc;
+      bool timing;
+#endif
+      uint8_t typeaheadLen;
+      char typeahead[TINYSH_TYPEAHEAD_SIZE];
 
-    const CommandDescription* next() const;
-  };
+      /* the parse of the finished words of the current line, see parse_line() */
+      CommandNode parseLevel; /* of the next word, null for the first level */
+      CommandNode lastLevel; /* of the last command word, that has sub-commands */
+      uint32_t parseGeneration; /* of the command tree */
+      uint16_t parseFrom; /* the next word follows, 0 if none is parsed */
+      uint16_t lastFrom; /* the last command word with sub-commands follows */
+      uint16_t parseEnd; /* the end of the last parsed word */
+      uint8_t parseLine; /* the line buffer */
+      uint8_t parseStop; /* the result of a word, that ends the parse, 0 if not stopped */
+    };
+
+    static const unsigned ACTIVE_SIZE = (sizeof(Active) + alignof(Memo) - 1) / alignof(Memo) * alignof(Memo);
+
+    /* block is the Active state of the shell, 0 if it is taken from config.pool on the first input */
+    TinyShBase(const Config& config, void *block, void * container);
 
-  class TinySh
-  {
   public:
-    TinySh(void * container = 0);
-//    virtual
-//    ~TinySh();
 
     /***
      * add a new command
      *
      * parent == 0, if toplevel command
      **/
-    TinySh& add_command(CommandDescription *cmd, CommandDescription* parent = 0);
-    TinySh& add_command(const CommandDescription *cmd, CommandDescription* parent = 0);
+    TinyShBase& add_command(CommandDescription *cmd, CommandDescription* parent = 0);
+    TinyShBase& add_command(const CommandDescription *cmd, CommandDescription* parent = 0);
+
+    /* add the top level of a packed tree as sub-commands of parent, which must not have sub-commands,
+     * at most TINYSH_PACKED_MOUNTS trees are mounted (asserted) */
+    TinyShBase& add_command(const PackedTree& tree, CommandDescription* parent);
 
     /* connect the IO channel */
-    TinySh& setIo(ByteStream& io);
+    TinyShBase& setIo(ByteStream& io);
 
     /* set the input echo */
     void setEcho(bool echo);
 
     /* change tinysh prompt */
-    TinySh& set_prompt(const char *str);
+    TinyShBase& set_prompt(const char *str);
 
     /* get command argument back */
     void* get_arg();
@@ -77,13 +191,23 @@ namespace Shell
     /* get the instance container ptr back */
     void* get_container();
 
-    /* provide conversion string to scalar (decimal or hexadecimal) */
+    /* provide conversion string to scalar (decimal or hexadecimal), without error check, see NumberParser,
+     * or of symbol[+|-offset], if it is no number and a symbol resolver is installed */
     static unsigned long atoxi(const char *s, bool isHex = false);
 
+    /* convert symbol[+|-offset], return false, if it is none */
+    static bool resolveSymbol(const char *s, uint64_t& value, bool isHex = false);
+
+    /* install the symbol lookup of atoxi() and resolveSymbol(), 0 to remove */
+    static void setSymbolResolver(SymbolResolver_t resolver);
+
     /* process new character input, return true, if there was something to do */
     bool checkInput();
 
-    /* feed literal input characters as command script without echo and prompt*/
+    /*
+     * feed literal input characters as command script without echo and prompt, the jobs are run to their end,
+     * one that waits for input or does not end within TINYSH_FEED_STEPS slices is cancelled
+     */
     void feed(const char* script);
 
     /* get the IO object for character input and output */
@@ -91,39 +215,123 @@ namespace Shell
 
     void triggerPrompt(); // das ist dann z.B. gut für eine neue Netzwerkverbindung
 
+    /* run a resumable command, to be called from a command function */
+    void startJob(Job& job);
+
+    /* true, while a job is running and the input line is not processed */
+    bool isBusy() const;
+
+    /* resolve the command words of line from the top level, return the command and in args the start of its
+     * arguments, a null node and a message, if it is unknown, ambiguous or has no function */
+    CommandNode resolveCommand(char *line, char **args);
+
+    /* call the function of cmd with arguments cut already, while the current job (e.g. watch) keeps running,
+     * return the job started by the function, 0 if none, the caller steps or cancels it and ends it with endNested() */
+    Job* execNested(CommandNode cmd, int argc, const char **argv);
+    void endNested(Job& job);
+
+#if TINYSH_EXEC_HOOKS
+    /* install hooks around the command execution of all shells, 0 to remove */
+    static void setExecHooks(PreExecHook_t pre, PostExecHook_t post);
+
+    /* the installed hooks, e.g. to chain to them */
+    static void getExecHooks(PreExecHook_t& pre, PostExecHook_t& post);
+#endif
+
+    /* session number, unique per shell instance, unless changed */
+    unsigned sessionId() const;
+    void setSessionId(unsigned id);
+
+    /* write the full command path of cmd (e.g. "mem byte read") to buf, return false, if not found */
+    bool commandPath(CommandNode cmd, char *buf, unsigned size) const;
+
+    /* the same for a command given by its CommandNode::key() */
+    bool commandPath(const void *key, char *buf, unsigned size) const;
+
+    /* give the buffers back to the session pool, the history and the context are lost, a running job is cancelled */
+    void release();
+
+  protected:
+    void exec_command(CommandNode cmd, char *str, const char **argv, unsigned maxArgs);
+
+    static void key_help(TinyShBase& shell);
+    static void key_complete(TinyShBase& shell);
+    static void key_history(TinyShBase& shell, char c);
+
   private:
-    int parse_command(const CommandDescription **_cmd, char **_str);
-    void do_context(const CommandDescription *cmd, const char *str);
-    void exec_command(const CommandDescription *cmd, char *str);
-    int exec_command_line(const CommandDescription *cmd, char *_str);
-    void display_child_help(const CommandDescription *cmd);
-    int help_command_line(const CommandDescription *cmd, char *_str);
-    int complete_command_line(const CommandDescription *cmd, char *_str);
+    int parse_command(CommandNode *_cmd, char **_str);
+    void do_context(CommandNode cmd, const char *str);
+    void exec_command(CommandNode cmd, char *str);
+    int exec_command_line(CommandNode cmd, char *_str, char *str, Memo *m = 0);
+    void display_child_help(CommandNode cmd);
+    int help_command_line(CommandNode cmd, char *_str);
+    int complete_command_line(CommandNode cmd, char *_str);
+    void insert_text(const char *text, int len);
     void start_of_line();
+    void run_job();
+    void end_job();
+    void exec_done(CommandNode cmd, int argc, uint32_t start);
+    static bool find_path(CommandNode level, const void *key, char *buf, unsigned pos, unsigned size);
+
+    void finish_job();
+    bool activate(void *block);
+    void release_unused();
+    CommandNode root() const;
+
+    void parse_reset();
+    bool parse_word(char *line);
+    CommandNode parse_line(char *line, char **str);
 
-    static const int BUFFER_SIZE = TINYSH_BUFFER_SIZE;
-    static const unsigned HISTORY_DEPTH = TINYSH_HISTORY_DEPTH;
-    static const unsigned MAX_ARGS = TINYSH_MAX_ARGS;
+    Memo* memo(int i);
+    bool memo_valid(const Memo& m) const;
+    bool exec_memo(char *line);
+    void edited();
+
+    char* line_buffer(int i);
+    char* trash_buffer();
+    char* context_buffer();
+
+    static uint32_t treeGeneration; /* counts the changes of the command tree */
+
+    static const unsigned TYPEAHEAD_SIZE = TINYSH_TYPEAHEAD_SIZE;
     static const char TOPCHAR = TINYSH_TOPCHAR;
 
-    static void cmd_help(TinySh& shell, int argc, const char **argv);
+    static void cmd_help(TinyShBase& shell, int argc, const char **argv);
+
+#if TINYSH_STATS
+    static void cmd_stats(TinyShBase& shell, int argc, const char **argv);
+    static void cmd_time(TinyShBase& shell, int argc, const char **argv);
+    void print_time();
+#endif
+
+    template<class Policy>
+    friend struct ShellBlockSize;
+
+    /* the builtin commands, they start the top level of every shell */
+    friend class CommandNode;
+    static const CommandDescription builtins[];
+    static const unsigned BUILTIN_COUNT = TINYSH_STATS ? 3 : 1;
 
-    static const CommandDescription help_cmd_template;
-    CommandDescription help_cmd;
+#if TINYSH_EXEC_HOOKS
+    static PreExecHook_t preExecHook;
+    static PostExecHook_t postExecHook;
+#endif
+    static SymbolResolver_t symbolResolver;
 
-    char input_buffers[HISTORY_DEPTH][BUFFER_SIZE + 1];
-    char trash_buffer[BUFFER_SIZE + 1];
-    char context_buffer[BUFFER_SIZE + 1];
-    int cur_buf_index;
-    int cur_context;
-    int cursorPos;
+    /* the state of an idle shell, the rest is in active */
+    const Config * const config;
+    Active *active; /* 0, while idle with a session pool */
     const char *prompt;
-    CommandDescription *root_cmd;
-    const CommandDescription *cur_cmd_ctx;
+    CommandDescription *root_cmd; /* the top level after the builtins */
+    CommandNode cur_cmd_ctx;
     void *plusArg;
     void * const containerPtr;
     ByteStream* ioStream;
-
+    Job* curJob;
+    uint16_t cursorPos;
+    uint16_t cur_context;
+    uint16_t session;
+    uint8_t cur_buf_index;
     bool echo;
     bool cmdListIsWritable;
 
@@ -137,14 +345,122 @@ namespace Shell
 
   };
 
+  /* the size of the Active block of a shell and its buffers */
+  template<class Policy>
+  struct ShellBlockSize
+  {
+    static const unsigned DEPTH = Policy::HISTORY ? Policy::HISTORY_DEPTH : 1;
+    static const unsigned MEMOS = (DEPTH > 1) ? DEPTH : 0;
+    static const unsigned VALUE = TinyShBase::ACTIVE_SIZE + MEMOS * sizeof(TinyShBase::Memo) + (DEPTH + 2) * (Policy::BUFFER_SIZE + 1);
+  };
+
+  /* the Active block of a shell without session pool */
+  template<unsigned SIZE, bool OWN>
+  struct ShellBlock
+  {
+    void* block()
+    {
+      return &storage;
+    }
+
+    union
+    {
+      void *link;
+      char data[SIZE];
+    } storage;
+  };
+
+  template<unsigned SIZE>
+  struct ShellBlock<SIZE, false>
+  {
+    void* block()
+    {
+      return 0;
+    }
+  };
+
+  /*
+   * a shell with the buffers and features of the policy
+   */
+  template<class Policy = TinyShPolicy>
+  class BasicTinySh: private ShellBlock<ShellBlockSize<Policy>::VALUE, 0 == Policy::SESSION_POOL>, public TinyShBase
+  {
+  public:
+    BasicTinySh(void * container = 0)
+    : TinyShBase(policyConfig, this->block(), container)
+    {
+    }
+
+    ~BasicTinySh()
+    {
+      release();
+    }
+
+  private:
+    static const unsigned DEPTH = ShellBlockSize<Policy>::DEPTH;
+    static const unsigned BLOCK_SIZE = ShellBlockSize<Policy>::VALUE;
+
+    static_assert(Policy::BUFFER_SIZE > 0 && Policy::BUFFER_SIZE < 0xFFFF, "BUFFER_SIZE out of range");
+    static_assert(DEPTH > 0 && DEPTH <= 0xFF, "HISTORY_DEPTH out of range");
+    static_assert(Policy::MAX_ARGS > 0, "MAX_ARGS out of range");
+
+    static void exec(TinyShBase& shell, CommandNode cmd, char *str)
+    {
+      const char *argv[Policy::MAX_ARGS];
+      static_cast<BasicTinySh&>(shell).exec_command(cmd, str, argv, Policy::MAX_ARGS);
+    }
+
+    static const Config policyConfig;
+  };
+
+  template<class Policy>
+  const TinyShBase::Config BasicTinySh<Policy>::policyConfig =
+  {
+    Policy::BUFFER_SIZE,
+    DEPTH,
+    SessionPoolFor<Policy::SESSION_POOL, BLOCK_SIZE>::get(),
+    &BasicTinySh::exec,
+    Policy::HELP ? &TinyShBase::key_help : 0,
+    Policy::COMPLETION ? &TinyShBase::key_complete : 0,
+    Policy::HISTORY ? &TinyShBase::key_history : 0,
+    Policy::LIVE_CHECK,
+  };
+
+  /* the shell with the default policy, as before the policies */
+  typedef BasicTinySh<> TinySh;
+
   inline
-  ByteStream& TinySh::io()
+  ByteStream& TinyShBase::io()
   {
     return *ioStream;
   }
 
   inline
-  TinySh& TinySh::setIo(ByteStream& io_)
+  TinyShBase::Memo* TinyShBase::memo(int i)
+  {
+    return (Memo*)((char*)active + ACTIVE_SIZE) + i;
+  }
+
+  inline
+  char* TinyShBase::line_buffer(int i)
+  {
+    return (char*)memo((config->historyDepth > 1) ? config->historyDepth : 0) + i * (config->bufferSize + 1);
+  }
+
+  inline
+  char* TinyShBase::trash_buffer()
+  {
+    return line_buffer(config->historyDepth);
+  }
+
+  inline
+  char* TinyShBase::context_buffer()
+  {
+    return line_buffer(config->historyDepth + 1);
+  }
+
+  inline
+  TinyShBase& TinyShBase::setIo(ByteStream& io_)
   {
     ioStream = &io_;
 
@@ -152,13 +468,13 @@ namespace Shell
   }
 
   inline
-  void TinySh::setEcho(bool e)
+  void TinyShBase::setEcho(bool e)
   {
     echo = e;
   }
 
   inline
-  TinySh& TinySh::set_prompt(const char *str)
+  TinyShBase& TinyShBase::set_prompt(const char *str)
   {
     prompt = str;
     /* force prompt display by generating empty command */
@@ -168,25 +484,43 @@ namespace Shell
   }
 
   inline
-  void* TinySh::get_arg()
+  void* TinyShBase::get_arg()
   {
     return plusArg;
   }
 
   inline
-  void* TinySh::get_container()
+  void* TinyShBase::get_container()
   {
     return containerPtr;
   }
 
   inline
-  void TinySh::triggerPrompt()
+  void TinyShBase::triggerPrompt()
   {
     char_in('\n');
   }
 
   inline
-  TinySh& TinySh::add_command(const CommandDescription* cmd, CommandDescription* parent)
+  unsigned TinyShBase::sessionId() const
+  {
+    return session;
+  }
+
+  inline
+  void TinyShBase::setSessionId(unsigned id)
+  {
+    session = id;
+  }
+
+  inline
+  bool TinyShBase::isBusy() const
+  {
+    return 0 != curJob;
+  }
+
+  inline
+  TinyShBase& TinyShBase::add_command(const CommandDescription* cmd, CommandDescription* parent)
   {
     add_command((CommandDescription*) cmd, parent);
 
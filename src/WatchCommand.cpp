@@ -0,0 +1,449 @@
+/*
+ * WatchCommand.cpp
+ *
+ */
+
+#include "WatchCommand.h"
+#include "ShellJob.h"
+#include "ShellClock.h"
+
+#include "Util/PrintfToStream.h"
+#include "Util/NumberParser.h"
+
+#include <string.h>
+
+namespace Shell
+{
+
+#ifndef TINYSH_WATCH_LINE_SIZE
+#define TINYSH_WATCH_LINE_SIZE 80 /* characters of the watched command line */
+#endif
+
+#ifndef TINYSH_WATCH_LINES
+#define TINYSH_WATCH_LINES 32 /* output lines of a pass compared by -d, the following ones are always displayed */
+#endif
+
+#ifndef TINYSH_WATCH_LINE_WIDTH
+#define TINYSH_WATCH_LINE_WIDTH 128 /* characters of an output line held back by -d, a longer one counts as changed */
+#endif
+
+/*
+ * The output of a pass for -d: each line is held back, until its end is
+ * known, and passed on with the pass number only, if its hash differs from
+ * the one of the same line in the previous pass. While a line is not taken
+ * completely by the stream, no more output is accepted, so an output job
+ * keeps its chunk. A line longer than the buffer is always passed on.
+ */
+class ChangeFilter: public ByteStream
+{
+public:
+  void reset();
+
+  /* the pass is done, a last line without newline is complete */
+  void endPass();
+
+  /* pass on the rest of a displayed line, return false, if the stream does not take it yet */
+  bool flush();
+
+  virtual unsigned write(unsigned char b);
+  virtual unsigned writeBlock(const unsigned char *b, unsigned numBytes);
+
+  ByteStream *out;
+  unsigned pass;
+  unsigned changed; /* lines displayed after the first pass */
+
+private:
+  enum
+  {
+    PREFIX = 12, /* room for "[pass] " in front of the line */
+    FNV_BASIS = 2166136261u
+  };
+
+  void endLine();
+  void display();
+
+  uint32_t hashes[TINYSH_WATCH_LINES]; /* of the lines of the previous pass */
+  unsigned lines; /* of the previous pass */
+  unsigned line; /* the current one */
+  uint32_t hash;
+  unsigned len;
+  unsigned pos; /* the displayed line from buf[pos] to buf[end] */
+  unsigned end;
+  bool through; /* the rest of a too long line is passed on */
+  char buf[PREFIX + TINYSH_WATCH_LINE_WIDTH];
+};
+
+void ChangeFilter::reset()
+{
+  pass = 0;
+  changed = 0;
+  lines = 0;
+  line = 0;
+  hash = FNV_BASIS;
+  len = 0;
+  pos = end = 0;
+  through = false;
+}
+
+void ChangeFilter::endPass()
+{
+  if (len || through)
+    endLine();
+  lines = (line < TINYSH_WATCH_LINES) ? line : TINYSH_WATCH_LINES;
+  line = 0;
+}
+
+/* the line is complete, display it, if it has changed
+ */
+void ChangeFilter::endLine()
+{
+  bool show = (line >= lines) || (hashes[line] != hash);
+
+  if (line < TINYSH_WATCH_LINES)
+    hashes[line] = hash;
+  line++;
+  hash = FNV_BASIS;
+
+  if (through)
+    through = false;
+  else if (show)
+    display();
+  len = 0;
+}
+
+/* put the pass number in front of the line in buf and pass it on
+ */
+void ChangeFilter::display()
+{
+  unsigned p = pass;
+
+  pos = PREFIX;
+  buf[--pos] = ' ';
+  buf[--pos] = ']';
+  do
+  {
+    buf[--pos] = '0' + p % 10;
+    p /= 10;
+  } while (p);
+  buf[--pos] = '[';
+  end = PREFIX + len;
+
+  if (pass > 1)
+    changed++;
+  flush();
+}
+
+bool ChangeFilter::flush()
+{
+  while (pos < end)
+  {
+    unsigned n = out->writeBlock((const unsigned char*)&buf[pos], end - pos);
+    if (!n)
+      return false;
+    pos += n;
+  }
+
+  return true;
+}
+
+unsigned ChangeFilter::write(unsigned char b)
+{
+  if (!flush())
+    return 0;
+
+  if (through)
+  {
+    if (!out->write(b))
+      return 0;
+    if (b == '\n')
+      endLine();
+    return 1;
+  }
+
+  if (len == TINYSH_WATCH_LINE_WIDTH)
+  {
+    /* too long to hold back */
+    display();
+    through = true;
+    len = 0;
+    return write(b);
+  }
+
+  buf[PREFIX + len++] = b;
+  hash = (hash ^ b) * 16777619u;
+  if (b == '\n')
+    endLine();
+
+  return 1;
+}
+
+unsigned ChangeFilter::writeBlock(const unsigned char *b, unsigned numBytes)
+{
+  unsigned i = 0;
+
+  while (i < numBytes)
+  {
+    if (through || (pos < end) || (len == TINYSH_WATCH_LINE_WIDTH))
+    {
+      if (!write(b[i]))
+        break;
+      i++;
+      continue;
+    }
+
+    /* hold back up to the end of the line */
+    unsigned n = numBytes - i;
+    unsigned k;
+
+    if (n > TINYSH_WATCH_LINE_WIDTH - len)
+      n = TINYSH_WATCH_LINE_WIDTH - len;
+    const unsigned char *nl = (const unsigned char*)memchr(&b[i], '\n', n);
+    if (nl)
+      n = nl - &b[i] + 1;
+    for (k = 0; k < n; k++)
+      hash = (hash ^ b[i + k]) * 16777619u;
+    memcpy(&buf[PREFIX + len], &b[i], n);
+    len += n;
+    i += n;
+    if (nl)
+      endLine();
+  }
+
+  return i;
+}
+
+/*
+ * watch: the command line is resolved and cut into arguments once, each
+ * pass calls the command function with them. A job started by the command
+ * is stepped by the watch job, until it is done, then the next pass waits
+ * for its time. Without a tick source the passes follow each other.
+ */
+class WatchJob: public Job
+{
+public:
+  bool prepare(TinyShBase& shell, int argc, const char **argv);
+  void start(TinyShBase& shell);
+
+  virtual bool step(TinyShBase& shell);
+  virtual void cancel(TinyShBase& shell);
+  virtual bool progress(unsigned long& done, unsigned long& total);
+
+  uint32_t interval; /* ms */
+  unsigned count; /* passes, 0 until cancelled */
+  bool changesOnly;
+
+private:
+  void endPass();
+  void summary(ByteStream& out);
+
+  CommandNode cmd;
+  Job *nested; /* started by the current pass */
+  ByteStream *io;
+  ChangeFilter filter;
+  uint32_t next; /* ticks of the next pass */
+  unsigned passes;
+  int argc;
+  const char *argv[TINYSH_MAX_ARGS];
+  uint16_t ends[TINYSH_MAX_ARGS]; /* of the arguments in line */
+  char line[TINYSH_WATCH_LINE_SIZE + 1];
+};
+
+static WatchJob watchJob;
+
+/* resolve the command line of argv and cut its arguments, return false, if it is no command
+ */
+bool WatchJob::prepare(TinyShBase& shell, int n, const char **words)
+{
+  unsigned len = 0;
+  char *str;
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    unsigned k = strlen(words[i]);
+
+    if (len + k + 1 > sizeof(line))
+    {
+      shell.io().writeBlock("watch: command line too long\n");
+      return false;
+    }
+    memcpy(&line[len], words[i], k);
+    len += k;
+    line[len++] = ' ';
+  }
+  line[len ? len - 1 : 0] = 0;
+
+  cmd = shell.resolveCommand(line, &str);
+  if (cmd.isNull())
+    return false;
+
+  argc = 0;
+  argv[argc++] = cmd.name();
+  while (*str && (argc < TINYSH_MAX_ARGS))
+  {
+    argv[argc] = str;
+    while (*str && (*str != ' '))
+      str++;
+    ends[argc++] = str - line;
+    if (*str)
+      *str++ = 0;
+    while (*str == ' ')
+      str++;
+  }
+
+  return true;
+}
+
+void WatchJob::start(TinyShBase& shell)
+{
+  nested = 0;
+  passes = 0;
+  filter.reset();
+  shell.startJob(*this);
+}
+
+bool WatchJob::step(TinyShBase& shell)
+{
+  uint32_t period = (uint32_t)((uint64_t)interval * ticksPerSecond() / 1000);
+  uint32_t now;
+  int i;
+
+  if (nested)
+  {
+    bool more;
+
+    if (changesOnly)
+      shell.setIo(filter);
+    more = nested->step(shell);
+    shell.setIo(*io);
+    if (more)
+      return true;
+    shell.endNested(*nested);
+    nested = 0;
+    endPass();
+    return true;
+  }
+
+  if (changesOnly && !filter.flush())
+    return true;
+
+  if (count && (passes >= count))
+  {
+    summary(shell.io());
+    return false;
+  }
+
+  /* at a fixed rate, a pass late by more than the interval starts a new one */
+  now = ticks();
+  if (passes && ((int32_t)(now - next) < 0))
+    return true;
+  if (!passes || (now - next > period))
+    next = now;
+  next += period;
+
+  /* the command may have changed its arguments */
+  for (i = 1; i < argc; i++)
+    line[ends[i]] = 0;
+
+  passes++;
+  io = &shell.io();
+  filter.out = io;
+  filter.pass = passes;
+  if (changesOnly)
+    shell.setIo(filter);
+  nested = shell.execNested(cmd, argc, argv);
+  shell.setIo(*io);
+  if (!nested)
+    endPass();
+
+  return true;
+}
+
+void WatchJob::endPass()
+{
+  if (changesOnly)
+    filter.endPass();
+}
+
+void WatchJob::cancel(TinyShBase& shell)
+{
+  if (nested)
+  {
+    if (changesOnly)
+      shell.setIo(filter);
+    nested->cancel(shell);
+    shell.setIo(*io);
+    shell.endNested(*nested);
+    nested = 0;
+  }
+  summary(shell.io());
+}
+
+bool WatchJob::progress(unsigned long& done, unsigned long& total)
+{
+  done = passes;
+  total = count;
+  return true;
+}
+
+void WatchJob::summary(ByteStream& out)
+{
+  PrintfToStream fio(out);
+
+  if (changesOnly)
+    fio.printf("watch: %u passes, %u lines changed\n", passes, filter.changed);
+  else
+    fio.printf("watch: %u passes\n", passes);
+}
+
+static
+void cmd_watch(TinyShBase& shell, int argc, const char **argv)
+{
+  PrintfToStream fio(shell.io());
+  uint64_t value;
+  int i;
+
+  if (watchJob.isRunning())
+  {
+    shell.io().writeBlock("watch: busy\n");
+    return;
+  }
+
+  watchJob.interval = 1000;
+  watchJob.count = 0;
+  watchJob.changesOnly = false;
+
+  for (i = 1; (i < argc) && (argv[i][0] == '-'); i++)
+  {
+    if (0 == strcmp(argv[i], "-d"))
+    {
+      watchJob.changesOnly = true;
+      continue;
+    }
+    if ((strcmp(argv[i], "-n") && strcmp(argv[i], "-c")) || (i + 1 >= argc)
+        || (NumberParser::VALID != NumberParser::parse(argv[i + 1], value)) || (value > 0xFFFFFFFFu))
+    {
+      fio.printf("watch: invalid option: %s\n", argv[i]);
+      return;
+    }
+    if (argv[i][1] == 'n')
+      watchJob.interval = (uint32_t)value;
+    else
+      watchJob.count = (unsigned)value;
+    i++;
+  }
+
+  if (i >= argc)
+  {
+    shell.io().writeBlock("watch: no command\n");
+    return;
+  }
+
+  if (watchJob.prepare(shell, argc - i, &argv[i]))
+    watchJob.start(shell);
+}
+
+CommandDescription watchCommand = { "watch", "execute a command repeatedly (only changed lines with -d)",
+    "[-n ms:1000] [-c count] [-d] command [args]", &cmd_watch, 0, 0, 0 };
+
+} // namespace Shell
@@ -0,0 +1,20 @@
+/*
+ * WatchCommand.h
+ *
+ */
+
+#ifndef WATCHCOMMAND_H_
+#define WATCHCOMMAND_H_
+
+#include "TinySh.h"
+
+namespace Shell
+{
+
+/* "watch [-n ms] [-c count] [-d] command [args]": execute a command every ms milliseconds (1000), count times
+ * or until CTRL-C, with -d only the output lines, that changed since the previous pass */
+extern CommandDescription watchCommand;
+
+} // namespace Shell
+
+#endif /* WATCHCOMMAND_H_ */
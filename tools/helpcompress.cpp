@@ -0,0 +1,490 @@
+/*
+ * helpcompress.cpp
+ *
+ * Build time compressor for the help and usage texts of the command tables
+ * (see src/HelpText.h, TINYSH_COMPRESSED_HELP).
+ *
+ * All initializers of the form { "name", "help", "usage", ... } in the given
+ * sources are collected, a shared dictionary of up to 127 words is built from
+ * their help and usage texts, and copies of the sources are written to the
+ * output directory with these two literals replaced by their compressed form.
+ * The names are left as they are. The dictionary is written to
+ * HelpDictionary.cpp in the output directory.
+ *
+ * The copies are compiled instead of the originals, together with
+ * HelpDictionary.cpp and -DTINYSH_COMPRESSED_HELP=1.
+ *
+ * build: g++ -O2 -o helpcompress tools/helpcompress.cpp
+ * usage: helpcompress [-v] -o <output dir> <source files>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+static const unsigned MAX_WORDS = 127;
+static const unsigned MIN_WORD = 2;
+static const unsigned MAX_WORD = 16;
+static const unsigned FIRST_CODE = 0x81;
+static const unsigned ESCAPE = 0x80;
+
+/* a literal to be compressed, its place in the source */
+struct Literal
+{
+  unsigned file;
+  size_t begin; /* of the first string literal */
+  size_t end; /* after the last one */
+  std::string text; /* decoded */
+  std::vector<unsigned> packed; /* < 256 byte, else 256 + code */
+};
+
+struct Source
+{
+  std::string path;
+  std::string content;
+};
+
+static bool readFile(const std::string& path, std::string& content)
+{
+  FILE *f = fopen(path.c_str(), "rb");
+  char buf[4096];
+  size_t n;
+
+  if (!f)
+    return false;
+  content.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    content.append(buf, n);
+  fclose(f);
+
+  return true;
+}
+
+static bool writeFile(const std::string& path, const std::string& content)
+{
+  FILE *f = fopen(path.c_str(), "wb");
+
+  if (!f)
+    return false;
+  fwrite(content.data(), 1, content.size(), f);
+
+  return 0 == fclose(f);
+}
+
+/* skip white space and comments */
+static size_t skipWs(const std::string& s, size_t i)
+{
+  for (;;)
+  {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n'))
+      i++;
+    if (s.compare(i, 2, "//") == 0)
+    {
+      while (i < s.size() && s[i] != '\n')
+        i++;
+    }
+    else if (s.compare(i, 2, "/*") == 0)
+    {
+      size_t e = s.find("*/", i + 2);
+      i = (e == std::string::npos) ? s.size() : e + 2;
+    }
+    else
+    {
+      return i;
+    }
+  }
+}
+
+static int hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/* parse one string literal at i, append its decoded text, return the position after it or npos */
+static size_t parseString(const std::string& s, size_t i, std::string& text)
+{
+  if (i >= s.size() || s[i] != '"')
+    return std::string::npos;
+
+  for (i++; i < s.size() && s[i] != '"'; i++)
+  {
+    char c = s[i];
+
+    if (c == '\n')
+      return std::string::npos;
+    if (c != '\\')
+    {
+      text += c;
+      continue;
+    }
+
+    c = s[++i];
+    switch (c)
+    {
+    case 'n': text += '\n'; break;
+    case 't': text += '\t'; break;
+    case 'r': text += '\r'; break;
+    case 'a': text += '\a'; break;
+    case 'b': text += '\b'; break;
+    case 'f': text += '\f'; break;
+    case 'v': text += '\v'; break;
+    case 'x':
+      {
+        int v = 0;
+        while (hexValue(s[i + 1]) >= 0)
+          v = v * 16 + hexValue(s[++i]);
+        text += char(v);
+      }
+      break;
+    default:
+      if (c >= '0' && c <= '7')
+      {
+        int v = c - '0';
+        unsigned k;
+        for (k = 1; k < 3 && s[i + 1] >= '0' && s[i + 1] <= '7'; k++)
+          v = v * 8 + s[++i] - '0';
+        text += char(v);
+      }
+      else
+      {
+        text += c; /* \\, \", \', \? */
+      }
+    }
+  }
+
+  return (i < s.size()) ? i + 1 : std::string::npos;
+}
+
+/* a literal, maybe concatenated of several, or a null pointer constant; true, if it is a literal */
+static size_t parseField(const std::string& s, size_t i, std::string& text, bool& isLiteral)
+{
+  size_t j;
+
+  i = skipWs(s, i);
+  isLiteral = false;
+  if (s.compare(i, 7, "nullptr") == 0)
+    return i + 7;
+  if ((s[i] == '0') && (s[i + 1] == ',' || s[i + 1] == ' '))
+    return i + 1;
+
+  text.clear();
+  while ((j = parseString(s, i, text)) != std::string::npos)
+  {
+    isLiteral = true;
+    i = skipWs(s, j);
+  }
+
+  return isLiteral ? i : std::string::npos;
+}
+
+/* find the help and usage literals of all command initializers */
+static void scan(const Source& src, unsigned file, std::vector<Literal>& literals)
+{
+  const std::string& s = src.content;
+  size_t i = 0;
+
+  while (i < s.size())
+  {
+    size_t j = skipWs(s, i);
+
+    if (j != i)
+    {
+      i = j;
+      continue;
+    }
+    if (s[i] == '\'')
+    {
+      i += (s[i + 1] == '\\') ? 4 : 3;
+      continue;
+    }
+    if (s[i] == '"')
+    {
+      std::string dummy;
+      j = parseString(s, i, dummy);
+      i = (j == std::string::npos) ? i + 1 : j;
+      continue;
+    }
+    if (s[i] != '{')
+    {
+      i++;
+      continue;
+    }
+
+    /* { "name", help, usage, */
+    std::string name, text[2];
+    bool isLiteral[2], nameLiteral;
+    size_t begin[2], end[2];
+    unsigned k;
+
+    j = parseField(s, i + 1, name, nameLiteral);
+    i++;
+    if (j == std::string::npos || !nameLiteral || s[j] != ',')
+      continue;
+    for (k = 0; k < 2; k++)
+    {
+      begin[k] = skipWs(s, j + 1);
+      j = parseField(s, j + 1, text[k], isLiteral[k]);
+      if (j == std::string::npos || s[j] != ',')
+        break;
+      end[k] = j;
+      while (end[k] > begin[k] && (s[end[k] - 1] == ' ' || s[end[k] - 1] == '\t' || s[end[k] - 1] == '\n' || s[end[k] - 1] == '\r'))
+        end[k]--;
+    }
+    if (k < 2)
+      continue;
+
+    for (k = 0; k < 2; k++)
+    {
+      if (!isLiteral[k])
+        continue;
+
+      Literal l;
+      l.file = file;
+      l.begin = begin[k];
+      l.end = end[k];
+      l.text = text[k];
+      for (unsigned char c : l.text)
+        l.packed.push_back(c);
+      literals.push_back(l);
+    }
+    i = j;
+  }
+}
+
+/* build the dictionary greedily, always taking the word with the largest saving */
+static void compress(std::vector<Literal>& literals, std::vector<std::string>& words, bool verbose)
+{
+  while (words.size() < MAX_WORDS)
+  {
+    std::unordered_map<std::string, unsigned> counts;
+
+    for (const Literal& l : literals)
+    {
+      size_t i, n;
+      for (i = 0; i < l.packed.size(); i++)
+      {
+        std::string w;
+        for (n = 0; n < MAX_WORD && i + n < l.packed.size(); n++)
+        {
+          unsigned c = l.packed[i + n];
+          if (c >= ESCAPE || c == 0)
+            break;
+          w += char(c);
+          if (w.size() >= MIN_WORD)
+            counts[w]++;
+        }
+      }
+    }
+
+    /* each use saves the word length - 1, the word costs its length, the NUL and an index entry */
+    std::string best;
+    long bestGain = 0;
+    for (const auto& e : counts)
+    {
+      long gain = long(e.second) * long(e.first.size() - 1) - long(e.first.size() + 3);
+      if (gain > bestGain || (gain == bestGain && gain > 0 && e.first < best))
+      {
+        bestGain = gain;
+        best = e.first;
+      }
+    }
+    if (bestGain <= 0)
+      break;
+
+    unsigned code = FIRST_CODE + words.size();
+    words.push_back(best);
+    if (verbose)
+      fprintf(stderr, "0x%02x %4ld \"%s\"\n", code, bestGain, best.c_str());
+
+    for (Literal& l : literals)
+    {
+      std::vector<unsigned> out;
+      size_t i = 0;
+      while (i < l.packed.size())
+      {
+        size_t n = 0;
+        while (n < best.size() && i + n < l.packed.size() && l.packed[i + n] == (unsigned char)best[n])
+          n++;
+        if (n == best.size())
+        {
+          out.push_back(256 + code);
+          i += n;
+        }
+        else
+        {
+          out.push_back(l.packed[i++]);
+        }
+      }
+      l.packed.swap(out);
+    }
+  }
+}
+
+/* the compressed text as C string literal, with octal escapes, which never run into a following digit */
+static std::string literal(const std::vector<unsigned>& packed)
+{
+  std::string r = "\"";
+  char buf[24];
+
+  for (unsigned c : packed)
+  {
+    if (c >= 256)
+    {
+      snprintf(buf, sizeof(buf), "\\%03o", c - 256);
+      r += buf;
+    }
+    else if (c >= ESCAPE)
+    {
+      snprintf(buf, sizeof(buf), "\\%03o\\%03o", ESCAPE, c);
+      r += buf;
+    }
+    else if (c == '"' || c == '\\')
+    {
+      r += '\\';
+      r += char(c);
+    }
+    else if (c < ' ' || c == 127 || c == '?')
+    {
+      /* '?' to avoid trigraphs */
+      snprintf(buf, sizeof(buf), "\\%03o", c);
+      r += buf;
+    }
+    else
+    {
+      r += char(c);
+    }
+  }
+
+  return r + "\"";
+}
+
+static std::string baseName(const std::string& path)
+{
+  size_t p = path.find_last_of("/\\");
+
+  return (p == std::string::npos) ? path : path.substr(p + 1);
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<Source> sources;
+  std::vector<Literal> literals;
+  std::vector<std::string> words;
+  std::string outDir;
+  bool verbose = false;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-v"))
+    {
+      verbose = true;
+    }
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+    {
+      outDir = argv[++i];
+    }
+    else
+    {
+      Source src;
+      src.path = argv[i];
+      if (!readFile(src.path, src.content))
+      {
+        fprintf(stderr, "helpcompress: cannot read %s\n", argv[i]);
+        return 1;
+      }
+      for (const Source& other : sources)
+      {
+        if (baseName(other.path) == baseName(src.path))
+        {
+          fprintf(stderr, "helpcompress: %s and %s have the same name\n", other.path.c_str(), src.path.c_str());
+          return 1;
+        }
+      }
+      sources.push_back(src);
+    }
+  }
+  if (outDir.empty())
+  {
+    fprintf(stderr, "usage: helpcompress [-v] -o <output dir> <source files>\n");
+    return 1;
+  }
+
+  for (i = 0; i < int(sources.size()); i++)
+    scan(sources[i], i, literals);
+
+  size_t before = 0, after = 0;
+  for (const Literal& l : literals)
+    before += l.text.size() + 1;
+
+  compress(literals, words, verbose);
+
+  /* the copies of the sources, literals replaced back to front */
+  for (i = 0; i < int(sources.size()); i++)
+  {
+    std::string content = sources[i].content;
+    size_t k;
+
+    for (k = literals.size(); k-- > 0;)
+    {
+      const Literal& l = literals[k];
+      if (int(l.file) == i)
+        content.replace(l.begin, l.end - l.begin, literal(l.packed));
+    }
+    content = "/* generated by helpcompress from " + sources[i].path + " */\n#line 1 \"" + sources[i].path + "\"\n" + content;
+    if (!writeFile(outDir + "/" + baseName(sources[i].path), content))
+    {
+      fprintf(stderr, "helpcompress: cannot write to %s\n", outDir.c_str());
+      return 1;
+    }
+  }
+
+  /* the dictionary */
+  std::string dict = "/* generated by helpcompress */\n\n#include \"HelpText.h\"\n\nnamespace Shell\n{\n\nconst char helpDictionary[] =";
+  std::string index = "const uint16_t helpDictionaryIndex[] =\n{";
+  size_t offset = 0;
+  unsigned w;
+
+  for (w = 0; w < words.size(); w++)
+  {
+    std::vector<unsigned> chars(words[w].begin(), words[w].end());
+    char buf[16];
+
+    dict += "\n  " + literal(chars) + " \"\\0\"";
+    snprintf(buf, sizeof(buf), "%s%s%u", w ? "," : "", (w % 12) ? " " : "\n  ", unsigned(offset));
+    index += buf;
+    offset += words[w].size() + 1;
+  }
+  if (words.empty())
+  {
+    dict += " \"\"";
+    index += "\n  0";
+  }
+  dict += ";\n\n" + index + "\n};\n\nconst unsigned helpDictionaryCount = " + std::to_string(words.size()) + ";\n\n} // namespace Shell\n";
+  if (!writeFile(outDir + "/HelpDictionary.cpp", dict))
+  {
+    fprintf(stderr, "helpcompress: cannot write to %s\n", outDir.c_str());
+    return 1;
+  }
+
+  for (const Literal& l : literals)
+  {
+    size_t n = l.packed.size() + 1;
+    for (unsigned c : l.packed)
+      if (c >= ESCAPE && c < 256)
+        n++;
+    after += n;
+  }
+  after += offset + 2 * words.size();
+  printf("helpcompress: %u texts, %u -> %u bytes with %u words\n", unsigned(literals.size()), unsigned(before), unsigned(after), unsigned(words.size()));
+
+  return 0;
+}
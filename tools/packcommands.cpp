@@ -0,0 +1,303 @@
+/*
+ * packcommands.cpp
+ *
+ * Generator of packed command trees (see Shell::PackedTree in src/CommandNode.h)
+ * from a text description.
+ *
+ * One command per line, the indentation gives the depth, the fields are
+ * separated by '|', empty fields are left out:
+ *
+ *   # comment
+ *   byte   | work on bytes
+ *     read | read byte(s) | [addr [count:1]] | cmd_readMem | 0
+ *     fill | write byte(s) | addr value [count:1] | cmd_fillMem | 0
+ *
+ * The fields are name, help, usage, function and argument. Function and
+ * argument are C++ expressions, they are collected into tables. The output is
+ * meant to be included into the source file, that defines the functions, after
+ * their definitions:
+ *
+ *   #include "MyCommands.packed.inc"
+ *   ...
+ *   shell.add_command(myTree, &myGroup);
+ *
+ * build: g++ -O2 -o packcommands tools/packcommands.cpp
+ * usage: packcommands -n <tree name> <description> <output file>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+
+static const unsigned NONE = 0xFFFF;
+static const unsigned MAX_NODES = 0xFFF0; /* PACKED_MAX_NODES */
+static const unsigned NO_INDEX = 0xFF;
+
+struct Node
+{
+  std::string field[5]; /* name, help, usage, function, argument */
+  unsigned depth;
+  unsigned next;
+  unsigned child;
+  unsigned line;
+};
+
+static std::string trim(const std::string& s)
+{
+  size_t b = s.find_first_not_of(" \t\r");
+  size_t e = s.find_last_not_of(" \t\r");
+
+  return (b == std::string::npos) ? std::string() : s.substr(b, e - b + 1);
+}
+
+static std::string quote(const std::string& s)
+{
+  std::string r;
+  char buf[8];
+
+  for (unsigned char c : s)
+  {
+    if (c == '"' || c == '\\')
+    {
+      r += '\\';
+      r += char(c);
+    }
+    else if (c < ' ' || c >= 127 || c == '?')
+    {
+      snprintf(buf, sizeof(buf), "\\%03o", c);
+      r += buf;
+    }
+    else
+    {
+      r += char(c);
+    }
+  }
+
+  return r;
+}
+
+/* index of s in a table, added if new */
+static unsigned tableIndex(std::vector<std::string>& table, const std::string& s)
+{
+  unsigned i;
+
+  for (i = 0; i < table.size(); i++)
+    if (table[i] == s)
+      return i;
+  table.push_back(s);
+
+  return i;
+}
+
+int main(int argc, char **argv)
+{
+  const char *treeName = 0;
+  const char *inName = 0;
+  const char *outName = 0;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc)
+      treeName = argv[++i];
+    else if (!inName)
+      inName = argv[i];
+    else
+      outName = argv[i];
+  }
+  if (!treeName || !inName || !outName)
+  {
+    fprintf(stderr, "usage: packcommands -n <tree name> <description> <output file>\n");
+    return 1;
+  }
+
+  FILE *in = fopen(inName, "r");
+  if (!in)
+  {
+    fprintf(stderr, "packcommands: cannot read %s\n", inName);
+    return 1;
+  }
+
+  /* read the nodes, they are in depth first order already */
+  std::vector<Node> nodes;
+  char buf[1024];
+  unsigned lineNo = 0;
+
+  while (fgets(buf, sizeof(buf), in))
+  {
+    std::string line(buf);
+    Node n;
+    size_t pos = 0;
+    unsigned f;
+
+    lineNo++;
+    if (!line.empty() && line[line.size() - 1] == '\n')
+      line.erase(line.size() - 1);
+    if (trim(line).empty() || trim(line)[0] == '#')
+      continue;
+
+    n.depth = line.find_first_not_of(" \t");
+    for (f = 0; f < 5; f++)
+    {
+      size_t e = line.find('|', pos);
+      n.field[f] = trim(line.substr(pos, (e == std::string::npos) ? std::string::npos : e - pos));
+      if (e == std::string::npos)
+        break;
+      pos = e + 1;
+    }
+    if (n.field[0].empty())
+    {
+      fprintf(stderr, "%s:%u: command without name\n", inName, lineNo);
+      return 1;
+    }
+    n.next = NONE;
+    n.child = NONE;
+    n.line = lineNo;
+    nodes.push_back(n);
+  }
+  fclose(in);
+
+  if (nodes.empty() || nodes.size() > MAX_NODES)
+  {
+    fprintf(stderr, "packcommands: %u commands, 1 ... %u are possible\n", unsigned(nodes.size()), MAX_NODES);
+    return 1;
+  }
+
+  /* link siblings and children, the stack holds the last node of each open level */
+  std::vector<unsigned> stack;
+  unsigned k;
+
+  for (k = 0; k < nodes.size(); k++)
+  {
+    Node& n = nodes[k];
+
+    while (!stack.empty() && nodes[stack.back()].depth > n.depth)
+      stack.pop_back();
+
+    if (stack.empty())
+    {
+      if (k)
+      {
+        fprintf(stderr, "%s:%u: indented less than the first command\n", inName, n.line);
+        return 1;
+      }
+    }
+    else if (nodes[stack.back()].depth == n.depth)
+    {
+      nodes[stack.back()].next = k;
+      stack.pop_back();
+    }
+    else
+    {
+      if (nodes[stack.back()].child != NONE)
+      {
+        fprintf(stderr, "%s:%u: indentation does not match the siblings\n", inName, n.line);
+        return 1;
+      }
+      nodes[stack.back()].child = k;
+    }
+    stack.push_back(k);
+  }
+
+  /* the string pool, equal texts are stored once */
+  std::string pool;
+  std::map<std::string, unsigned> offsets;
+  std::vector<std::string> functions, args;
+  std::vector<unsigned> offs(nodes.size() * 3);
+
+  for (k = 0; k < nodes.size(); k++)
+  {
+    unsigned f;
+    for (f = 0; f < 3; f++)
+    {
+      const std::string& s = nodes[k].field[f];
+      if (f && s.empty())
+      {
+        offs[k * 3 + f] = NONE;
+        continue;
+      }
+      std::map<std::string, unsigned>::iterator it = offsets.find(s);
+      if (it == offsets.end())
+      {
+        it = offsets.insert(std::make_pair(s, unsigned(pool.size()))).first;
+        pool += s;
+        pool += '\0';
+      }
+      offs[k * 3 + f] = it->second;
+    }
+  }
+  if (pool.size() >= NONE)
+  {
+    fprintf(stderr, "packcommands: the texts take %u bytes, up to %u are possible\n", unsigned(pool.size()), NONE - 1);
+    return 1;
+  }
+
+  FILE *out = fopen(outName, "w");
+  if (!out)
+  {
+    fprintf(stderr, "packcommands: cannot write %s\n", outName);
+    return 1;
+  }
+
+  fprintf(out, "/* generated by packcommands from %s, %u commands */\n\n", inName, unsigned(nodes.size()));
+
+  fprintf(out, "static const char %sStrings[] =", treeName);
+  size_t p = 0;
+  while (p < pool.size())
+  {
+    size_t e = pool.find('\0', p);
+    fprintf(out, "\n  \"%s\" \"\\0\"", quote(pool.substr(p, e - p)).c_str());
+    p = e + 1;
+  }
+  fprintf(out, ";\n\n");
+
+  std::vector<unsigned> fn(nodes.size()), arg(nodes.size());
+  for (k = 0; k < nodes.size(); k++)
+  {
+    fn[k] = nodes[k].field[3].empty() ? NO_INDEX : tableIndex(functions, nodes[k].field[3]);
+    arg[k] = nodes[k].field[4].empty() ? NO_INDEX : tableIndex(args, nodes[k].field[4]);
+    if ((fn[k] >= NO_INDEX && !nodes[k].field[3].empty()) || (arg[k] >= NO_INDEX && !nodes[k].field[4].empty()))
+    {
+      fprintf(stderr, "packcommands: more than %u different functions or arguments\n", NO_INDEX);
+      fclose(out);
+      return 1;
+    }
+  }
+
+  fprintf(out, "static const Shell::CommandFunction_t %sFunctions[] =\n{\n", treeName);
+  for (k = 0; k < functions.size(); k++)
+    fprintf(out, "  %s,\n", functions[k].c_str());
+  if (functions.empty())
+    fprintf(out, "  0\n");
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static void * const %sArgs[] =\n{\n", treeName);
+  for (k = 0; k < args.size(); k++)
+    fprintf(out, "  (void *)(%s),\n", args[k].c_str());
+  if (args.empty())
+    fprintf(out, "  0\n");
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static const Shell::PackedNode %sNodes[] =\n{\n", treeName);
+  for (k = 0; k < nodes.size(); k++)
+  {
+    fprintf(out, "  { %u, %u, %u, %u, %u, %u, %u }, /* %u %s */\n", offs[k * 3], offs[k * 3 + 1], offs[k * 3 + 2],
+            nodes[k].next, nodes[k].child, fn[k], arg[k], k, nodes[k].field[0].c_str());
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "extern const Shell::PackedTree %s = { %sNodes, %sStrings, %sFunctions, %sArgs };\n", treeName, treeName, treeName, treeName, treeName);
+
+  if (0 != fclose(out))
+  {
+    fprintf(stderr, "packcommands: cannot write %s\n", outName);
+    return 1;
+  }
+
+  printf("packcommands: %u commands, %u bytes of nodes, %u bytes of texts\n", unsigned(nodes.size()),
+         unsigned(nodes.size() * 12), unsigned(pool.size()));
+
+  return 0;
+}
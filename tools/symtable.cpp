@@ -0,0 +1,101 @@
+/*
+ * symtable.cpp
+ *
+ * Generator of constant symbol tables (see Shell::SymbolTable in
+ * src/SymbolTable.h) for targets without a file system.
+ *
+ * The symbols are read from an ELF file, the output of nm or a GNU ld map
+ * file, e.g. of the previous build of the firmware. The output is a source
+ * file with the sorted entries, the names and the hash index, it defines a
+ * SymbolTable::Data, that is installed at startup:
+ *
+ *   extern const Shell::SymbolTable::Data firmwareSymbols;
+ *   static Shell::SymbolTable symbols;
+ *   ...
+ *   symbols.use(firmwareSymbols);
+ *   Shell::setSymbolTable(&symbols);
+ *
+ * build: g++ -O2 -Isrc -o symtable tools/symtable.cpp src/SymbolTable.cpp
+ * usage: symtable -n <table name> <symbol file> <output file>
+ */
+
+#include "SymbolTable.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using Shell::SymbolTable;
+
+static void usage()
+{
+  fprintf(stderr, "usage: symtable -n <table name> <symbol file> <output file>\n");
+}
+
+int main(int argc, char **argv)
+{
+  SymbolTable table;
+  const char *tableName;
+  FILE *out;
+  uint32_t i;
+
+  if ((5 != argc) || strcmp(argv[1], "-n"))
+  {
+    usage();
+    return 1;
+  }
+  tableName = argv[2];
+
+  if (!table.load(argv[3]))
+  {
+    fprintf(stderr, "symtable: no symbols in %s\n", argv[3]);
+    return 1;
+  }
+  const SymbolTable::Data& t = table.table();
+
+  out = fopen(argv[4], "w");
+  if (!out)
+  {
+    perror(argv[4]);
+    return 1;
+  }
+
+  fprintf(out, "/* generated by symtable from %s, do not edit */\n\n", argv[3]);
+  fprintf(out, "#include \"SymbolTable.h\"\n\n");
+
+  fprintf(out, "static const Shell::SymbolTable::Entry entries[] =\n{\n");
+  for (i = 0; i < t.count; i++)
+    fprintf(out, "  { 0x%llxu, %lu, %lu },\n", (unsigned long long)t.entries[i].addr, (unsigned long)t.entries[i].size,
+        (unsigned long)t.entries[i].name);
+  fprintf(out, "};\n\n");
+
+  /* one literal per name, so no escape runs into the next name */
+  fprintf(out, "static const char names[] =\n");
+  for (i = 0; i < t.namesSize; i += strlen(t.names + i) + 1)
+  {
+    const char *n;
+
+    fprintf(out, "  \"");
+    for (n = t.names + i; *n; n++)
+      fprintf(out, ((*n == '"') || (*n == '\\')) ? "\\%c" : "%c", *n);
+    fprintf(out, "\\0\"\n");
+  }
+  fprintf(out, "  ;\n\n");
+
+  fprintf(out, "static const Shell::SymbolTable::Slot slots[] =\n{\n");
+  for (i = 0; i <= t.slotMask; i++)
+    fprintf(out, "%s{ 0x%08lx, %lu },%s", (i % 4) ? " " : "  ", (unsigned long)t.slots[i].hash,
+        (unsigned long)t.slots[i].entry, ((i % 4) == 3) ? "\n" : "");
+  fprintf(out, "%s};\n\n", (i % 4) ? "\n" : "");
+
+  fprintf(out, "extern const Shell::SymbolTable::Data %s;\n", tableName);
+  fprintf(out, "const Shell::SymbolTable::Data %s = { entries, names, slots, %lu, %lu, 0x%lx };\n", tableName,
+      (unsigned long)t.count, (unsigned long)t.namesSize, (unsigned long)t.slotMask);
+
+  if (fclose(out))
+  {
+    perror(argv[4]);
+    return 1;
+  }
+
+  return 0;
+}
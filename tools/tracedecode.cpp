@@ -0,0 +1,189 @@
+/*
+ * tracedecode.cpp
+ *
+ * Host side decoder for images of the Shell::TraceRing (see src/CommandTrace.h).
+ *
+ * The image is either the raw memory content, or the text output of
+ * "mem hexdump" over the ring (address and size from "trace info").
+ *
+ * build: g++ -O2 -o tracedecode tools/tracedecode.cpp
+ * usage: tracedecode <image file>
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+
+static const uint32_t MAGIC = 0x54725368;
+static const unsigned HEADER_SIZE = 24;
+
+static bool bigEndian;
+
+static uint32_t get(const std::vector<unsigned char>& img, size_t pos, unsigned size)
+{
+  uint32_t v = 0;
+  unsigned i;
+
+  for (i = 0; i < size; i++)
+  {
+    unsigned char b = img[pos + (bigEndian ? i : size - 1 - i)];
+    v = (v << 8) | b;
+  }
+
+  return v;
+}
+
+static uint64_t getPtr(const std::vector<unsigned char>& img, size_t pos, unsigned size)
+{
+  uint64_t v = 0;
+  unsigned i;
+
+  for (i = 0; i < size; i++)
+  {
+    unsigned char b = img[pos + (bigEndian ? i : size - 1 - i)];
+    v = (v << 8) | b;
+  }
+
+  return v;
+}
+
+static int hexval(int c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/* parse lines "<addr>: xx xx ...  <ascii>" as printed by mem hexdump */
+static bool parseHexdump(const std::vector<unsigned char>& text, std::vector<unsigned char>& img)
+{
+  size_t pos = 0;
+
+  while (pos < text.size())
+  {
+    size_t eol = pos;
+    while (eol < text.size() && text[eol] != '\n')
+      eol++;
+
+    size_t p = pos;
+    while (p < eol && isxdigit(text[p]))
+      p++;
+    if ((p > pos) && (p + 1 < eol) && (text[p] == ':') && (text[p + 1] == ' '))
+    {
+      unsigned n;
+
+      p += 2;
+      for (n = 0; (n < 16) && (p + 2 < eol); n++, p += 3)
+      {
+        int h = hexval(text[p]), l = hexval(text[p + 1]);
+        if ((h < 0) || (l < 0) || (text[p + 2] != ' '))
+          break;
+        img.push_back((unsigned char)(h * 16 + l));
+      }
+    }
+
+    pos = eol + 1;
+  }
+
+  return !img.empty();
+}
+
+static long findMagic(const std::vector<unsigned char>& img)
+{
+  size_t i;
+
+  for (i = 0; i + HEADER_SIZE <= img.size(); i += 4)
+  {
+    uint32_t le = img[i] | (img[i + 1] << 8) | (img[i + 2] << 16) | ((uint32_t)img[i + 3] << 24);
+    uint32_t be = ((uint32_t)img[i] << 24) | (img[i + 1] << 16) | (img[i + 2] << 8) | img[i + 3];
+
+    if (le == MAGIC || be == MAGIC)
+    {
+      bigEndian = (be == MAGIC);
+      return (long)i;
+    }
+  }
+
+  return -1;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s <raw or hexdump image of the trace ring>\n", argv[0]);
+    return 2;
+  }
+
+  FILE *f = fopen(argv[1], "rb");
+  if (!f)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  std::vector<unsigned char> data, img;
+  unsigned char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.insert(data.end(), buf, buf + n);
+  fclose(f);
+
+  long start = findMagic(data);
+  if (start < 0)
+  {
+    if (parseHexdump(data, img))
+      start = findMagic(img);
+  }
+  else
+  {
+    img.swap(data);
+  }
+
+  if (start < 0)
+  {
+    fprintf(stderr, "%s: no trace ring found\n", argv[1]);
+    return 1;
+  }
+
+  unsigned version = get(img, start + 4, 2);
+  unsigned recordSize = img[start + 6];
+  unsigned pointerSize = img[start + 7];
+  uint32_t depth = get(img, start + 8, 4);
+  uint32_t written = get(img, start + 12, 4);
+  uint32_t tps = get(img, start + 16, 4);
+
+  if ((version != 1) || (pointerSize != 4 && pointerSize != 8) || (recordSize < 12 + pointerSize) || !depth)
+  {
+    fprintf(stderr, "%s: unsupported trace ring (version %u, record size %u, pointer size %u)\n", argv[1], version, recordSize, pointerSize);
+    return 1;
+  }
+
+  size_t records = start + HEADER_SIZE;
+  uint32_t avail = (img.size() - records) / recordSize;
+  uint32_t seq = (written > depth) ? written - depth : 0;
+
+  if (avail < depth && avail < written)
+    fprintf(stderr, "%s: image truncated, %u of %u records\n", argv[1], avail, depth);
+
+  printf("# %s endian, %u bit, %u records, %u written, %u ticks per second\n", bigEndian ? "big" : "little", pointerSize * 8, depth, written, tps);
+  printf("%8s %10s %5s %18s %3s %10s\n", "seq", "start", "sess", "command", "arg", "ticks");
+  for (; seq < written; seq++)
+  {
+    size_t r = records + (size_t)(seq % depth) * recordSize;
+
+    if ((seq % depth) >= avail)
+      continue;
+
+    printf("%8u %10u %5u 0x%016llx %3u %10u\n", seq, get(img, r, 4), get(img, r + 8, 2),
+        (unsigned long long)getPtr(img, r + recordSize - pointerSize, pointerSize), img[r + 10], get(img, r + 4, 4));
+  }
+
+  return 0;
+}